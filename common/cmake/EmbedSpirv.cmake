@@ -0,0 +1,36 @@
+# Run by tutorial_embed_shaders() (TutorialShaders.cmake) as
+#   cmake -DSHADER=tri.vert -DWORDS=<glslc -mfmt=num output>
+#         -DHEADER=<header> -P EmbedSpirv.cmake
+# to write the header declaring the module: tri.vert becomes kTriVert.
+
+file(READ ${WORDS} SPIRV)
+string(STRIP "${SPIRV}" SPIRV)
+if (NOT SPIRV MATCHES "^0x07230203")
+  message(FATAL_ERROR "${WORDS}: not a SPIR-V module")
+endif()
+
+string(REGEX REPLACE "[^A-Za-z0-9]+" ";" PARTS ${SHADER})
+set(NAME k)
+foreach(PART ${PARTS})
+  string(SUBSTRING ${PART} 0 1 FIRST)
+  string(SUBSTRING ${PART} 1 -1 REST)
+  string(TOUPPER ${FIRST} FIRST)
+  set(NAME ${NAME}${FIRST}${REST})
+endforeach()
+
+string(TOUPPER ${SHADER} GUARD)
+string(REGEX REPLACE "[^A-Z0-9]" "_" GUARD "EMBEDDED_SHADER_${GUARD}_H")
+file(WRITE ${HEADER}
+"// Generated from ${SHADER} by common/cmake/EmbedSpirv.cmake; do not edit
+
+#ifndef ${GUARD}
+#define ${GUARD}
+
+#include <cstdint>
+
+constexpr uint32_t ${NAME}[] = {
+${SPIRV}
+};
+
+#endif  // ${GUARD}
+")
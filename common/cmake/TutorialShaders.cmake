@@ -0,0 +1,59 @@
+# tutorial_embed_shaders(<target> <shader dir>)
+#   Compile the GLSL shaders in <shader dir> (*.vert, *.frag, *.comp, ...)
+#   to SPIR-V with glslc at build time, and give <target> a header for each
+#   one, <shader dir name>/<file name>.h in its include path:
+#     #include "shaders/tri.vert.h"
+#     ... .codeSize = sizeof(kTriVert), .pCode = kTriVert, ...
+#   holding the module as a constexpr uint32_t array named after the file.
+#   Shader modules are then created straight from the binary: no asset
+#   reads, and no shader compiler in the APK.
+#   glslc comes with the NDK (shader-tools/<host>/glslc); set TUTORIAL_GLSLC
+#   to use another one. TUTORIAL_SHADER_OPTIMIZE runs its SPIR-V optimizer
+#   (-O) over every module.
+
+option(TUTORIAL_SHADER_OPTIMIZE "Optimize embedded SPIR-V (glslc -O)" ON)
+
+file(GLOB TUTORIAL_NDK_SHADER_TOOLS "${ANDROID_NDK}/shader-tools/*")
+find_program(TUTORIAL_GLSLC glslc HINTS ${TUTORIAL_NDK_SHADER_TOOLS})
+set(TUTORIAL_EMBED_SPIRV_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/EmbedSpirv.cmake)
+
+function(tutorial_embed_shaders TARGET SHADER_DIR)
+  if (NOT TUTORIAL_GLSLC)
+    message(FATAL_ERROR "glslc not found: set TUTORIAL_GLSLC")
+  endif()
+  if (TUTORIAL_SHADER_OPTIMIZE)
+    set(OPTIMIZE -O)
+  else()
+    set(OPTIMIZE -O0)
+  endif()
+  get_filename_component(SHADER_DIR ${SHADER_DIR} ABSOLUTE)
+  get_filename_component(DIR_NAME ${SHADER_DIR} NAME)
+  set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/embedded_shaders)
+  file(GLOB SHADERS
+       ${SHADER_DIR}/*.vert ${SHADER_DIR}/*.frag ${SHADER_DIR}/*.comp
+       ${SHADER_DIR}/*.geom ${SHADER_DIR}/*.tesc ${SHADER_DIR}/*.tese)
+
+  set(HEADERS)
+  foreach(SHADER ${SHADERS})
+    get_filename_component(NAME ${SHADER} NAME)
+    set(WORDS ${OUTPUT_DIR}/${DIR_NAME}/${NAME}.spv.txt)
+    set(HEADER ${OUTPUT_DIR}/${DIR_NAME}/${NAME}.h)
+    # -mfmt=num writes the module as comma separated words, which the
+    # script wraps into the array
+    add_custom_command(
+       OUTPUT ${HEADER}
+       COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}/${DIR_NAME}
+       COMMAND ${TUTORIAL_GLSLC} ${OPTIMIZE} --target-env=vulkan1.0
+               -mfmt=num -o ${WORDS} ${SHADER}
+       COMMAND ${CMAKE_COMMAND} -DSHADER=${NAME} -DWORDS=${WORDS}
+               -DHEADER=${HEADER} -P ${TUTORIAL_EMBED_SPIRV_SCRIPT}
+       DEPENDS ${SHADER} ${TUTORIAL_EMBED_SPIRV_SCRIPT}
+       COMMENT "Embedding SPIR-V of ${DIR_NAME}/${NAME}"
+       VERBATIM)
+    list(APPEND HEADERS ${HEADER})
+  endforeach()
+
+  # listing the headers as sources is what makes the target build them
+  target_sources(${TARGET} PRIVATE ${HEADERS})
+  target_include_directories(${TARGET} PRIVATE ${OUTPUT_DIR})
+endfunction()
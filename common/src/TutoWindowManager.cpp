@@ -23,6 +23,7 @@ VkPhysicalDevice tutorialGpu;
 VkDevice tutorialDevice;
 VkQueue tutorialGraphicsQueue;
 VkPhysicalDeviceMemoryProperties tutorialMemoryProperties;
+TutorialMemoryAllocator tutorialMemoryAllocator;
 
 VkSurfaceKHR tutorialSurface;
 VkSwapchainKHR tutorialSwapchain;
@@ -147,6 +148,8 @@ void tutorialInitWindow(ANativeWindow* platformWindow,
   // Get the graphic queue (used later to submit command buffer)
   vkGetDeviceQueue(tutorialDevice, 0, 0, &tutorialGraphicsQueue);
 
+  tutorialMemoryAllocator.Init(tutorialGpu, tutorialDevice);
+
   LOGI("<-TutoInitWindow");
 }
 
@@ -18,12 +18,14 @@
 #include <vulkan_wrapper.h>
 #include <stdexcept>
 #include <android/native_window.h>
+#include "TutorialMemory.hpp"
 
 extern VkInstance tutorialInstance;
 extern VkPhysicalDevice tutorialGpu;
 extern VkDevice tutorialDevice;
 extern VkQueue tutorialGraphicsQueue;
 extern VkPhysicalDeviceMemoryProperties tutorialMemoryProperties;
+extern TutorialMemoryAllocator tutorialMemoryAllocator;
 
 extern VkSurfaceKHR tutorialSurface;
 extern VkSwapchainKHR tutorialSwapchain;
@@ -0,0 +1,154 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialAsset.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <utility>
+
+TutorialAssetView::TutorialAssetView()
+    : asset_(nullptr),
+      assetAllocated_(false),
+      mapping_(nullptr),
+      mappingSize_(0),
+      data_(nullptr),
+      size_(0) {}
+
+TutorialAssetView::~TutorialAssetView() { Close(); }
+
+TutorialAssetView::TutorialAssetView(TutorialAssetView&& other)
+    : TutorialAssetView() {
+  *this = std::move(other);
+}
+
+TutorialAssetView& TutorialAssetView::operator=(TutorialAssetView&& other) {
+  if (this != &other) {
+    Close();
+    // the copy's heap buffer moves along, data_ stays valid
+    asset_ = other.asset_;
+    other.asset_ = nullptr;
+    assetAllocated_ = other.assetAllocated_;
+    mapping_ = other.mapping_;
+    mappingSize_ = other.mappingSize_;
+    copy_ = std::move(other.copy_);
+    data_ = other.data_;
+    size_ = other.size_;
+    other.mapping_ = nullptr;
+    other.Close();
+  }
+  return *this;
+}
+
+void TutorialAssetView::Use(const void* data, size_t size, size_t alignment) {
+  size_ = size;
+  if (reinterpret_cast<uintptr_t>(data) % alignment == 0) {
+    data_ = static_cast<const uint8_t*>(data);
+    return;
+  }
+  // new[] storage is aligned for any fundamental type
+  copy_.assign(static_cast<const uint8_t*>(data),
+               static_cast<const uint8_t*>(data) + size);
+  data_ = copy_.data();
+}
+
+#ifdef __ANDROID__
+bool TutorialAssetView::Open(AAssetManager* manager, const char* path,
+                             size_t alignment) {
+  Close();
+  asset_ = AAssetManager_open(manager, path, AASSET_MODE_BUFFER);
+  if (!asset_) return false;
+  size_t size = AAsset_getLength(asset_);
+  // AAsset_getBuffer() never fails on a compressed asset, it inflates it
+  // into a buffer of its own. Only an asset stored as is has a file
+  // descriptor range in the APK, and only that one is mapped in place.
+  off64_t start, length;
+  int fd = AAsset_openFileDescriptor64(asset_, &start, &length);
+  if (fd >= 0) {
+    close(fd);
+    const void* buffer = AAsset_getBuffer(asset_);
+    if (buffer) {
+      assetAllocated_ = AAsset_isAllocated(asset_) != 0;
+      Use(buffer, size, alignment);
+      return true;
+    }
+  }
+  // compressed in the APK: read (inflate) it straight into our own buffer
+  copy_.resize(size);
+  bool ok = AAsset_read(asset_, copy_.data(), size) == static_cast<int>(size);
+  AAsset_close(asset_);
+  asset_ = nullptr;
+  if (!ok) {
+    Close();
+    return false;
+  }
+  data_ = copy_.data();
+  size_ = size;
+  return true;
+}
+#endif
+
+bool TutorialAssetView::OpenFile(const char* path, size_t alignment) {
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  void* mapping =
+      size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+  close(fd);  // the mapping keeps the file alive
+  if (mapping == MAP_FAILED) return false;
+  mapping_ = mapping;
+  mappingSize_ = size;
+  Use(mapping, size, alignment);  // pages are aligned enough
+  return true;
+}
+
+void TutorialAssetView::Wrap(const void* data, size_t size,
+                             size_t alignment) {
+  Close();
+  Use(data, size, alignment);
+}
+
+void TutorialAssetView::Close(void) {
+#ifdef __ANDROID__
+  if (asset_) AAsset_close(asset_);
+#endif
+  asset_ = nullptr;
+  assetAllocated_ = false;
+  if (mapping_) munmap(mapping_, mappingSize_);
+  mapping_ = nullptr;
+  mappingSize_ = 0;
+  copy_ = std::vector<uint8_t>();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#ifdef __ANDROID__
+bool TutorialApkAssets::Open(const char* path, TutorialAssetView* view,
+                             size_t alignment) {
+  return view->Open(manager_, path, alignment);
+}
+#endif
+
+bool TutorialDirectoryAssets::Open(const char* path, TutorialAssetView* view,
+                                   size_t alignment) {
+  return view->OpenFile((root_ + "/" + path).c_str(), alignment);
+}
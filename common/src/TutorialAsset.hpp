@@ -0,0 +1,113 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_ASSET_HPP
+#define TUTORIAL_ASSET_HPP
+
+#ifdef __ANDROID__
+#include <android/asset_manager.h>
+#else
+struct AAsset;  // always nullptr off Android
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// TutorialAssetView:
+//   Read only bytes of an asset or a file, valid until the view is closed
+//   or destroyed. Assets stored uncompressed in the APK are used in place
+//   (AAsset_getBuffer() maps them), files are mmap()ed; only compressed
+//   assets, or data not aligned as asked, are read into a copy. An asset is
+//   stored uncompressed when it has a file descriptor range in the APK:
+//   list its extension in the app's aaptOptions noCompress. Parsers and
+//   decoders should take Data() as is rather than copying it again.
+//   Views can be moved, not copied.
+class TutorialAssetView {
+ public:
+  TutorialAssetView();
+  ~TutorialAssetView();
+  TutorialAssetView(TutorialAssetView&& other);
+  TutorialAssetView& operator=(TutorialAssetView&& other);
+
+  // Open an asset, or a file of the local file system (host tools, files
+  // downloaded to internal storage). Data() is aligned to alignment bytes,
+  // e.g. 4 for SPIR-V words. Returns false if it cannot be opened or read.
+#ifdef __ANDROID__
+  bool Open(AAssetManager* manager, const char* path, size_t alignment = 1);
+#endif
+  bool OpenFile(const char* path, size_t alignment = 1);
+  // View memory owned by something that outlives the view (an archive)
+  void Wrap(const void* data, size_t size, size_t alignment = 1);
+  void Close(void);
+
+  const uint8_t* Data(void) const { return data_; }
+  size_t Size(void) const { return size_; }
+  // True when the bytes had to be copied, by us or by the asset manager
+  bool Copied(void) const { return !copy_.empty() || assetAllocated_; }
+
+ private:
+  TutorialAssetView(const TutorialAssetView&) = delete;
+  TutorialAssetView& operator=(const TutorialAssetView&) = delete;
+  // Copy [data, data + size) unless it is aligned
+  void Use(const void* data, size_t size, size_t alignment);
+
+  AAsset* asset_;
+  bool assetAllocated_;  // AAsset_getBuffer() returned a heap copy
+  void* mapping_;  // mmap() of a file
+  size_t mappingSize_;
+  std::vector<uint8_t> copy_;
+  const uint8_t* data_;
+  size_t size_;
+};
+
+// TutorialAssetSource:
+//   Where assets are looked up by path: the APK on a device, a directory or
+//   a TutorialAssetArchive anywhere. Code loading assets takes a source, so
+//   it runs the same on a device and on a Linux host. Open() may be called
+//   from several threads at once.
+class TutorialAssetSource {
+ public:
+  virtual ~TutorialAssetSource() {}
+  // Open path into view, see TutorialAssetView::Open()
+  virtual bool Open(const char* path, TutorialAssetView* view,
+                    size_t alignment = 1) = 0;
+};
+
+#ifdef __ANDROID__
+// The assets of the APK, through AAssetManager
+class TutorialApkAssets : public TutorialAssetSource {
+ public:
+  TutorialApkAssets() : manager_(nullptr) {}
+  void Init(AAssetManager* manager) { manager_ = manager; }
+  bool Open(const char* path, TutorialAssetView* view,
+            size_t alignment = 1) override;
+
+ private:
+  AAssetManager* manager_;
+};
+#endif
+
+// The files under a directory, each one mmap()ed on its own
+class TutorialDirectoryAssets : public TutorialAssetSource {
+ public:
+  void Init(const std::string& root) { root_ = root; }
+  bool Open(const char* path, TutorialAssetView* view,
+            size_t alignment = 1) override;
+
+ private:
+  std::string root_;
+};
+
+#endif  // TUTORIAL_ASSET_HPP
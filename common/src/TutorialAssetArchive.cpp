@@ -0,0 +1,152 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialAssetArchive.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t ReadU64(const uint8_t* p) {
+  return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+}
+
+uint64_t tutorialFnv1a64(const void* data, size_t size, uint64_t hash) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool TutorialAssetArchive::Init(TutorialAssetView&& file, std::string* error) {
+  Destroy();
+  const uint8_t* data = file.Data();
+  const size_t size = file.Size();
+  if (size < kTutorialArchiveHeaderSize ||
+      memcmp(data, kTutorialArchiveMagic, sizeof(kTutorialArchiveMagic))) {
+    *error = "not an asset archive";
+    return false;
+  }
+  if (ReadU32(data + 8) != kTutorialArchiveVersion) {
+    *error = "unsupported archive version";
+    return false;
+  }
+  const uint64_t count = ReadU32(data + 12);
+  const uint32_t alignment = ReadU32(data + 16);
+  const uint64_t namesSize = ReadU32(data + 20);
+  const uint64_t entriesEnd = kTutorialArchiveHeaderSize + count * 32;
+  if (entriesEnd + namesSize > size) {
+    *error = "truncated table of contents";
+    return false;
+  }
+  if (!alignment || (alignment & (alignment - 1))) {
+    *error = "alignment is not a power of two";
+    return false;
+  }
+
+  // names_ points into file: set only once every check passed and file is
+  // kept, so a failed Init() leaves nothing dangling
+  const char* names = reinterpret_cast<const char*>(data + entriesEnd);
+  auto name = [names](const TutorialArchiveEntry& entry) {
+    return std::string(names + entry.nameOffset_, entry.nameSize_);
+  };
+  entries_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* p = data + kTutorialArchiveHeaderSize + i * 32;
+    TutorialArchiveEntry& entry = entries_[i];
+    entry.nameOffset_ = ReadU32(p);
+    entry.nameSize_ = ReadU32(p + 4);
+    entry.offset_ = ReadU64(p + 8);
+    entry.size_ = ReadU64(p + 16);
+    entry.checksum_ = ReadU64(p + 24);
+    if (static_cast<uint64_t>(entry.nameOffset_) + entry.nameSize_ >
+            namesSize ||
+        entry.offset_ > size || entry.size_ > size - entry.offset_) {
+      *error = "entry " + std::to_string(i) + " out of bounds";
+      entries_.clear();
+      return false;
+    }
+    // the entry alignment the header promises
+    if (entry.offset_ & (alignment - 1)) {
+      *error = "entry " + std::to_string(i) + " not aligned: " + name(entry);
+      entries_.clear();
+      return false;
+    }
+    if (i && !(name(entries_[i - 1]) < name(entry))) {
+      *error = "entries not sorted: " + name(entry);
+      entries_.clear();
+      return false;
+    }
+  }
+  names_ = names;
+  alignment_ = alignment;
+  file_ = std::move(file);
+  return true;
+}
+
+void TutorialAssetArchive::Destroy(void) {
+  file_.Close();
+  entries_.clear();
+  names_ = nullptr;
+  alignment_ = 0;
+}
+
+std::string TutorialAssetArchive::Name(size_t i) const {
+  return std::string(names_ + entries_[i].nameOffset_, entries_[i].nameSize_);
+}
+
+const TutorialArchiveEntry* TutorialAssetArchive::Find(
+    const char* path) const {
+  const size_t pathSize = strlen(path);
+  // bytewise, a shorter name sorting before any longer one it starts
+  auto less = [this, pathSize](const TutorialArchiveEntry& entry,
+                               const char* path) {
+    int order = memcmp(names_ + entry.nameOffset_, path,
+                       std::min<size_t>(entry.nameSize_, pathSize));
+    return order ? order < 0 : entry.nameSize_ < pathSize;
+  };
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), path, less);
+  if (it == entries_.end() || it->nameSize_ != pathSize ||
+      memcmp(names_ + it->nameOffset_, path, pathSize)) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+bool TutorialAssetArchive::Open(const char* path, TutorialAssetView* view,
+                                size_t alignment) {
+  const TutorialArchiveEntry* entry = Find(path);
+  if (!entry) return false;
+  view->Wrap(file_.Data() + entry->offset_, static_cast<size_t>(entry->size_),
+             alignment);
+  return true;
+}
+
+bool TutorialAssetArchive::Verify(std::vector<std::string>* corrupted) const {
+  corrupted->clear();
+  for (size_t i = 0; i < entries_.size(); i++) {
+    const TutorialArchiveEntry& entry = entries_[i];
+    if (tutorialFnv1a64(file_.Data() + entry.offset_,
+                        static_cast<size_t>(entry.size_)) != entry.checksum_) {
+      corrupted->push_back(Name(i));
+    }
+  }
+  return corrupted->empty();
+}
@@ -0,0 +1,88 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_ASSET_ARCHIVE_HPP
+#define TUTORIAL_ASSET_ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TutorialAsset.hpp"
+
+// Packed asset archive: all assets of an app in one file, mapped once.
+// Little endian throughout:
+//   header   magic "TUTPAK\0\0", version, entry count, data alignment,
+//            names size (u32 each)
+//   entries  entry count TutorialArchiveEntry, sorted by name (bytewise)
+//   names    the entry names, back to back, not NUL terminated
+//   data     every entry at a multiple of the data alignment (at least 16,
+//            enough for any texel block or staging copy)
+// Each entry carries the FNV-1a 64 of its bytes, checked by Verify().
+// tools/asset_pack writes archives.
+static const char kTutorialArchiveMagic[8] = {'T', 'U', 'T', 'P',
+                                              'A', 'K', 0,   0};
+static const uint32_t kTutorialArchiveVersion = 1;
+static const size_t kTutorialArchiveHeaderSize = 24;
+
+struct TutorialArchiveEntry {
+  uint32_t nameOffset_;  // into the names
+  uint32_t nameSize_;
+  uint64_t offset_;  // from the start of the file
+  uint64_t size_;
+  uint64_t checksum_;
+};
+
+// FNV-1a 64 of data, continuing from hash
+uint64_t tutorialFnv1a64(const void* data, size_t size,
+                         uint64_t hash = 0xcbf29ce484222325ULL);
+
+// TutorialAssetArchive:
+//   Read an archive held in a TutorialAssetView: an APK asset stored
+//   uncompressed, or a mmap()ed file. Lookups are a binary search of the
+//   entries; the views handed out point into the archive's mapping, so the
+//   archive must outlive them. Entry alignment holds as far as the mapping
+//   is aligned: always for mmap(), 4 bytes for assets zipaligned in an APK
+//   (views then copy when asked for more).
+class TutorialAssetArchive : public TutorialAssetSource {
+ public:
+  TutorialAssetArchive() : names_(nullptr), alignment_(0) {}
+
+  // Take over file and check its header and entries; on failure, error
+  // says why
+  bool Init(TutorialAssetView&& file, std::string* error);
+  void Destroy(void);
+
+  bool Open(const char* path, TutorialAssetView* view,
+            size_t alignment = 1) override;
+  // Check every entry against its checksum; names of those that do not
+  // match go to corrupted
+  bool Verify(std::vector<std::string>* corrupted) const;
+
+  size_t Count(void) const { return entries_.size(); }
+  std::string Name(size_t i) const;
+  const TutorialArchiveEntry& Entry(size_t i) const { return entries_[i]; }
+  uint32_t Alignment(void) const { return alignment_; }
+
+ private:
+  // Entry named path, nullptr if none
+  const TutorialArchiveEntry* Find(const char* path) const;
+
+  TutorialAssetView file_;
+  std::vector<TutorialArchiveEntry> entries_;
+  const char* names_;
+  uint32_t alignment_;
+};
+
+#endif  // TUTORIAL_ASSET_ARCHIVE_HPP
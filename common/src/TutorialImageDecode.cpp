@@ -0,0 +1,112 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialImageDecode.hpp"
+#include "TutorialPixels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+// The one place stb_image is compiled in
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include <stb/stb_image.h>
+
+class StbImageDecoder : public TutorialImageDecoder {
+ public:
+  const char* Name(void) const override { return "stb_image"; }
+  bool Decode(const void* data, size_t size,
+              TutorialImage* image) const override {
+    // Decode in the file's own channel count: stb's per pixel expansion to
+    // RGBA is slower than tutorialCopyImageToRGBA()
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load_from_memory(
+        static_cast<const stbi_uc*>(data), static_cast<int>(size), &width,
+        &height, &channels, 0);
+    if (!pixels) return false;
+
+    image->width_ = static_cast<uint32_t>(width);
+    image->height_ = static_cast<uint32_t>(height);
+    image->mipLevels_ = 1;
+    image->pixels_.resize(static_cast<size_t>(width) * height * 4);
+    tutorialCopyImageToRGBA(image->pixels_.data(), image->width_ * 4, pixels,
+                            image->width_, image->height_, channels);
+    stbi_image_free(pixels);
+    return true;
+  }
+};
+
+static StbImageDecoder stbImageDecoder;
+static std::atomic<const TutorialImageDecoder*> selectedDecoder(
+    &stbImageDecoder);
+
+const TutorialImageDecoder& tutorialStbImageDecoder(void) {
+  return stbImageDecoder;
+}
+
+void tutorialSetImageDecoder(const TutorialImageDecoder& decoder) {
+  selectedDecoder.store(&decoder);
+}
+
+const TutorialImageDecoder& tutorialImageDecoder(void) {
+  return *selectedDecoder.load();
+}
+
+bool tutorialDecodeImage(const void* data, size_t size, TutorialImage* image) {
+  const TutorialImageDecoder* decoder = selectedDecoder.load();
+  if (decoder->Decode(data, size, image)) return true;
+  return decoder != &stbImageDecoder &&
+         stbImageDecoder.Decode(data, size, image);
+}
+
+uint32_t tutorialMipLevelCount(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+    levels++;
+  }
+  return levels;
+}
+
+void tutorialMipLevel(const TutorialImage& image, uint32_t level,
+                      uint32_t* width, uint32_t* height, size_t* offset) {
+  uint32_t w = image.width_, h = image.height_;
+  size_t bytes = 0;
+  for (uint32_t i = 0; i < level; i++) {
+    bytes += static_cast<size_t>(w) * h * 4;
+    w = std::max(w >> 1, 1u);
+    h = std::max(h >> 1, 1u);
+  }
+  *width = w;
+  *height = h;
+  *offset = bytes;
+}
+
+void tutorialGenerateMipmaps(TutorialImage* image) {
+  assert(image->mipLevels_ == 1);
+  const uint32_t levels = tutorialMipLevelCount(image->width_, image->height_);
+  uint32_t width, height;
+  size_t total;
+  tutorialMipLevel(*image, levels, &width, &height, &total);
+  image->pixels_.resize(total);
+
+  for (uint32_t level = 1; level < levels; level++) {
+    size_t srcOffset, dstOffset;
+    uint32_t srcWidth, srcHeight;
+    tutorialMipLevel(*image, level - 1, &srcWidth, &srcHeight, &srcOffset);
+    tutorialMipLevel(*image, level, &width, &height, &dstOffset);
+    tutorialDownsampleRGBA(&image->pixels_[dstOffset],
+                           &image->pixels_[srcOffset], srcWidth, srcHeight);
+  }
+  image->mipLevels_ = levels;
+}
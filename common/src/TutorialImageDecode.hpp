@@ -0,0 +1,66 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_IMAGE_DECODE_HPP
+#define TUTORIAL_IMAGE_DECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A decoded image, tightly packed RGBA8 rows. pixels_ holds mipLevels_
+// levels back to back, level 0 first.
+struct TutorialImage {
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t mipLevels_;
+  std::vector<uint8_t> pixels_;
+};
+
+// TutorialImageDecoder:
+//   A backend for tutorialDecodeImage(). Decode() fills level 0 of image
+//   with RGBA8 pixels whatever the channel count of the file, and returns
+//   false on anything it does not read, corrupt or merely unsupported.
+//   Decoders hold no state and are called from any thread.
+class TutorialImageDecoder {
+ public:
+  virtual ~TutorialImageDecoder() {}
+  virtual const char* Name(void) const = 0;
+  virtual bool Decode(const void* data, size_t size,
+                      TutorialImage* image) const = 0;
+};
+
+// stb_image, which reads every PNG; the default decoder
+const TutorialImageDecoder& tutorialStbImageDecoder(void);
+// Select the decoder tutorialDecodeImage() tries first. Whatever it declines
+// is still decoded by stb_image, so a backend may handle the common cases
+// only. Set it before decoding starts; the decoder must outlive its use.
+void tutorialSetImageDecoder(const TutorialImageDecoder& decoder);
+const TutorialImageDecoder& tutorialImageDecoder(void);
+
+// Decode an encoded (PNG) image held in memory into RGBA8, whatever the
+// channel count of the file, with the selected decoder. Safe to call from
+// any thread.
+bool tutorialDecodeImage(const void* data, size_t size, TutorialImage* image);
+
+// Number of levels in a full mip chain down to 1x1
+uint32_t tutorialMipLevelCount(uint32_t width, uint32_t height);
+// Size and byte offset into TutorialImage::pixels_ of a mip level
+void tutorialMipLevel(const TutorialImage& image, uint32_t level,
+                      uint32_t* width, uint32_t* height, size_t* offset);
+// Append the rest of the mip chain to a single level image, box filtered
+// on the CPU
+void tutorialGenerateMipmaps(TutorialImage* image);
+
+#endif  // TUTORIAL_IMAGE_DECODE_HPP
@@ -0,0 +1,246 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialKtx2.hpp"
+#include <algorithm>
+#include <cstring>
+
+static const uint8_t kKtx2Identifier[12] = {0xAB, 'K',  'T',  'X',
+                                            ' ',  '2',  '0',  0xBB,
+                                            '\r', '\n', 0x1A, '\n'};
+
+// Header layout (all little endian)
+struct Ktx2Header {
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+};
+static const size_t kLevelIndexOffset = kTutorialKtx2HeaderSize;
+static const size_t kLevelIndexEntrySize = 24;
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t ReadU64(const uint8_t* p) {
+  return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+}
+
+static void ReadHeader(const uint8_t* p, Ktx2Header* header) {
+  p += sizeof(kKtx2Identifier);
+  header->vkFormat = ReadU32(p + 0);
+  header->typeSize = ReadU32(p + 4);
+  header->pixelWidth = ReadU32(p + 8);
+  header->pixelHeight = ReadU32(p + 12);
+  header->pixelDepth = ReadU32(p + 16);
+  header->layerCount = ReadU32(p + 20);
+  header->faceCount = ReadU32(p + 24);
+  header->levelCount = ReadU32(p + 28);
+  header->supercompressionScheme = ReadU32(p + 32);
+}
+
+bool tutorialFormatBlockInfo(uint32_t vkFormat, uint32_t* blockWidth,
+                             uint32_t* blockHeight, uint32_t* blockBytes) {
+  // ASTC LDR, VK_FORMAT_ASTC_4x4_UNORM_BLOCK .. VK_FORMAT_ASTC_12x12_SRGB_BLOCK,
+  // as UNORM/SRGB pairs
+  static const uint8_t kAstcBlocks[][2] = {
+      {4, 4},  {5, 4},  {5, 5},   {6, 5},   {6, 6},   {8, 5},   {8, 6},
+      {8, 8},  {10, 5}, {10, 6},  {10, 8},  {10, 10}, {12, 10}, {12, 12},
+  };
+  if (vkFormat >= 157 && vkFormat <= 184) {
+    *blockWidth = kAstcBlocks[(vkFormat - 157) / 2][0];
+    *blockHeight = kAstcBlocks[(vkFormat - 157) / 2][1];
+    *blockBytes = 16;
+    return true;
+  }
+
+  *blockWidth = *blockHeight = 4;
+  switch (vkFormat) {
+    case 37:  // VK_FORMAT_R8G8B8A8_UNORM
+    case 43:  // VK_FORMAT_R8G8B8A8_SRGB
+    case 44:  // VK_FORMAT_B8G8R8A8_UNORM
+    case 50:  // VK_FORMAT_B8G8R8A8_SRGB
+      *blockWidth = *blockHeight = 1;
+      *blockBytes = 4;
+      return true;
+    case 131:  // VK_FORMAT_BC1_RGB_UNORM_BLOCK .. BC1_RGBA_SRGB_BLOCK
+    case 132:
+    case 133:
+    case 134:
+    case 139:  // VK_FORMAT_BC4_UNORM_BLOCK, BC4_SNORM_BLOCK
+    case 140:
+    case 147:  // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK .. ETC2_R8G8B8A1_SRGB_BLOCK
+    case 148:
+    case 149:
+    case 150:
+    case 153:  // VK_FORMAT_EAC_R11_UNORM_BLOCK, EAC_R11_SNORM_BLOCK
+    case 154:
+      *blockBytes = 8;
+      return true;
+    case 135:  // VK_FORMAT_BC2_UNORM_BLOCK .. BC3_SRGB_BLOCK
+    case 136:
+    case 137:
+    case 138:
+    case 141:  // VK_FORMAT_BC5_UNORM_BLOCK, BC5_SNORM_BLOCK
+    case 142:
+    case 145:  // VK_FORMAT_BC7_UNORM_BLOCK, BC7_SRGB_BLOCK
+    case 146:
+    case 151:  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, .._SRGB_BLOCK
+    case 152:
+    case 155:  // VK_FORMAT_EAC_R11G11_UNORM_BLOCK, .._SNORM_BLOCK
+    case 156:
+      *blockBytes = 16;
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t tutorialLevelSize(uint32_t width, uint32_t height, uint32_t blockWidth,
+                         uint32_t blockHeight, uint32_t blockBytes) {
+  size_t blocksWide = (width + blockWidth - 1) / blockWidth;
+  size_t blocksHigh = (height + blockHeight - 1) / blockHeight;
+  return blocksWide * blocksHigh * blockBytes;
+}
+
+bool tutorialIsKtx2(const void* data, size_t size) {
+  return data && size >= sizeof(kKtx2Identifier) &&
+         !memcmp(data, kKtx2Identifier, sizeof(kKtx2Identifier));
+}
+
+bool tutorialKtx2Format(const void* data, size_t size, uint32_t* vkFormat) {
+  if (size < kTutorialKtx2HeaderSize || !tutorialIsKtx2(data, size)) {
+    return false;
+  }
+  Ktx2Header header;
+  ReadHeader(static_cast<const uint8_t*>(data), &header);
+  *vkFormat = header.vkFormat;
+  return true;
+}
+
+bool tutorialParseKtx2(const void* data, size_t size, TutorialKtx2Image* image,
+                       std::string* error) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  if (size < kTutorialKtx2HeaderSize || !tutorialIsKtx2(data, size)) {
+    *error = "not a KTX2 file";
+    return false;
+  }
+  Ktx2Header header;
+  ReadHeader(bytes, &header);
+
+  if (header.supercompressionScheme != 0) {
+    *error = "supercompressed (scheme " +
+             std::to_string(header.supercompressionScheme) +
+             "), not supported";
+    return false;
+  }
+  if (header.pixelWidth == 0 || header.pixelHeight == 0 ||
+      header.pixelDepth != 0) {
+    *error = "not a 2D texture";
+    return false;
+  }
+  if (header.layerCount > 1 || header.faceCount != 1) {
+    *error = "arrays and cube maps are not supported";
+    return false;
+  }
+  if (!tutorialFormatBlockInfo(header.vkFormat, &image->blockWidth_,
+                               &image->blockHeight_, &image->blockBytes_)) {
+    *error = "unsupported VkFormat " + std::to_string(header.vkFormat);
+    return false;
+  }
+
+  // levelCount 0 asks the loader to generate mipmaps; only the base level is
+  // in the file then
+  uint32_t levelCount = std::max(header.levelCount, 1u);
+  uint32_t maxLevels = 1;
+  for (uint32_t s = std::max(header.pixelWidth, header.pixelHeight); s > 1;
+       s >>= 1) {
+    maxLevels++;
+  }
+  if (levelCount > maxLevels) {
+    *error = "more levels than a full mip chain";
+    return false;
+  }
+  if (kLevelIndexOffset + levelCount * kLevelIndexEntrySize > size) {
+    *error = "truncated level index";
+    return false;
+  }
+
+  image->vkFormat_ = header.vkFormat;
+  image->width_ = header.pixelWidth;
+  image->height_ = header.pixelHeight;
+  image->levels_.resize(levelCount);
+  // Level data must start on a multiple of lcm(block size, 4)
+  const size_t alignment = std::max<size_t>(image->blockBytes_, 4);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const uint8_t* entry = bytes + kLevelIndexOffset +
+                           level * kLevelIndexEntrySize;
+    uint64_t offset = ReadU64(entry);
+    uint64_t length = ReadU64(entry + 8);
+    TutorialKtx2Level& out = image->levels_[level];
+    out.width_ = std::max(header.pixelWidth >> level, 1u);
+    out.height_ = std::max(header.pixelHeight >> level, 1u);
+    size_t expected =
+        tutorialLevelSize(out.width_, out.height_, image->blockWidth_,
+                          image->blockHeight_, image->blockBytes_);
+
+    if (length != expected) {
+      *error = "level " + std::to_string(level) + " is " +
+               std::to_string(length) + " bytes, expected " +
+               std::to_string(expected);
+      return false;
+    }
+    if (offset > size || length > size - offset) {
+      *error = "level " + std::to_string(level) + " is past the end of file";
+      return false;
+    }
+    if (offset % alignment) {
+      *error = "level " + std::to_string(level) + " is misaligned";
+      return false;
+    }
+    out.offset_ = static_cast<size_t>(offset);
+    out.size_ = static_cast<size_t>(length);
+  }
+  return true;
+}
+
+bool tutorialSplitLevel(uint32_t width, uint32_t height, uint32_t blockWidth,
+                        uint32_t blockHeight, uint32_t blockBytes,
+                        size_t maxBandBytes,
+                        std::vector<TutorialCopyBand>* bands) {
+  const size_t rowBytes =
+      static_cast<size_t>((width + blockWidth - 1) / blockWidth) * blockBytes;
+  const uint32_t blockRows = (height + blockHeight - 1) / blockHeight;
+  if (rowBytes > maxBandBytes) return false;
+  const uint32_t bandBlockRows = static_cast<uint32_t>(
+      std::min<size_t>(blockRows, maxBandBytes / rowBytes));
+
+  bands->clear();
+  for (uint32_t row = 0; row < blockRows; row += bandBlockRows) {
+    uint32_t rows = std::min(bandBlockRows, blockRows - row);
+    TutorialCopyBand band;
+    band.y_ = row * blockHeight;
+    band.height_ = std::min(rows * blockHeight, height - band.y_);
+    band.offset_ = row * rowBytes;
+    band.size_ = rows * rowBytes;
+    bands->push_back(band);
+  }
+  return true;
+}
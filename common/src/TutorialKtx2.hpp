@@ -0,0 +1,87 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_KTX2_HPP
+#define TUTORIAL_KTX2_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// KTX2 (Khronos texture container 2.0) parsing, for textures stored in the
+// GPU's own format, pre-built mip levels included: nothing to decode, each
+// level is copied to the image as is.
+// Formats are VkFormat values held in a uint32_t, so this also builds on
+// hosts without the Vulkan headers (see tools/ktx2_info).
+// Supported: 2D textures, one layer, one face, no supercompression, in
+// RGBA8, BGRA8 or an ETC2/EAC, BC or ASTC LDR block format.
+
+// Byte range of one mip level inside the file
+struct TutorialKtx2Level {
+  size_t offset_;
+  size_t size_;
+  uint32_t width_;   // texels
+  uint32_t height_;
+};
+
+struct TutorialKtx2Image {
+  uint32_t vkFormat_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t blockWidth_;  // texels per block, 1 x 1 for uncompressed formats
+  uint32_t blockHeight_;
+  uint32_t blockBytes_;
+  std::vector<TutorialKtx2Level> levels_;  // level 0 (largest) first
+};
+
+// Size of the fixed KTX2 header; enough bytes for tutorialKtx2Format()
+static const size_t kTutorialKtx2HeaderSize = 80;
+
+// True if data starts with the KTX2 identifier
+bool tutorialIsKtx2(const void* data, size_t size);
+
+// Read the VkFormat of a KTX2 file from its first kTutorialKtx2HeaderSize
+// bytes, to pick a file without loading it
+bool tutorialKtx2Format(const void* data, size_t size, uint32_t* vkFormat);
+
+// Parse and validate a whole KTX2 file held in memory. Level offsets refer
+// to data, which must outlive their use. On failure, error says why.
+bool tutorialParseKtx2(const void* data, size_t size, TutorialKtx2Image* image,
+                       std::string* error);
+
+// Block size of the formats above; false for anything else
+bool tutorialFormatBlockInfo(uint32_t vkFormat, uint32_t* blockWidth,
+                             uint32_t* blockHeight, uint32_t* blockBytes);
+
+// Bytes of a tightly packed width x height level in that block format
+size_t tutorialLevelSize(uint32_t width, uint32_t height, uint32_t blockWidth,
+                         uint32_t blockHeight, uint32_t blockBytes);
+
+// Upload layout: a level is copied with one vkCmdCopyBufferToImage per band
+// of whole block rows, each band small enough for the staging buffer.
+struct TutorialCopyBand {
+  uint32_t y_;       // first texel row
+  uint32_t height_;  // texel rows, clamped to the level height
+  size_t offset_;    // bytes into the level data
+  size_t size_;
+};
+// Split a width x height level into bands of at most maxBandBytes. Returns
+// false if not even one row of blocks fits.
+bool tutorialSplitLevel(uint32_t width, uint32_t height, uint32_t blockWidth,
+                        uint32_t blockHeight, uint32_t blockBytes,
+                        size_t maxBandBytes,
+                        std::vector<TutorialCopyBand>* bands);
+
+#endif  // TUTORIAL_KTX2_HPP
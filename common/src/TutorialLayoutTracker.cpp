@@ -0,0 +1,170 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialLayoutTracker.hpp"
+#include <android/log.h>
+#include <cassert>
+
+static const char* kLayoutTAG = "Vulkan-Layouts";
+#define LAYOUT_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kLayoutTAG, __VA_ARGS__))
+
+static const VkAccessFlags kWriteAccess =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+TutorialLayoutTracker::TutorialLayoutTracker()
+    : srcStages_(0),
+      dstStages_(0),
+      debug_(false),
+      barrierCount_(0),
+      redundantCount_(0) {}
+
+void TutorialLayoutTracker::Track(VkImage image, uint32_t mipLevels,
+                                  uint32_t layers,
+                                  const TutorialImageUse& use) {
+  Image& tracked = images_[image];
+  tracked.mipLevels_ = mipLevels;
+  tracked.layers_ = layers;
+  tracked.states_.assign(mipLevels * layers, use);
+}
+
+void TutorialLayoutTracker::Forget(VkImage image) { images_.erase(image); }
+
+bool TutorialLayoutTracker::Tracked(VkImage image) const {
+  return images_.count(image) != 0;
+}
+
+const TutorialImageUse& TutorialLayoutTracker::State(VkImage image,
+                                                     uint32_t level,
+                                                     uint32_t layer) const {
+  auto it = images_.find(image);
+  assert(it != images_.end() && "image is not tracked");
+  const Image& tracked = it->second;
+  assert(level < tracked.mipLevels_ && layer < tracked.layers_);
+  return tracked.states_[layer * tracked.mipLevels_ + level];
+}
+
+void TutorialLayoutTracker::Queue(const VkImageMemoryBarrier& barrier) {
+  if (!barriers_.empty()) {
+    VkImageMemoryBarrier& last = barriers_.back();
+    VkImageSubresourceRange& range = last.subresourceRange;
+    const VkImageSubresourceRange& next = barrier.subresourceRange;
+    if (last.image == barrier.image && last.oldLayout == barrier.oldLayout &&
+        last.newLayout == barrier.newLayout &&
+        last.srcAccessMask == barrier.srcAccessMask &&
+        last.dstAccessMask == barrier.dstAccessMask) {
+      if (range.baseArrayLayer == next.baseArrayLayer &&
+          range.layerCount == next.layerCount &&
+          range.baseMipLevel + range.levelCount == next.baseMipLevel) {
+        range.levelCount += next.levelCount;
+        return;
+      }
+      if (range.baseMipLevel == next.baseMipLevel &&
+          range.levelCount == next.levelCount &&
+          range.baseArrayLayer + range.layerCount == next.baseArrayLayer) {
+        range.layerCount += next.layerCount;
+        return;
+      }
+    }
+  }
+  barriers_.push_back(barrier);
+}
+
+void TutorialLayoutTracker::Use(VkImage image, const TutorialImageUse& use,
+                                uint32_t baseLevel, uint32_t levelCount,
+                                uint32_t baseLayer, uint32_t layerCount) {
+  auto it = images_.find(image);
+  assert(it != images_.end() && "image is not tracked");
+  Image& tracked = it->second;
+  if (levelCount == VK_REMAINING_MIP_LEVELS) {
+    levelCount = tracked.mipLevels_ - baseLevel;
+  }
+  if (layerCount == VK_REMAINING_ARRAY_LAYERS) {
+    layerCount = tracked.layers_ - baseLayer;
+  }
+  assert(baseLevel + levelCount <= tracked.mipLevels_ &&
+         baseLayer + layerCount <= tracked.layers_);
+
+  bool queued = false;
+  for (uint32_t layer = baseLayer; layer < baseLayer + layerCount; layer++) {
+    // consecutive levels coming from the same use share a barrier
+    VkImageMemoryBarrier run{};
+    for (uint32_t level = baseLevel; level < baseLevel + levelCount;
+         level++) {
+      TutorialImageUse& state =
+          tracked.states_[layer * tracked.mipLevels_ + level];
+      const bool transition = state.layout_ != use.layout_;
+      const bool hazard = (state.access_ & kWriteAccess) ||
+                          ((use.access_ & kWriteAccess) && state.access_);
+      if (!transition && !hazard) {
+        // reads after reads: the next write has to wait for all of them
+        state.access_ |= use.access_;
+        state.stages_ |= use.stages_;
+        continue;
+      }
+
+      if (run.subresourceRange.levelCount &&
+          (run.oldLayout != state.layout_ ||
+           run.srcAccessMask != (state.access_ & kWriteAccess) ||
+           run.subresourceRange.baseMipLevel +
+                   run.subresourceRange.levelCount != level)) {
+        Queue(run);
+        run.subresourceRange.levelCount = 0;
+      }
+      if (!run.subresourceRange.levelCount) {
+        run = VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            // only writes need to be made available
+            .srcAccessMask = state.access_ & kWriteAccess,
+            .dstAccessMask = use.access_,
+            .oldLayout = state.layout_,
+            .newLayout = use.layout_,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layer,
+                                 1},
+        };
+      }
+      run.subresourceRange.levelCount++;
+      srcStages_ |= state.stages_;
+      dstStages_ |= use.stages_;
+      state = use;
+      queued = true;
+    }
+    if (run.subresourceRange.levelCount) Queue(run);
+  }
+
+  if (!queued) {
+    redundantCount_++;
+    if (debug_) {
+      LAYOUT_LOGI("redundant transition: image 0x%llx is already in layout %d",
+                  (unsigned long long)image, use.layout_);
+    }
+  }
+}
+
+void TutorialLayoutTracker::Flush(VkCommandBuffer cmd) {
+  if (barriers_.empty()) return;
+  vkCmdPipelineBarrier(cmd, srcStages_, dstStages_, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers_.size()),
+                       barriers_.data());
+  barriers_.clear();
+  srcStages_ = dstStages_ = 0;
+  barrierCount_++;
+}
@@ -0,0 +1,124 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_LAYOUT_TRACKER_HPP
+#define TUTORIAL_LAYOUT_TRACKER_HPP
+
+#include <vulkan_wrapper.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// How an image is used: the layout it has to be in, and the accesses and
+// pipeline stages of the use
+struct TutorialImageUse {
+  VkImageLayout layout_;
+  VkAccessFlags access_;
+  VkPipelineStageFlags stages_;
+};
+
+// Contents not needed, eg. a new image
+static const TutorialImageUse kTutorialUseUndefined = {
+    VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+// A swapchain image just acquired, its semaphore waited on at
+// COLOR_ATTACHMENT_OUTPUT; the last frame's contents are not needed
+static const TutorialImageUse kTutorialUseAcquired = {
+    VK_IMAGE_LAYOUT_UNDEFINED, 0,
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+static const TutorialImageUse kTutorialUsePresent = {
+    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT};
+static const TutorialImageUse kTutorialUseColorAttachment = {
+    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+static const TutorialImageUse kTutorialUseTransferDst = {
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT};
+static const TutorialImageUse kTutorialUseTransferSrc = {
+    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT};
+// Sampled in fragment shaders
+static const TutorialImageUse kTutorialUseSampled = {
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+
+// TutorialLayoutTracker:
+//   Know the layout of every image instead of passing old layouts, access
+//   masks and stages by hand. The tracker keeps the last use of each mip
+//   level and array layer; Use() works out the barrier that going from it
+//   to the next use takes:
+//   - a layout transition when the layouts differ
+//   - a dependency on earlier writes, or of a write on earlier reads
+//   - nothing when both uses read the same layout
+//   Barriers are queued and recorded by Flush(), all of them in a single
+//   vkCmdPipelineBarrier: call Use() for everything a pass needs, then
+//   Flush() once into the command buffer.
+//   The state follows the order commands are recorded in, which is the
+//   order they run in only for command buffers submitted in that order.
+//   Prerecorded command buffers replayed every frame should leave each
+//   image the way they found it, or Track() it again before recording.
+//   In debug mode every Use() with nothing to do is logged: such a
+//   transition was redundant.
+class TutorialLayoutTracker {
+ public:
+  TutorialLayoutTracker();
+
+  void SetDebug(bool debug) { debug_ = debug; }
+
+  // Start, or start over, tracking an image of mipLevels levels and layers
+  // array layers, all of them last used as use. Nothing is recorded: it is
+  // for new images, and for images whose layout changed elsewhere (upload
+  // batches, render pass final layouts).
+  void Track(VkImage image, uint32_t mipLevels, uint32_t layers,
+             const TutorialImageUse& use);
+  // Stop tracking a destroyed image
+  void Forget(VkImage image);
+  bool Tracked(VkImage image) const;
+  // Last use of one level of one layer of a tracked image
+  const TutorialImageUse& State(VkImage image, uint32_t level = 0,
+                                uint32_t layer = 0) const;
+
+  // The levels and layers given of image are going to be used as use:
+  // queue the barrier that takes, if any
+  void Use(VkImage image, const TutorialImageUse& use, uint32_t baseLevel = 0,
+           uint32_t levelCount = VK_REMAINING_MIP_LEVELS,
+           uint32_t baseLayer = 0,
+           uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS);
+  // Record the queued barriers into cmd, if any
+  void Flush(VkCommandBuffer cmd);
+
+  // Barriers recorded, and Use() calls that needed none, so far
+  uint32_t BarrierCount(void) const { return barrierCount_; }
+  uint32_t RedundantCount(void) const { return redundantCount_; }
+
+ private:
+  struct Image {
+    uint32_t mipLevels_;
+    uint32_t layers_;
+    std::vector<TutorialImageUse> states_;  // layer * mipLevels_ + level
+  };
+  // Queue one barrier, merged into the last one when it continues its
+  // levels or layers
+  void Queue(const VkImageMemoryBarrier& barrier);
+
+  std::unordered_map<VkImage, Image> images_;
+  std::vector<VkImageMemoryBarrier> barriers_;
+  VkPipelineStageFlags srcStages_;
+  VkPipelineStageFlags dstStages_;
+  bool debug_;
+  uint32_t barrierCount_;
+  uint32_t redundantCount_;
+};
+
+#endif  // TUTORIAL_LAYOUT_TRACKER_HPP
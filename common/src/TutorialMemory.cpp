@@ -0,0 +1,388 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialMemory.hpp"
+#include <android/log.h>
+#include <cassert>
+#include <iterator>
+
+static const char* kMemoryTAG = "Vulkan-Memory";
+#define MEM_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kMemoryTAG, __VA_ARGS__))
+#define MEM_LOGW(...) \
+  ((void)__android_log_print(ANDROID_LOG_WARN, kMemoryTAG, __VA_ARGS__))
+#define MEM_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kMemoryTAG, __VA_ARGS__))
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return alignment ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+static VkDeviceSize AlignDown(VkDeviceSize value, VkDeviceSize alignment) {
+  return alignment ? value / alignment * alignment : value;
+}
+
+// Whether two byte offsets fall into the same bufferImageGranularity "page"
+static bool SamePage(VkDeviceSize a, VkDeviceSize b, VkDeviceSize pageSize) {
+  return AlignDown(a, pageSize) == AlignDown(b, pageSize);
+}
+
+TutorialMemoryAllocator::TutorialMemoryAllocator()
+    : gpu_(VK_NULL_HANDLE),
+      device_(VK_NULL_HANDLE),
+      blockSize_(kDefaultBlockSize),
+      granularity_(1),
+      nonCoherentAtomSize_(1),
+      maxAllocationCount_(0) {}
+
+TutorialMemoryAllocator::~TutorialMemoryAllocator() {
+  assert(device_ == VK_NULL_HANDLE && "Destroy() was not called");
+}
+
+void TutorialMemoryAllocator::Init(VkPhysicalDevice gpu, VkDevice device,
+                                   VkDeviceSize blockSize) {
+  gpu_ = gpu;
+  device_ = device;
+  blockSize_ = blockSize;
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(gpu_, &props);
+  granularity_ = props.limits.bufferImageGranularity;
+  nonCoherentAtomSize_ = props.limits.nonCoherentAtomSize;
+  maxAllocationCount_ = props.limits.maxMemoryAllocationCount;
+  memoryTypes_.Init(gpu_);
+  memoryTypes_.LogMemoryTypes();
+}
+
+void TutorialMemoryAllocator::Destroy(void) {
+  if (device_ == VK_NULL_HANDLE) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  uint32_t leaks = 0;
+  VkDeviceSize leakedBytes = 0;
+  for (uint32_t i = 0; i < blocks_.size(); i++) {
+    Block& block = blocks_[i];
+    if (block.memory_ == VK_NULL_HANDLE) continue;
+    for (auto& range : block.ranges_) {
+      if (range.second.free_) continue;
+      MEM_LOGE("leak: \"%s\", %llu bytes at offset %llu of block %u "
+               "(memory type %u)",
+               range.second.name_.c_str(),
+               static_cast<unsigned long long>(range.second.size_),
+               static_cast<unsigned long long>(range.first), i,
+               block.memoryType_);
+      leaks++;
+      leakedBytes += range.second.size_;
+    }
+    if (block.mapped_) vkUnmapMemory(device_, block.memory_);
+    vkFreeMemory(device_, block.memory_, nullptr);
+  }
+  if (leaks) {
+    MEM_LOGE("%u allocation(s), %llu bytes still alive at shutdown", leaks,
+             static_cast<unsigned long long>(leakedBytes));
+  }
+  blocks_.clear();
+  device_ = VK_NULL_HANDLE;
+}
+
+VkResult TutorialMemoryAllocator::CreateBlock(uint32_t memoryType,
+                                              VkDeviceSize size,
+                                              uint32_t* blockIndex) {
+  uint32_t liveBlocks = 0;
+  uint32_t slot = static_cast<uint32_t>(blocks_.size());
+  for (uint32_t i = 0; i < blocks_.size(); i++) {
+    if (blocks_[i].memory_ != VK_NULL_HANDLE) {
+      liveBlocks++;
+    } else if (slot == blocks_.size()) {
+      slot = i;
+    }
+  }
+  if (maxAllocationCount_ && liveBlocks >= maxAllocationCount_) {
+    MEM_LOGE("maxMemoryAllocationCount (%u) reached", maxAllocationCount_);
+    return VK_ERROR_TOO_MANY_OBJECTS;
+  }
+
+  VkMemoryAllocateInfo allocInfo{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .allocationSize = size,
+      .memoryTypeIndex = memoryType,
+  };
+  VkDeviceMemory memory;
+  VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+  if (result != VK_SUCCESS) return result;
+
+  void* mapped = nullptr;
+  if (memoryTypes_.Flags(memoryType) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    result = vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    if (result != VK_SUCCESS) {
+      vkFreeMemory(device_, memory, nullptr);
+      return result;
+    }
+  }
+
+  if (slot == blocks_.size()) blocks_.emplace_back();
+  Block& block = blocks_[slot];
+  block.memory_ = memory;
+  block.size_ = size;
+  block.memoryType_ = memoryType;
+  block.mapped_ = static_cast<uint8_t*>(mapped);
+  block.ranges_.clear();
+  block.ranges_[0] = Range{size, true, false, std::string()};
+  block.allocationCount_ = 0;
+  *blockIndex = slot;
+  return VK_SUCCESS;
+}
+
+void TutorialMemoryAllocator::ReleaseBlock(uint32_t blockIndex) {
+  Block& block = blocks_[blockIndex];
+  if (block.mapped_) vkUnmapMemory(device_, block.memory_);
+  vkFreeMemory(device_, block.memory_, nullptr);
+  block.memory_ = VK_NULL_HANDLE;
+  block.mapped_ = nullptr;
+  block.ranges_.clear();
+}
+
+// First fit over the block's free ranges
+bool TutorialMemoryAllocator::AllocateFromBlock(
+    uint32_t blockIndex, const VkMemoryRequirements& requirements, bool linear,
+    const char* name, TutorialAllocation* allocation) {
+  Block& block = blocks_[blockIndex];
+  for (auto it = block.ranges_.begin(); it != block.ranges_.end(); ++it) {
+    if (!it->second.free_ || it->second.size_ < requirements.size) continue;
+    VkDeviceSize start = it->first;
+    VkDeviceSize end = start + it->second.size_;
+    VkDeviceSize offset = AlignUp(start, requirements.alignment);
+
+    // Free ranges are always coalesced, so neighbours are in use. A linear
+    // and a non-linear resource must not share a granularity page.
+    if (it != block.ranges_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second.linear_ != linear &&
+          SamePage(prev->first + prev->second.size_ - 1, offset,
+                   granularity_)) {
+        offset = AlignUp(offset, granularity_);
+      }
+    }
+    if (offset + requirements.size > end) continue;
+    auto next = std::next(it);
+    if (next != block.ranges_.end() && next->second.linear_ != linear &&
+        SamePage(offset + requirements.size - 1, next->first, granularity_)) {
+      continue;
+    }
+
+    // Split: [start, offset) stays free, [offset, offset + size) is taken,
+    // the rest goes back to the free list
+    VkDeviceSize tail = end - (offset + requirements.size);
+    if (offset > start) {
+      it->second.size_ = offset - start;
+      block.ranges_[offset] =
+          Range{requirements.size, false, linear, name ? name : ""};
+    } else {
+      it->second = Range{requirements.size, false, linear, name ? name : ""};
+    }
+    if (tail) {
+      block.ranges_[offset + requirements.size] =
+          Range{tail, true, false, std::string()};
+    }
+    block.allocationCount_++;
+
+    allocation->memory_ = block.memory_;
+    allocation->offset_ = offset;
+    allocation->size_ = requirements.size;
+    allocation->mapped_ = block.mapped_ ? block.mapped_ + offset : nullptr;
+    allocation->memoryType_ = block.memoryType_;
+    allocation->block_ = blockIndex;
+    return true;
+  }
+  return false;
+}
+
+VkResult TutorialMemoryAllocator::Allocate(
+    const VkMemoryRequirements& requirements, const TutorialMemoryUsage& usage,
+    bool linear, const char* name, TutorialAllocation* allocation) {
+  assert(device_ != VK_NULL_HANDLE);
+  uint32_t memoryType;
+  if (!memoryTypes_.Resolve(requirements.memoryTypeBits, usage,
+                            &memoryType)) {
+    MEM_LOGE("no memory type for \"%s\" (type bits 0x%x, required 0x%x, "
+             "forbidden 0x%x)",
+             name ? name : "", requirements.memoryTypeBits, usage.required_,
+             usage.forbidden_);
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (uint32_t i = 0; i < blocks_.size(); i++) {
+    if (blocks_[i].memory_ != VK_NULL_HANDLE &&
+        blocks_[i].memoryType_ == memoryType &&
+        AllocateFromBlock(i, requirements, linear, name, allocation)) {
+      return VK_SUCCESS;
+    }
+  }
+
+  // Resources larger than half a block get a block of their own
+  VkDeviceSize size = blockSize_;
+  if (requirements.size > blockSize_ / 2) {
+    size = AlignUp(requirements.size, granularity_);
+  }
+  uint32_t blockIndex;
+  VkResult result = CreateBlock(memoryType, size, &blockIndex);
+  if (result != VK_SUCCESS) return result;
+  bool allocated =
+      AllocateFromBlock(blockIndex, requirements, linear, name, allocation);
+  assert(allocated);
+  (void)allocated;
+  return VK_SUCCESS;
+}
+
+VkResult TutorialMemoryAllocator::AllocateBuffer(
+    VkBuffer buffer, const TutorialMemoryUsage& usage, const char* name,
+    TutorialAllocation* allocation) {
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device_, buffer, &requirements);
+  VkResult result = Allocate(requirements, usage, true, name, allocation);
+  if (result != VK_SUCCESS) return result;
+  return vkBindBufferMemory(device_, buffer, allocation->memory_,
+                            allocation->offset_);
+}
+
+VkResult TutorialMemoryAllocator::AllocateImage(
+    VkImage image, VkImageTiling tiling, const TutorialMemoryUsage& usage,
+    const char* name, TutorialAllocation* allocation) {
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device_, image, &requirements);
+  VkResult result = Allocate(requirements, usage,
+                             tiling == VK_IMAGE_TILING_LINEAR, name, allocation);
+  if (result != VK_SUCCESS) return result;
+  return vkBindImageMemory(device_, image, allocation->memory_,
+                           allocation->offset_);
+}
+
+void TutorialMemoryAllocator::Free(TutorialAllocation* allocation) {
+  if (allocation->memory_ == VK_NULL_HANDLE) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  assert(allocation->block_ < blocks_.size());
+  Block& block = blocks_[allocation->block_];
+  assert(block.memory_ == allocation->memory_);
+  auto it = block.ranges_.find(allocation->offset_);
+  assert(it != block.ranges_.end() && !it->second.free_);
+
+  it->second.free_ = true;
+  it->second.linear_ = false;
+  it->second.name_.clear();
+  // Coalesce with the following and the preceding free ranges
+  auto next = std::next(it);
+  if (next != block.ranges_.end() && next->second.free_) {
+    it->second.size_ += next->second.size_;
+    block.ranges_.erase(next);
+  }
+  if (it != block.ranges_.begin()) {
+    auto prev = std::prev(it);
+    if (prev->second.free_) {
+      prev->second.size_ += it->second.size_;
+      block.ranges_.erase(it);
+    }
+  }
+
+  // Give empty blocks back to the driver, except the last regular block of
+  // that memory type so allocate/free cycles do not thrash vkAllocateMemory
+  if (--block.allocationCount_ == 0) {
+    bool keep = (block.size_ == blockSize_);
+    if (keep) {
+      for (uint32_t i = 0; i < blocks_.size(); i++) {
+        if (i != allocation->block_ && blocks_[i].memory_ != VK_NULL_HANDLE &&
+            blocks_[i].memoryType_ == block.memoryType_ &&
+            blocks_[i].size_ == blockSize_) {
+          keep = false;
+          break;
+        }
+      }
+    }
+    if (!keep) ReleaseBlock(allocation->block_);
+  }
+
+  allocation->memory_ = VK_NULL_HANDLE;
+  allocation->mapped_ = nullptr;
+}
+
+void TutorialMemoryAllocator::Flush(const TutorialAllocation& allocation) {
+  Flush(allocation, 0, allocation.size_);
+}
+
+void TutorialMemoryAllocator::Flush(const TutorialAllocation& allocation,
+                                    VkDeviceSize offset, VkDeviceSize size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (memoryTypes_.Flags(allocation.memoryType_) &
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+    return;
+  }
+  // Flushed ranges must be multiples of nonCoherentAtomSize, or reach the
+  // end of the memory object
+  const Block& block = blocks_[allocation.block_];
+  VkDeviceSize begin =
+      AlignDown(allocation.offset_ + offset, nonCoherentAtomSize_);
+  VkDeviceSize end =
+      AlignUp(allocation.offset_ + offset + size, nonCoherentAtomSize_);
+  VkMappedMemoryRange range{
+      .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+      .pNext = nullptr,
+      .memory = allocation.memory_,
+      .offset = begin,
+      .size = (end >= block.size_) ? VK_WHOLE_SIZE : end - begin,
+  };
+  vkFlushMappedMemoryRanges(device_, 1, &range);
+}
+
+TutorialMemoryStats TutorialMemoryAllocator::GetStats(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TutorialMemoryStats stats{};
+  VkDeviceSize freeBytes = 0;
+  for (auto& block : blocks_) {
+    if (block.memory_ == VK_NULL_HANDLE) continue;
+    stats.blockCount_++;
+    stats.blockBytes_ += block.size_;
+    stats.allocationCount_ += block.allocationCount_;
+    for (auto& range : block.ranges_) {
+      if (range.second.free_) {
+        stats.freeRangeCount_++;
+        freeBytes += range.second.size_;
+        if (range.second.size_ > stats.largestFreeRange_) {
+          stats.largestFreeRange_ = range.second.size_;
+        }
+      } else {
+        stats.usedBytes_ += range.second.size_;
+      }
+    }
+  }
+  stats.fragmentation_ =
+      freeBytes ? 1.0f - static_cast<float>(stats.largestFreeRange_) /
+                             static_cast<float>(freeBytes)
+                : 0.0f;
+  return stats;
+}
+
+void TutorialMemoryAllocator::LogStats(void) {
+  TutorialMemoryStats stats = GetStats();
+  MEM_LOGI("%u block(s), %llu KB reserved, %u allocation(s), %llu KB used, "
+           "%u free range(s), largest %llu KB, fragmentation %.2f",
+           stats.blockCount_,
+           static_cast<unsigned long long>(stats.blockBytes_ / 1024),
+           stats.allocationCount_,
+           static_cast<unsigned long long>(stats.usedBytes_ / 1024),
+           stats.freeRangeCount_,
+           static_cast<unsigned long long>(stats.largestFreeRange_ / 1024),
+           stats.fragmentation_);
+}
@@ -0,0 +1,131 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_MEMORY_HPP
+#define TUTORIAL_MEMORY_HPP
+
+#include <vulkan_wrapper.h>
+#include "TutorialMemoryType.hpp"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A piece of device memory handed out by TutorialMemoryAllocator.
+// Bind with (memory_, offset_); mapped_ is the persistently mapped host
+// address of offset_, nullptr for memory the host cannot see.
+struct TutorialAllocation {
+  VkDeviceMemory memory_;
+  VkDeviceSize offset_;
+  VkDeviceSize size_;
+  void* mapped_;
+  uint32_t memoryType_;
+  uint32_t block_;
+};
+
+struct TutorialMemoryStats {
+  uint32_t blockCount_;       // live vkAllocateMemory allocations
+  uint32_t allocationCount_;  // live sub-allocations
+  VkDeviceSize blockBytes_;   // device memory reserved from the driver
+  VkDeviceSize usedBytes_;    // bytes handed out, alignment padding included
+  uint32_t freeRangeCount_;   // entries in the free lists
+  VkDeviceSize largestFreeRange_;
+  // 0 when all free space is one range, close to 1 when it is scattered in
+  // small holes, ie. when defragmentation would pay off
+  float fragmentation_;
+};
+
+// TutorialMemoryAllocator:
+//   Reserve large blocks of device memory per memory type and sub-allocate
+//   buffers and images out of them, instead of one vkAllocateMemory per
+//   resource. Memory types are picked by TutorialMemoryTypeResolver.
+//   Each block keeps its ranges sorted by offset; free ranges are coalesced
+//   on release. Linear resources (buffers, linear images) and optimal images
+//   are kept bufferImageGranularity apart.
+//   Host visible blocks are mapped once, for their whole lifetime.
+//   Destroy() reports every allocation still alive (leaks) before freeing
+//   the blocks.
+class TutorialMemoryAllocator {
+ public:
+  TutorialMemoryAllocator();
+  ~TutorialMemoryAllocator();
+
+  void Init(VkPhysicalDevice gpu, VkDevice device,
+            VkDeviceSize blockSize = kDefaultBlockSize);
+  void Destroy(void);
+
+  // Allocate memory for (and bind it to) a buffer or an image, from the
+  // memory type best matching usage. name shows up in the leak report.
+  VkResult AllocateBuffer(VkBuffer buffer, const TutorialMemoryUsage& usage,
+                          const char* name, TutorialAllocation* allocation);
+  VkResult AllocateImage(VkImage image, VkImageTiling tiling,
+                         const TutorialMemoryUsage& usage, const char* name,
+                         TutorialAllocation* allocation);
+  // Raw sub-allocation, the caller binds the memory itself
+  VkResult Allocate(const VkMemoryRequirements& requirements,
+                    const TutorialMemoryUsage& usage, bool linear,
+                    const char* name, TutorialAllocation* allocation);
+  void Free(TutorialAllocation* allocation);
+
+  // Make host writes visible to the device; no-op on coherent memory
+  void Flush(const TutorialAllocation& allocation);
+  // Same for size bytes at offset, relative to the allocation
+  void Flush(const TutorialAllocation& allocation, VkDeviceSize offset,
+             VkDeviceSize size);
+
+  TutorialMemoryStats GetStats(void);
+  const TutorialMemoryTypeResolver& MemoryTypes(void) const {
+    return memoryTypes_;
+  }
+  void LogStats(void);
+
+  static const VkDeviceSize kDefaultBlockSize = 16 * 1024 * 1024;
+
+ private:
+  struct Range {
+    VkDeviceSize size_;
+    bool free_;
+    bool linear_;
+    std::string name_;
+  };
+  struct Block {
+    VkDeviceMemory memory_;
+    VkDeviceSize size_;
+    uint32_t memoryType_;
+    uint8_t* mapped_;
+    std::map<VkDeviceSize, Range> ranges_;  // keyed by offset
+    uint32_t allocationCount_;
+  };
+
+  bool AllocateFromBlock(uint32_t blockIndex,
+                         const VkMemoryRequirements& requirements, bool linear,
+                         const char* name, TutorialAllocation* allocation);
+  VkResult CreateBlock(uint32_t memoryType, VkDeviceSize size,
+                       uint32_t* blockIndex);
+  void ReleaseBlock(uint32_t blockIndex);
+
+  VkPhysicalDevice gpu_;
+  VkDevice device_;
+  VkDeviceSize blockSize_;
+  VkDeviceSize granularity_;
+  VkDeviceSize nonCoherentAtomSize_;
+  uint32_t maxAllocationCount_;
+  TutorialMemoryTypeResolver memoryTypes_;
+  // released blocks keep their slot (memory_ == VK_NULL_HANDLE) so the
+  // block index stored in live allocations stays valid
+  std::vector<Block> blocks_;
+  std::mutex mutex_;
+};
+
+#endif  // TUTORIAL_MEMORY_HPP
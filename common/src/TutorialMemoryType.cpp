@@ -0,0 +1,97 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialMemoryType.hpp"
+#include <android/log.h>
+
+static const char* kMemoryTypeTAG = "Vulkan-Memory";
+
+static uint32_t CountBits(uint32_t value) {
+  uint32_t count = 0;
+  for (; value; value &= value - 1) count++;
+  return count;
+}
+
+bool tutorialFindMemoryType(const VkPhysicalDeviceMemoryProperties& properties,
+                            uint32_t typeBits, const TutorialMemoryUsage& usage,
+                            uint32_t* typeIndex) {
+  // Lazily allocated memory only backs transient attachments and protected
+  // memory needs a protected queue: never hand them out by accident
+  const VkMemoryPropertyFlags forbidden =
+      usage.forbidden_ | ((VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT |
+                           VK_MEMORY_PROPERTY_PROTECTED_BIT) &
+                          ~usage.required_);
+  const VkMemoryPropertyFlags scored =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+  bool found = false;
+  uint64_t bestScore = 0;
+  for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = properties.memoryTypes[i].propertyFlags;
+    if (!(typeBits & (1u << i)) ||
+        (flags & usage.required_) != usage.required_ || (flags & forbidden)) {
+      continue;
+    }
+    uint64_t preferred = CountBits(flags & usage.preferred_);
+    uint64_t unwanted =
+        CountBits(flags & scored & ~(usage.required_ | usage.preferred_));
+    uint64_t heapMB =
+        properties.memoryHeaps[properties.memoryTypes[i].heapIndex].size >> 20;
+    if (heapMB > 0xffffffffull) heapMB = 0xffffffffull;
+
+    uint64_t score = (preferred << 40) | ((8 - unwanted) << 32) | heapMB;
+    if (!found || score > bestScore) {
+      found = true;
+      bestScore = score;
+      *typeIndex = i;
+    }
+  }
+  return found;
+}
+
+TutorialMemoryTypeResolver::TutorialMemoryTypeResolver()
+    : properties_(), uma_(false) {}
+
+void TutorialMemoryTypeResolver::Init(VkPhysicalDevice gpu) {
+  vkGetPhysicalDeviceMemoryProperties(gpu, &properties_);
+  uma_ = false;
+  const VkMemoryPropertyFlags unified = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  for (uint32_t i = 0; i < properties_.memoryTypeCount; i++) {
+    if ((properties_.memoryTypes[i].propertyFlags & unified) == unified) {
+      uma_ = true;
+    }
+  }
+}
+
+void TutorialMemoryTypeResolver::LogMemoryTypes(void) const {
+  for (uint32_t i = 0; i < properties_.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = properties_.memoryTypes[i].propertyFlags;
+    uint32_t heap = properties_.memoryTypes[i].heapIndex;
+    __android_log_print(
+        ANDROID_LOG_INFO, kMemoryTypeTAG,
+        "memory type %u: heap %u (%llu MB)%s%s%s%s%s", i, heap,
+        static_cast<unsigned long long>(properties_.memoryHeaps[heap].size >>
+                                        20),
+        (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? " DEVICE_LOCAL" : "",
+        (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? " HOST_VISIBLE" : "",
+        (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? " HOST_COHERENT" : "",
+        (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? " HOST_CACHED" : "",
+        (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ? " LAZY" : "");
+  }
+  __android_log_print(ANDROID_LOG_INFO, kMemoryTypeTAG, "%s memory",
+                      uma_ ? "unified" : "discrete");
+}
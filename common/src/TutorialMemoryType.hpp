@@ -0,0 +1,86 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_MEMORY_TYPE_HPP
+#define TUTORIAL_MEMORY_TYPE_HPP
+
+#include <vulkan_wrapper.h>
+
+// What a resource needs from its memory:
+//   required_:  the memory type must have all of these
+//   preferred_: each one present makes the type more attractive
+//   forbidden_: the memory type must have none of these
+// A plain VkMemoryPropertyFlags converts to "required only".
+struct TutorialMemoryUsage {
+  TutorialMemoryUsage(VkMemoryPropertyFlags required = 0,
+                      VkMemoryPropertyFlags preferred = 0,
+                      VkMemoryPropertyFlags forbidden = 0)
+      : required_(required), preferred_(preferred), forbidden_(forbidden) {}
+
+  VkMemoryPropertyFlags required_;
+  VkMemoryPropertyFlags preferred_;
+  VkMemoryPropertyFlags forbidden_;
+};
+
+// Only ever touched by the GPU: render targets, optimal tiling textures
+static const TutorialMemoryUsage kTutorialMemoryGpuOnly(
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+// Written by the CPU, read by the GPU in place (vertex buffers, linear
+// textures). On UMA devices this lands in DEVICE_LOCAL | HOST_VISIBLE
+// memory, so there is no staging copy at all.
+static const TutorialMemoryUsage kTutorialMemoryCpuToGpu(
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+// Staging data the GPU copies out of once
+static const TutorialMemoryUsage kTutorialMemoryStaging(
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+// Pick the best memory type out of typeBits for the usage. Types failing
+// required_ or forbidden_ are skipped (as are LAZILY_ALLOCATED and PROTECTED
+// ones, unless required). The rest are scored: most preferred_ flags first,
+// then fewest flags nobody asked for, then the largest heap.
+// Returns false if no memory type qualifies.
+bool tutorialFindMemoryType(const VkPhysicalDeviceMemoryProperties& properties,
+                            uint32_t typeBits, const TutorialMemoryUsage& usage,
+                            uint32_t* typeIndex);
+
+// tutorialFindMemoryType() over memory properties queried once, at device
+// creation, instead of on every lookup
+class TutorialMemoryTypeResolver {
+ public:
+  TutorialMemoryTypeResolver();
+
+  void Init(VkPhysicalDevice gpu);
+
+  bool Resolve(uint32_t typeBits, const TutorialMemoryUsage& usage,
+               uint32_t* typeIndex) const {
+    return tutorialFindMemoryType(properties_, typeBits, usage, typeIndex);
+  }
+  VkMemoryPropertyFlags Flags(uint32_t typeIndex) const {
+    return properties_.memoryTypes[typeIndex].propertyFlags;
+  }
+  const VkPhysicalDeviceMemoryProperties& Properties(void) const {
+    return properties_;
+  }
+  // Unified memory: some device local memory is also host visible
+  bool IsUMA(void) const { return uma_; }
+
+  void LogMemoryTypes(void) const;
+
+ private:
+  VkPhysicalDeviceMemoryProperties properties_;
+  bool uma_;
+};
+
+#endif  // TUTORIAL_MEMORY_TYPE_HPP
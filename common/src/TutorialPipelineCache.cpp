@@ -0,0 +1,152 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialPipelineCache.hpp"
+#include <android/log.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const char* kPipelineCacheTAG = "Vulkan-PipelineCache";
+#define PC_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kPipelineCacheTAG, __VA_ARGS__))
+#define PC_LOGW(...) \
+  ((void)__android_log_print(ANDROID_LOG_WARN, kPipelineCacheTAG, __VA_ARGS__))
+
+// VkPipelineCacheHeaderVersionOne, read field by field: the blob is a plain
+// byte stream, there is no alignment guarantee for a struct overlay
+static const size_t kPipelineCacheHeaderSize = 16 + VK_UUID_SIZE;
+
+static uint32_t ReadU32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Check the blob header against the running driver
+static bool IsCompatible(VkPhysicalDevice gpu,
+                         const std::vector<uint8_t>& data) {
+  if (data.size() < kPipelineCacheHeaderSize) {
+    PC_LOGW("cache file truncated (%zu bytes)", data.size());
+    return false;
+  }
+  uint32_t headerSize = ReadU32(&data[0]);
+  uint32_t headerVersion = ReadU32(&data[4]);
+  uint32_t vendorID = ReadU32(&data[8]);
+  uint32_t deviceID = ReadU32(&data[12]);
+  const uint8_t* uuid = &data[16];
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(gpu, &props);
+
+  if (headerSize < kPipelineCacheHeaderSize || headerSize > data.size() ||
+      headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+    PC_LOGW("cache file has an unknown header (size %u, version %u)",
+            headerSize, headerVersion);
+    return false;
+  }
+  if (vendorID != props.vendorID || deviceID != props.deviceID) {
+    PC_LOGW("cache file is for device %04x:%04x, running on %04x:%04x",
+            vendorID, deviceID, props.vendorID, props.deviceID);
+    return false;
+  }
+  if (memcmp(uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    PC_LOGW("cache file was written by another driver build");
+    return false;
+  }
+  return true;
+}
+
+static bool ReadFile(const std::string& filePath, std::vector<uint8_t>* data) {
+  FILE* fp = fopen(filePath.c_str(), "rb");
+  if (!fp) return false;
+  bool ok = (fseek(fp, 0, SEEK_END) == 0);
+  long size = ok ? ftell(fp) : -1;
+  ok = ok && size > 0 && fseek(fp, 0, SEEK_SET) == 0;
+  if (ok) {
+    data->resize(static_cast<size_t>(size));
+    ok = (fread(data->data(), 1, data->size(), fp) == data->size());
+  }
+  fclose(fp);
+  return ok;
+}
+
+VkResult tutorialCreatePipelineCache(VkPhysicalDevice gpu, VkDevice device,
+                                     const std::string& filePath,
+                                     VkPipelineCache* cache, bool* warm) {
+  std::vector<uint8_t> data;
+  bool loaded = ReadFile(filePath, &data) && IsCompatible(gpu, data);
+  if (!loaded) data.clear();
+
+  VkPipelineCacheCreateInfo pipelineCacheInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,  // reserved, must be 0
+      .initialDataSize = data.size(),
+      .pInitialData = data.empty() ? nullptr : data.data(),
+  };
+  VkResult result =
+      vkCreatePipelineCache(device, &pipelineCacheInfo, nullptr, cache);
+  if (result != VK_SUCCESS && loaded) {
+    // The driver may still reject data it considers corrupted
+    PC_LOGW("driver rejected %s, starting with an empty cache",
+            filePath.c_str());
+    loaded = false;
+    pipelineCacheInfo.initialDataSize = 0;
+    pipelineCacheInfo.pInitialData = nullptr;
+    result = vkCreatePipelineCache(device, &pipelineCacheInfo, nullptr, cache);
+  }
+  if (loaded) {
+    PC_LOGI("loaded %zu bytes from %s", data.size(), filePath.c_str());
+  }
+  if (warm) *warm = loaded;
+  return result;
+}
+
+VkResult tutorialSavePipelineCache(VkDevice device, VkPipelineCache cache,
+                                   const std::string& filePath) {
+  size_t size = 0;
+  VkResult result = vkGetPipelineCacheData(device, cache, &size, nullptr);
+  if (result != VK_SUCCESS) return result;
+  std::vector<uint8_t> data(size);
+  result = vkGetPipelineCacheData(device, cache, &size, data.data());
+  if (result != VK_SUCCESS && result != VK_INCOMPLETE) return result;
+  data.resize(size);
+
+  std::string tmpPath = filePath + ".tmp";
+  FILE* fp = fopen(tmpPath.c_str(), "wb");
+  if (!fp) {
+    PC_LOGW("cannot open %s for writing", tmpPath.c_str());
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  bool ok = (fwrite(data.data(), 1, data.size(), fp) == data.size());
+  // the data has to be on disk before the rename is: otherwise a crash
+  // right after can leave an empty or partial file under the final name
+  ok = (fflush(fp) == 0) && ok;
+  ok = (fsync(fileno(fp)) == 0) && ok;
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+    PC_LOGW("failed to write %s", filePath.c_str());
+    remove(tmpPath.c_str());
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  PC_LOGI("saved %zu bytes to %s", data.size(), filePath.c_str());
+  return VK_SUCCESS;
+}
+
+std::string tutorialPipelineCachePath(const char* internalDataPath) {
+  std::string path(internalDataPath ? internalDataPath : ".");
+  return path + "/pipeline_cache.bin";
+}
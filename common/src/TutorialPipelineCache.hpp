@@ -0,0 +1,39 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_PIPELINE_CACHE_HPP
+#define TUTORIAL_PIPELINE_CACHE_HPP
+
+#include <vulkan_wrapper.h>
+#include <string>
+
+// Create a VkPipelineCache, seeded from the blob at filePath when that blob
+// was produced by the same driver (vendorID, deviceID, pipelineCacheUUID).
+// A missing, truncated or foreign file silently falls back to an empty cache.
+// *warm (optional) tells whether previous data was actually loaded.
+VkResult tutorialCreatePipelineCache(VkPhysicalDevice gpu, VkDevice device,
+                                     const std::string& filePath,
+                                     VkPipelineCache* cache,
+                                     bool* warm = nullptr);
+
+// Serialize the cache with vkGetPipelineCacheData and replace filePath
+// atomically (write to a temporary file, then rename over the old one), so an
+// interrupted write never leaves a half-written cache behind.
+VkResult tutorialSavePipelineCache(VkDevice device, VkPipelineCache cache,
+                                   const std::string& filePath);
+
+// Default cache file location inside the app's private data directory
+std::string tutorialPipelineCachePath(const char* internalDataPath);
+
+#endif  // TUTORIAL_PIPELINE_CACHE_HPP
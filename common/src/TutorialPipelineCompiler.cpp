@@ -0,0 +1,246 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialPipelineCompiler.hpp"
+#include <android/log.h>
+#include <cassert>
+#include <chrono>
+
+static const char* kCompilerTAG = "Vulkan-PipelineCompiler";
+#define COMPILER_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kCompilerTAG, __VA_ARGS__))
+#define COMPILER_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kCompilerTAG, __VA_ARGS__))
+
+// A pipeline to compile, with its own copy of the create info: the caller's
+// is usually built from locals that are gone long before a pool thread
+// gets to it
+struct TutorialPipelineCompiler::Job {
+  Job(const char* name, const VkGraphicsPipelineCreateInfo& info);
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+
+  // A copy of the count elements at src, held by storage; nullptr for none
+  template <typename T>
+  const T* Keep(const T* src, uint32_t count, std::vector<T>* storage) {
+    if (!src) return nullptr;
+    storage->assign(src, src + count);
+    return storage->data();
+  }
+
+  std::string name_;
+  VkGraphicsPipelineCreateInfo info_;
+  VkPipeline pipeline_;
+  bool done_;
+
+  std::vector<VkPipelineShaderStageCreateInfo> stages_;
+  std::vector<std::string> entryPoints_;
+  std::vector<VkSpecializationInfo> specializations_;
+  std::vector<std::vector<VkSpecializationMapEntry>> specializationEntries_;
+  std::vector<std::vector<uint8_t>> specializationData_;
+  VkPipelineVertexInputStateCreateInfo vertexInput_;
+  std::vector<VkVertexInputBindingDescription> vertexBindings_;
+  std::vector<VkVertexInputAttributeDescription> vertexAttributes_;
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly_;
+  VkPipelineTessellationStateCreateInfo tessellation_;
+  VkPipelineViewportStateCreateInfo viewport_;
+  std::vector<VkViewport> viewports_;
+  std::vector<VkRect2D> scissors_;
+  VkPipelineRasterizationStateCreateInfo rasterization_;
+  VkPipelineMultisampleStateCreateInfo multisample_;
+  std::vector<VkSampleMask> sampleMask_;
+  VkPipelineDepthStencilStateCreateInfo depthStencil_;
+  VkPipelineColorBlendStateCreateInfo colorBlend_;
+  std::vector<VkPipelineColorBlendAttachmentState> blendAttachments_;
+  VkPipelineDynamicStateCreateInfo dynamic_;
+  std::vector<VkDynamicState> dynamicStates_;
+};
+
+TutorialPipelineCompiler::Job::Job(const char* name,
+                                   const VkGraphicsPipelineCreateInfo& info)
+    : name_(name), info_(info), pipeline_(VK_NULL_HANDLE), done_(false) {
+  assert(!info.pNext && "pNext chains are not copied");
+
+  stages_.assign(info.pStages, info.pStages + info.stageCount);
+  entryPoints_.resize(stages_.size());
+  specializations_.resize(stages_.size());
+  specializationEntries_.resize(stages_.size());
+  specializationData_.resize(stages_.size());
+  for (size_t i = 0; i < stages_.size(); i++) {
+    entryPoints_[i] = stages_[i].pName;
+    stages_[i].pName = entryPoints_[i].c_str();
+    if (!stages_[i].pSpecializationInfo) continue;
+    const VkSpecializationInfo& src = *stages_[i].pSpecializationInfo;
+    specializations_[i] = src;
+    specializations_[i].pMapEntries =
+        Keep(src.pMapEntries, src.mapEntryCount, &specializationEntries_[i]);
+    const uint8_t* data = static_cast<const uint8_t*>(src.pData);
+    specializations_[i].pData = Keep(
+        data, static_cast<uint32_t>(src.dataSize), &specializationData_[i]);
+    stages_[i].pSpecializationInfo = &specializations_[i];
+  }
+  info_.pStages = stages_.data();
+
+  if (info.pVertexInputState) {
+    vertexInput_ = *info.pVertexInputState;
+    vertexInput_.pVertexBindingDescriptions =
+        Keep(vertexInput_.pVertexBindingDescriptions,
+             vertexInput_.vertexBindingDescriptionCount, &vertexBindings_);
+    vertexInput_.pVertexAttributeDescriptions =
+        Keep(vertexInput_.pVertexAttributeDescriptions,
+             vertexInput_.vertexAttributeDescriptionCount, &vertexAttributes_);
+    info_.pVertexInputState = &vertexInput_;
+  }
+  if (info.pInputAssemblyState) {
+    inputAssembly_ = *info.pInputAssemblyState;
+    info_.pInputAssemblyState = &inputAssembly_;
+  }
+  if (info.pTessellationState) {
+    tessellation_ = *info.pTessellationState;
+    info_.pTessellationState = &tessellation_;
+  }
+  if (info.pViewportState) {
+    viewport_ = *info.pViewportState;
+    viewport_.pViewports =
+        Keep(viewport_.pViewports, viewport_.viewportCount, &viewports_);
+    viewport_.pScissors =
+        Keep(viewport_.pScissors, viewport_.scissorCount, &scissors_);
+    info_.pViewportState = &viewport_;
+  }
+  if (info.pRasterizationState) {
+    rasterization_ = *info.pRasterizationState;
+    info_.pRasterizationState = &rasterization_;
+  }
+  if (info.pMultisampleState) {
+    multisample_ = *info.pMultisampleState;
+    // one mask word per 32 samples
+    multisample_.pSampleMask =
+        Keep(multisample_.pSampleMask,
+             (static_cast<uint32_t>(multisample_.rasterizationSamples) + 31) /
+                 32,
+             &sampleMask_);
+    info_.pMultisampleState = &multisample_;
+  }
+  if (info.pDepthStencilState) {
+    depthStencil_ = *info.pDepthStencilState;
+    info_.pDepthStencilState = &depthStencil_;
+  }
+  if (info.pColorBlendState) {
+    colorBlend_ = *info.pColorBlendState;
+    colorBlend_.pAttachments = Keep(
+        colorBlend_.pAttachments, colorBlend_.attachmentCount,
+        &blendAttachments_);
+    info_.pColorBlendState = &colorBlend_;
+  }
+  if (info.pDynamicState) {
+    dynamic_ = *info.pDynamicState;
+    dynamic_.pDynamicStates = Keep(dynamic_.pDynamicStates,
+                                   dynamic_.dynamicStateCount, &dynamicStates_);
+    info_.pDynamicState = &dynamic_;
+  }
+}
+
+TutorialPipelineCompiler::TutorialPipelineCompiler()
+    : device_(VK_NULL_HANDLE),
+      cache_(VK_NULL_HANDLE),
+      pool_(nullptr),
+      compiling_(0),
+      finished_(0) {}
+
+TutorialPipelineCompiler::~TutorialPipelineCompiler() {
+  assert(jobs_.empty() && "Destroy() was not called");
+}
+
+void TutorialPipelineCompiler::Init(VkDevice device, VkPipelineCache cache,
+                                    TutorialThreadPool* pool) {
+  device_ = device;
+  cache_ = cache;
+  pool_ = pool;
+}
+
+void TutorialPipelineCompiler::Destroy(void) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  compiled_.wait(lock, [this] { return compiling_ == 0; });
+  for (auto& job : jobs_) {
+    if (job->pipeline_ != VK_NULL_HANDLE) {
+      vkDestroyPipeline(device_, job->pipeline_, nullptr);
+    }
+  }
+  jobs_.clear();
+  finished_ = 0;
+}
+
+TutorialPipelineCompiler::Handle TutorialPipelineCompiler::Submit(
+    const char* name, const VkGraphicsPipelineCreateInfo& info) {
+  Job* job = new Job(name, info);
+  Handle handle;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handle = static_cast<Handle>(jobs_.size());
+    jobs_.emplace_back(job);
+    compiling_++;
+  }
+  pool_->Submit([this, job] { Compile(job); });
+  return handle;
+}
+
+void TutorialPipelineCompiler::Compile(Job* job) {
+  // job is not touched by anyone else until done_ is set
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  auto start = std::chrono::steady_clock::now();
+  VkResult result = vkCreateGraphicsPipelines(device_, cache_, 1, &job->info_,
+                                              nullptr, &pipeline);
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start).count();
+  if (result == VK_SUCCESS) {
+    COMPILER_LOGI("pipeline %s compiled in %.2f ms", job->name_.c_str(), ms);
+  } else {
+    COMPILER_LOGE("pipeline %s: vkCreateGraphicsPipelines: %d",
+                  job->name_.c_str(), result);
+    pipeline = VK_NULL_HANDLE;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job->pipeline_ = pipeline;
+    job->done_ = true;
+    compiling_--;
+    finished_++;
+  }
+  compiled_.notify_all();
+}
+
+VkPipeline TutorialPipelineCompiler::Pipeline(Handle handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(handle < jobs_.size());
+  return jobs_[handle]->done_ ? jobs_[handle]->pipeline_ : VK_NULL_HANDLE;
+}
+
+bool TutorialPipelineCompiler::Ready(Handle handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(handle < jobs_.size());
+  return jobs_[handle]->done_;
+}
+
+bool TutorialPipelineCompiler::Idle(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return compiling_ == 0;
+}
+
+uint32_t TutorialPipelineCompiler::Update(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t finished = finished_;
+  finished_ = 0;
+  return finished;
+}
@@ -0,0 +1,84 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_PIPELINE_COMPILER_HPP
+#define TUTORIAL_PIPELINE_COMPILER_HPP
+
+#include <vulkan_wrapper.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TutorialThreadPool.hpp"
+
+// TutorialPipelineCompiler:
+//   Create graphics pipelines on a TutorialThreadPool instead of stalling
+//   the render thread on vkCreateGraphicsPipelines(), which takes hundreds
+//   of milliseconds per pipeline on some drivers when the pipeline cache is
+//   cold. Every pipeline is a task of its own, so several compile in
+//   parallel; all of them share one VkPipelineCache, which Vulkan
+//   synchronizes internally.
+//   Submit() copies the create info, with everything it points to, and
+//   returns a handle right away. The render thread polls handles with
+//   Pipeline(), drawing with a simpler pipeline or skipping the draw until
+//   it gets one, and Update() tells it when pipelines have been finished so
+//   that pre-recorded command buffers can be recorded again.
+//   The compiler owns the pipelines it creates. The shader modules, layout
+//   and render pass of a create info must stay valid until its pipeline is
+//   ready.
+class TutorialPipelineCompiler {
+ public:
+  typedef uint32_t Handle;
+
+  TutorialPipelineCompiler();
+  ~TutorialPipelineCompiler();
+
+  void Init(VkDevice device, VkPipelineCache cache, TutorialThreadPool* pool);
+  // Wait for the pipelines being compiled, then destroy them all. The pool
+  // may go on running after.
+  void Destroy(void);
+
+  // Queue info for compilation. pNext chains are not supported.
+  Handle Submit(const char* name, const VkGraphicsPipelineCreateInfo& info);
+
+  // VK_NULL_HANDLE while handle is compiling, or if it failed
+  VkPipeline Pipeline(Handle handle);
+  bool Ready(Handle handle);
+  // True when nothing is being compiled
+  bool Idle(void);
+
+  // Render thread. Number of pipelines finished, successfully or not, since
+  // the last call.
+  uint32_t Update(void);
+
+ private:
+  struct Job;
+
+  // Pool task: create the pipeline of job
+  void Compile(Job* job);
+
+  VkDevice device_;
+  VkPipelineCache cache_;
+  TutorialThreadPool* pool_;
+
+  std::mutex mutex_;
+  std::condition_variable compiled_;
+  std::vector<std::unique_ptr<Job>> jobs_;  // by handle
+  uint32_t compiling_;
+  uint32_t finished_;  // jobs done, and not reported by Update() yet
+};
+
+#endif  // TUTORIAL_PIPELINE_COMPILER_HPP
@@ -0,0 +1,279 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialPipelineState.hpp"
+#include <android/log.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+static const char* kStateTAG = "Vulkan-PipelineState";
+#define STATE_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kStateTAG, __VA_ARGS__))
+#define STATE_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kStateTAG, __VA_ARGS__))
+
+TutorialPipelineStateDesc::TutorialPipelineStateDesc() {
+  memset(this, 0, sizeof(*this));
+  topology_ = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  polygonMode_ = VK_POLYGON_MODE_FILL;
+  cullMode_ = VK_CULL_MODE_NONE;
+  frontFace_ = VK_FRONT_FACE_CLOCKWISE;
+  samples_ = VK_SAMPLE_COUNT_1_BIT;
+  depthCompareOp_ = VK_COMPARE_OP_LESS_OR_EQUAL;
+  colorAttachmentCount_ = 1;
+  for (auto& blend : blend_) {
+    blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  }
+}
+
+TutorialPipelineStateDesc::TutorialPipelineStateDesc(
+    const TutorialPipelineStateDesc& other) {
+  memcpy(this, &other, sizeof(*this));
+}
+
+TutorialPipelineStateDesc& TutorialPipelineStateDesc::operator=(
+    const TutorialPipelineStateDesc& other) {
+  if (this != &other) memcpy(this, &other, sizeof(*this));
+  return *this;
+}
+
+bool TutorialPipelineStateDesc::operator==(
+    const TutorialPipelineStateDesc& other) const {
+  return memcmp(this, &other, sizeof(*this)) == 0;
+}
+
+uint64_t TutorialPipelineStateDesc::Hash(void) const {
+  // FNV-1a over 64 bit words rather than bytes: the desc is a few hundred
+  // bytes, hashed on every Get()
+  static_assert(sizeof(TutorialPipelineStateDesc) % sizeof(uint64_t) == 0,
+                "the desc is hashed a word at a time");
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(this);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < sizeof(*this); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  }
+  return hash ^ (hash >> 32);
+}
+
+TutorialPipelineStateDesc& TutorialPipelineStateDesc::AddStage(
+    VkShaderStageFlagBits stage, VkShaderModule module) {
+  assert(stageCount_ < kMaxStages);
+  stages_[stageCount_] = stage;
+  modules_[stageCount_] = module;
+  stageCount_++;
+  return *this;
+}
+
+TutorialPipelineStateDesc& TutorialPipelineStateDesc::SetVertexInput(
+    const VkPipelineVertexInputStateCreateInfo& input) {
+  assert(input.vertexBindingDescriptionCount <= kMaxVertexBindings);
+  assert(input.vertexAttributeDescriptionCount <= kMaxVertexAttributes);
+  memset(vertexBindings_, 0, sizeof(vertexBindings_));
+  memset(vertexAttributes_, 0, sizeof(vertexAttributes_));
+  vertexBindingCount_ = input.vertexBindingDescriptionCount;
+  vertexAttributeCount_ = input.vertexAttributeDescriptionCount;
+  std::copy(input.pVertexBindingDescriptions,
+            input.pVertexBindingDescriptions + vertexBindingCount_,
+            vertexBindings_);
+  std::copy(input.pVertexAttributeDescriptions,
+            input.pVertexAttributeDescriptions + vertexAttributeCount_,
+            vertexAttributes_);
+  return *this;
+}
+
+TutorialPipelineCreateInfo::TutorialPipelineCreateInfo(
+    const TutorialPipelineStateDesc& desc) {
+  for (uint32_t i = 0; i < desc.stageCount_; i++) {
+    stages_[i] = VkPipelineShaderStageCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = desc.stages_[i],
+        .module = desc.modules_[i],
+        .pName = "main",
+        .pSpecializationInfo = nullptr,
+    };
+  }
+  vertexInput_ = VkPipelineVertexInputStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .vertexBindingDescriptionCount = desc.vertexBindingCount_,
+      .pVertexBindingDescriptions = desc.vertexBindings_,
+      .vertexAttributeDescriptionCount = desc.vertexAttributeCount_,
+      .pVertexAttributeDescriptions = desc.vertexAttributes_,
+  };
+  inputAssembly_ = VkPipelineInputAssemblyStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .topology = desc.topology_,
+      .primitiveRestartEnable = VK_FALSE,
+  };
+  // the rectangles are set at draw time
+  viewport_ = VkPipelineViewportStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .viewportCount = 1,
+      .pViewports = nullptr,
+      .scissorCount = 1,
+      .pScissors = nullptr,
+  };
+  rasterization_ = VkPipelineRasterizationStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .depthClampEnable = VK_FALSE,
+      .rasterizerDiscardEnable = VK_FALSE,
+      .polygonMode = desc.polygonMode_,
+      .cullMode = desc.cullMode_,
+      .frontFace = desc.frontFace_,
+      .depthBiasEnable = VK_FALSE,
+      .depthBiasConstantFactor = 0,
+      .depthBiasClamp = 0,
+      .depthBiasSlopeFactor = 0,
+      .lineWidth = 1,
+  };
+  sampleMask_ = ~0u;
+  multisample_ = VkPipelineMultisampleStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .rasterizationSamples = desc.samples_,
+      .sampleShadingEnable = VK_FALSE,
+      .minSampleShading = 0,
+      .pSampleMask = &sampleMask_,
+      .alphaToCoverageEnable = VK_FALSE,
+      .alphaToOneEnable = VK_FALSE,
+  };
+  memset(&depthStencil_, 0, sizeof(depthStencil_));
+  depthStencil_.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil_.depthTestEnable = desc.depthTest_;
+  depthStencil_.depthWriteEnable = desc.depthWrite_;
+  depthStencil_.depthCompareOp = desc.depthCompareOp_;
+  depthStencil_.maxDepthBounds = 1.0f;
+  colorBlend_ = VkPipelineColorBlendStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .logicOpEnable = VK_FALSE,
+      .logicOp = VK_LOGIC_OP_COPY,
+      .attachmentCount = desc.colorAttachmentCount_,
+      .pAttachments = desc.blend_,
+      .blendConstants = {0, 0, 0, 0},
+  };
+  dynamicStates_[0] = VK_DYNAMIC_STATE_VIEWPORT;
+  dynamicStates_[1] = VK_DYNAMIC_STATE_SCISSOR;
+  dynamic_ = VkPipelineDynamicStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .dynamicStateCount = 2,
+      .pDynamicStates = dynamicStates_,
+  };
+  info_ = VkGraphicsPipelineCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .stageCount = desc.stageCount_,
+      .pStages = stages_,
+      .pVertexInputState = &vertexInput_,
+      .pInputAssemblyState = &inputAssembly_,
+      .pTessellationState = nullptr,
+      .pViewportState = &viewport_,
+      .pRasterizationState = &rasterization_,
+      .pMultisampleState = &multisample_,
+      .pDepthStencilState = &depthStencil_,
+      .pColorBlendState = &colorBlend_,
+      .pDynamicState = &dynamic_,
+      .layout = desc.layout_,
+      .renderPass = desc.renderPass_,
+      .subpass = desc.subpass_,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex = 0,
+  };
+}
+
+TutorialPipelineStateCache::TutorialPipelineStateCache()
+    : device_(VK_NULL_HANDLE), pipelineCache_(VK_NULL_HANDLE) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+TutorialPipelineStateCache::~TutorialPipelineStateCache() {
+  assert(pipelines_.empty() && "Destroy() was not called");
+}
+
+void TutorialPipelineStateCache::Init(VkDevice device,
+                                      VkPipelineCache pipelineCache) {
+  device_ = device;
+  pipelineCache_ = pipelineCache;
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void TutorialPipelineStateCache::Destroy(void) {
+  for (auto& entry : pipelines_) {
+    vkDestroyPipeline(device_, entry.second, nullptr);
+  }
+  pipelines_.clear();
+}
+
+VkPipeline TutorialPipelineStateCache::Get(
+    const TutorialPipelineStateDesc& desc) {
+  auto it = pipelines_.find(desc);
+  if (it != pipelines_.end()) {
+    stats_.hits_++;
+    return it->second;
+  }
+
+  stats_.misses_++;
+  TutorialPipelineCreateInfo createInfo(desc);
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  auto start = std::chrono::steady_clock::now();
+  VkResult result = vkCreateGraphicsPipelines(
+      device_, pipelineCache_, 1, &createInfo.Info(), nullptr, &pipeline);
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start).count();
+  stats_.createMs_ += ms;
+  stats_.maxCreateMs_ = std::max(stats_.maxCreateMs_, ms);
+  if (result != VK_SUCCESS) {
+    STATE_LOGE("vkCreateGraphicsPipelines: %d", result);
+    stats_.failures_++;
+    return VK_NULL_HANDLE;
+  }
+  pipelines_.emplace(desc, pipeline);
+  return pipeline;
+}
+
+TutorialPipelineStateCacheStats TutorialPipelineStateCache::GetStats(
+    void) const {
+  TutorialPipelineStateCacheStats stats = stats_;
+  stats.pipelineCount_ = static_cast<uint32_t>(pipelines_.size());
+  return stats;
+}
+
+void TutorialPipelineStateCache::LogStats(void) const {
+  TutorialPipelineStateCacheStats stats = GetStats();
+  STATE_LOGI("%llu hit(s), %llu miss(es), %u failure(s), %u pipeline(s); "
+             "%.2f ms creating, %.2f ms at most",
+             static_cast<unsigned long long>(stats.hits_),
+             static_cast<unsigned long long>(stats.misses_), stats.failures_,
+             stats.pipelineCount_, stats.createMs_, stats.maxCreateMs_);
+}
@@ -0,0 +1,158 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_PIPELINE_STATE_HPP
+#define TUTORIAL_PIPELINE_STATE_HPP
+
+#include <vulkan_wrapper.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// TutorialPipelineStateDesc:
+//   Everything a graphics pipeline is made of, as one flat value: shader
+//   modules, vertex layout, rasterization, depth and blend state, layout,
+//   render pass and subpass. It is zeroed, padding included, before the
+//   defaults are set, so equality is a memcmp() and the hash covers the raw
+//   bytes; two descs built the same way are equal whatever order their
+//   fields were set in.
+//   Defaults: a triangle list, filled, no culling, clockwise front faces,
+//   1 sample, no depth test, and one color attachment written without
+//   blending. Viewport and scissor are always dynamic state, so pipelines
+//   do not depend on the swapchain size. Shader stages use "main" and no
+//   specialization; TutorialPipelineVariants specializes a desc's pipeline,
+//   with Hash() as its base key.
+//   Handles are part of the key: shader modules, layouts and render passes
+//   must outlive the pipelines cached for them.
+struct TutorialPipelineStateDesc {
+  static const uint32_t kMaxStages = 5;
+  static const uint32_t kMaxVertexBindings = 4;
+  static const uint32_t kMaxVertexAttributes = 16;
+  static const uint32_t kMaxColorAttachments = 4;
+
+  TutorialPipelineStateDesc();
+  // Copies the padding too
+  TutorialPipelineStateDesc(const TutorialPipelineStateDesc& other);
+  TutorialPipelineStateDesc& operator=(const TutorialPipelineStateDesc& other);
+
+  bool operator==(const TutorialPipelineStateDesc& other) const;
+  bool operator!=(const TutorialPipelineStateDesc& other) const {
+    return !(*this == other);
+  }
+  uint64_t Hash(void) const;
+
+  TutorialPipelineStateDesc& AddStage(VkShaderStageFlagBits stage,
+                                      VkShaderModule module);
+  // Copy the bindings and attributes of input (see
+  // TutorialShaderInterface::VertexInput())
+  TutorialPipelineStateDesc& SetVertexInput(
+      const VkPipelineVertexInputStateCreateInfo& input);
+
+  VkPipelineLayout layout_;
+  VkRenderPass renderPass_;
+  VkShaderModule modules_[kMaxStages];
+  VkShaderStageFlagBits stages_[kMaxStages];
+  uint32_t stageCount_;
+  uint32_t subpass_;
+
+  uint32_t vertexBindingCount_;
+  VkVertexInputBindingDescription vertexBindings_[kMaxVertexBindings];
+  uint32_t vertexAttributeCount_;
+  VkVertexInputAttributeDescription vertexAttributes_[kMaxVertexAttributes];
+  VkPrimitiveTopology topology_;
+
+  VkPolygonMode polygonMode_;
+  VkCullModeFlags cullMode_;
+  VkFrontFace frontFace_;
+  VkSampleCountFlagBits samples_;
+
+  VkBool32 depthTest_;
+  VkBool32 depthWrite_;
+  VkCompareOp depthCompareOp_;
+
+  uint32_t colorAttachmentCount_;
+  VkPipelineColorBlendAttachmentState blend_[kMaxColorAttachments];
+};
+
+// A VkGraphicsPipelineCreateInfo for a desc, with the state structs it
+// points to. Points into this object, which cannot be copied.
+class TutorialPipelineCreateInfo {
+ public:
+  explicit TutorialPipelineCreateInfo(const TutorialPipelineStateDesc& desc);
+  TutorialPipelineCreateInfo(const TutorialPipelineCreateInfo&) = delete;
+  TutorialPipelineCreateInfo& operator=(const TutorialPipelineCreateInfo&) =
+      delete;
+
+  const VkGraphicsPipelineCreateInfo& Info(void) const { return info_; }
+
+ private:
+  VkPipelineShaderStageCreateInfo
+      stages_[TutorialPipelineStateDesc::kMaxStages];
+  VkPipelineVertexInputStateCreateInfo vertexInput_;
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly_;
+  VkPipelineViewportStateCreateInfo viewport_;
+  VkPipelineRasterizationStateCreateInfo rasterization_;
+  VkSampleMask sampleMask_;
+  VkPipelineMultisampleStateCreateInfo multisample_;
+  VkPipelineDepthStencilStateCreateInfo depthStencil_;
+  VkPipelineColorBlendStateCreateInfo colorBlend_;
+  VkDynamicState dynamicStates_[2];
+  VkPipelineDynamicStateCreateInfo dynamic_;
+  VkGraphicsPipelineCreateInfo info_;
+};
+
+struct TutorialPipelineStateCacheStats {
+  uint64_t hits_;    // Get() of a desc already created
+  uint64_t misses_;  // Get() that created a pipeline
+  uint32_t failures_;
+  uint32_t pipelineCount_;
+  double createMs_;  // in vkCreateGraphicsPipelines(), all misses together
+  double maxCreateMs_;
+};
+
+// TutorialPipelineStateCache:
+//   One pipeline per distinct TutorialPipelineStateDesc. Get() looks the
+//   desc up in a hash table and only creates a pipeline, in the given
+//   VkPipelineCache, the first time a desc is seen; materials sharing their
+//   state share their pipeline. Failures are not cached, the next Get()
+//   tries again. Render thread only; the cache owns the pipelines.
+class TutorialPipelineStateCache {
+ public:
+  TutorialPipelineStateCache();
+  ~TutorialPipelineStateCache();
+
+  void Init(VkDevice device, VkPipelineCache pipelineCache);
+  void Destroy(void);
+
+  // VK_NULL_HANDLE if the pipeline cannot be created
+  VkPipeline Get(const TutorialPipelineStateDesc& desc);
+
+  TutorialPipelineStateCacheStats GetStats(void) const;
+  void LogStats(void) const;
+
+ private:
+  struct DescHash {
+    size_t operator()(const TutorialPipelineStateDesc& desc) const {
+      return static_cast<size_t>(desc.Hash());
+    }
+  };
+
+  VkDevice device_;
+  VkPipelineCache pipelineCache_;
+  std::unordered_map<TutorialPipelineStateDesc, VkPipeline, DescHash>
+      pipelines_;
+  TutorialPipelineStateCacheStats stats_;
+};
+
+#endif  // TUTORIAL_PIPELINE_STATE_HPP
@@ -0,0 +1,269 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialPipelineVariants.hpp"
+#include <android/log.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include "TutorialAssetArchive.hpp"
+
+static const char* kVariantsTAG = "Vulkan-PipelineVariants";
+#define VARIANTS_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kVariantsTAG, __VA_ARGS__))
+#define VARIANTS_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kVariantsTAG, __VA_ARGS__))
+
+TutorialSpecialization& TutorialSpecialization::Set(uint32_t constantId,
+                                                    uint32_t value) {
+  return SetBits(constantId, value);
+}
+
+TutorialSpecialization& TutorialSpecialization::Set(uint32_t constantId,
+                                                    int32_t value) {
+  return SetBits(constantId, static_cast<uint32_t>(value));
+}
+
+TutorialSpecialization& TutorialSpecialization::Set(uint32_t constantId,
+                                                    float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return SetBits(constantId, bits);
+}
+
+TutorialSpecialization& TutorialSpecialization::Set(uint32_t constantId,
+                                                    bool value) {
+  return SetBits(constantId, value ? VK_TRUE : VK_FALSE);
+}
+
+TutorialSpecialization& TutorialSpecialization::SetBits(uint32_t constantId,
+                                                        uint32_t bits) {
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), constantId,
+                             [](const VkSpecializationMapEntry& entry,
+                                uint32_t id) { return entry.constantID < id; });
+  size_t i = it - entries_.begin();
+  if (it == entries_.end() || it->constantID != constantId) {
+    entries_.insert(it, VkSpecializationMapEntry{constantId, 0,
+                                                 sizeof(uint32_t)});
+    data_.insert(data_.begin() + i, 0);
+    // the values are packed in id order
+    for (size_t j = i; j < entries_.size(); j++) {
+      entries_[j].offset = static_cast<uint32_t>(j * sizeof(uint32_t));
+    }
+  }
+  data_[i] = bits;
+  return *this;
+}
+
+bool TutorialSpecialization::Get(uint32_t constantId, uint32_t* bits) const {
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (entries_[i].constantID == constantId) {
+      *bits = data_[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t TutorialSpecialization::Hash(uint64_t hash) const {
+  for (size_t i = 0; i < entries_.size(); i++) {
+    hash = tutorialFnv1a64(&entries_[i].constantID, sizeof(uint32_t), hash);
+    hash = tutorialFnv1a64(&data_[i], sizeof(uint32_t), hash);
+  }
+  return hash;
+}
+
+const VkSpecializationInfo* TutorialSpecialization::Info(void) {
+  if (entries_.empty()) return nullptr;
+  info_.mapEntryCount = static_cast<uint32_t>(entries_.size());
+  info_.pMapEntries = entries_.data();
+  info_.dataSize = data_.size() * sizeof(uint32_t);
+  info_.pData = data_.data();
+  return &info_;
+}
+
+TutorialPipelineVariants::TutorialPipelineVariants()
+    : device_(VK_NULL_HANDLE),
+      baseKey_(0),
+      created_(0),
+      compiler_(nullptr) {}
+
+void TutorialPipelineVariants::Init(VkDevice device,
+                                    const VkGraphicsPipelineCreateInfo& base,
+                                    uint64_t baseKey) {
+  device_ = device;
+  base_ = base;
+  baseKey_ = baseKey;
+  baseStages_.clear();
+  for (uint32_t i = 0; i < base.stageCount; i++) {
+    baseStages_.push_back(base.pStages[i].stage);
+  }
+  variants_.clear();
+  created_ = 0;
+  compiler_ = nullptr;
+}
+
+void TutorialPipelineVariants::Destroy(void) {
+  for (auto& variant : variants_) {
+    if (variant.owner_) vkDestroyPipeline(device_, variant.pipeline_, nullptr);
+  }
+  variants_.clear();
+  created_ = 0;
+  compiler_ = nullptr;
+}
+
+uint32_t TutorialPipelineVariants::Add(const char* name) {
+  variants_.push_back(Variant{name, {}, VK_NULL_HANDLE, false, false, 0});
+  return static_cast<uint32_t>(variants_.size() - 1);
+}
+
+TutorialSpecialization& TutorialPipelineVariants::Specialize(
+    uint32_t variant, VkShaderStageFlagBits stage) {
+  assert(variant >= created_ && "variant already created");
+  std::vector<Stage>& stages = variants_[variant].stages_;
+  for (auto& specialized : stages) {
+    if (specialized.stage_ == stage) return specialized.constants_;
+  }
+  stages.push_back(Stage{stage, TutorialSpecialization()});
+  return stages.back().constants_;
+}
+
+uint64_t TutorialPipelineVariants::Key(uint32_t variant) const {
+  uint64_t key = tutorialFnv1a64(&baseKey_, sizeof(baseKey_));
+  // in the order of the base's stages, so that the order of Specialize()
+  // calls does not matter
+  for (const VkShaderStageFlagBits stage : baseStages_) {
+    key = tutorialFnv1a64(&stage, sizeof(stage), key);
+    for (auto& specialized : variants_[variant].stages_) {
+      if (specialized.stage_ == stage) key = specialized.constants_.Hash(key);
+    }
+  }
+  return key;
+}
+
+VkPipeline TutorialPipelineVariants::Pipeline(uint32_t variant) const {
+  const Variant& v = variants_[variant];
+  return v.compiled_ ? compiler_->Pipeline(v.handle_) : v.pipeline_;
+}
+
+VkPipeline TutorialPipelineVariants::Find(uint64_t key) const {
+  for (uint32_t i = 0; i < created_; i++) {
+    if (Key(i) == key) return Pipeline(i);
+  }
+  return VK_NULL_HANDLE;
+}
+
+void TutorialPipelineVariants::Prepare(
+    std::vector<uint32_t>* creating,
+    std::vector<std::vector<VkPipelineShaderStageCreateInfo>>* stages,
+    std::vector<VkGraphicsPipelineCreateInfo>* infos) {
+  // variants whose key is already taken share that pipeline; the others
+  // get one create info each, with their own copy of the stages
+  std::vector<uint64_t> keys;
+  for (uint32_t i = created_; i < variants_.size(); i++) {
+    uint64_t key = Key(i);
+    bool existing = false;
+    for (uint32_t j = 0; j < created_ && !existing; j++) {
+      existing = Key(j) == key;
+    }
+    auto same = std::find(keys.begin(), keys.end(), key);
+    if (!existing && same == keys.end()) {
+      creating->push_back(i);
+      keys.push_back(key);
+    }
+  }
+  stages->resize(creating->size());
+  infos->assign(creating->size(), base_);
+  for (size_t i = 0; i < creating->size(); i++) {
+    Variant& variant = variants_[(*creating)[i]];
+    (*stages)[i].assign(base_.pStages, base_.pStages + base_.stageCount);
+    for (auto& stage : (*stages)[i]) {
+      stage.pSpecializationInfo = nullptr;
+      for (auto& specialized : variant.stages_) {
+        if (specialized.stage_ == stage.stage) {
+          stage.pSpecializationInfo = specialized.constants_.Info();
+        }
+      }
+    }
+    (*infos)[i].pStages = (*stages)[i].data();
+  }
+}
+
+void TutorialPipelineVariants::Share(void) {
+  const uint32_t first = created_;
+  created_ = static_cast<uint32_t>(variants_.size());
+  for (uint32_t i = first; i < created_; i++) {
+    if (variants_[i].owner_ || variants_[i].compiled_) continue;
+    const uint64_t key = Key(i);
+    for (uint32_t j = 0; j < created_; j++) {
+      const Variant& source = variants_[j];
+      if ((source.owner_ || source.compiled_) && Key(j) == key) {
+        variants_[i].pipeline_ = source.pipeline_;
+        variants_[i].compiled_ = source.compiled_;
+        variants_[i].handle_ = source.handle_;
+        break;
+      }
+    }
+  }
+}
+
+VkResult TutorialPipelineVariants::Create(VkPipelineCache pipelineCache) {
+  std::vector<uint32_t> creating;
+  std::vector<std::vector<VkPipelineShaderStageCreateInfo>> stages;
+  std::vector<VkGraphicsPipelineCreateInfo> infos;
+  Prepare(&creating, &stages, &infos);
+
+  std::vector<VkPipeline> pipelines(creating.size(), VK_NULL_HANDLE);
+  VkResult result = VK_SUCCESS;
+  auto start = std::chrono::steady_clock::now();
+  if (!infos.empty()) {
+    result = vkCreateGraphicsPipelines(
+        device_, pipelineCache, static_cast<uint32_t>(infos.size()),
+        infos.data(), nullptr, pipelines.data());
+  }
+  VARIANTS_LOGI("%zu of %zu pipeline variant(s) created in %.2f ms",
+                creating.size(), variants_.size() - created_,
+                std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+  if (result != VK_SUCCESS) {
+    VARIANTS_LOGE("vkCreateGraphicsPipelines: %d", result);
+  }
+
+  for (size_t i = 0; i < creating.size(); i++) {
+    variants_[creating[i]].pipeline_ = pipelines[i];
+    variants_[creating[i]].owner_ = true;
+  }
+  Share();
+  return result;
+}
+
+void TutorialPipelineVariants::Compile(TutorialPipelineCompiler* compiler) {
+  assert((!compiler_ || compiler_ == compiler) && "one compiler only");
+  compiler_ = compiler;
+  std::vector<uint32_t> creating;
+  std::vector<std::vector<VkPipelineShaderStageCreateInfo>> stages;
+  std::vector<VkGraphicsPipelineCreateInfo> infos;
+  Prepare(&creating, &stages, &infos);
+
+  // the compiler copies the infos, stages and constants included
+  for (size_t i = 0; i < creating.size(); i++) {
+    Variant& variant = variants_[creating[i]];
+    variant.handle_ = compiler->Submit(variant.name_.c_str(), infos[i]);
+    variant.compiled_ = true;
+  }
+  VARIANTS_LOGI("%zu of %zu pipeline variant(s) queued for compilation",
+                creating.size(), variants_.size() - created_);
+  Share();
+}
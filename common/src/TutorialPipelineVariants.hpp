@@ -0,0 +1,133 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_PIPELINE_VARIANTS_HPP
+#define TUTORIAL_PIPELINE_VARIANTS_HPP
+
+#include <vulkan_wrapper.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TutorialPipelineCompiler.hpp"
+
+// Specialization constants of one shader stage: layout (constant_id = N)
+// const values in the shader, set when the pipeline is created. 32 bit
+// constants only (int, uint, float and bool, which SPIR-V holds as a
+// VkBool32).
+class TutorialSpecialization {
+ public:
+  TutorialSpecialization& Set(uint32_t constantId, uint32_t value);
+  TutorialSpecialization& Set(uint32_t constantId, int32_t value);
+  TutorialSpecialization& Set(uint32_t constantId, float value);
+  TutorialSpecialization& Set(uint32_t constantId, bool value);
+
+  bool Empty(void) const { return entries_.empty(); }
+  // The bits constantId is set to; false if it is not set
+  bool Get(uint32_t constantId, uint32_t* bits) const;
+  // FNV-1a 64 of the ids and values, continuing from hash. The order of the
+  // Set() calls does not matter.
+  uint64_t Hash(uint64_t hash) const;
+  // Points into this object; valid until the next Set()
+  const VkSpecializationInfo* Info(void);
+
+ private:
+  TutorialSpecialization& SetBits(uint32_t constantId, uint32_t bits);
+
+  std::vector<VkSpecializationMapEntry> entries_;  // sorted by constantID
+  std::vector<uint32_t> data_;                      // value of entries_[i]
+  VkSpecializationInfo info_;
+};
+
+// TutorialPipelineVariants:
+//   Pipelines that share all their state and shader modules, and only
+//   differ in the specialization constants of their stages: one set of
+//   GLSL sources compiled once, and the driver compiles each variant with
+//   its constants folded in and the branches they disable removed.
+//   - Init() takes the pipeline the variants start from.
+//   - Add() starts a variant, Specialize() sets the constants of its stages;
+//     stages not specialized keep the shader's defaults.
+//   - Create() creates every variant added since the last call in one
+//     vkCreateGraphicsPipelines() call, which lets the driver compile them
+//     in parallel. Compile() queues them on a TutorialPipelineCompiler
+//     instead, and returns at once.
+//   Each variant has a key: the FNV-1a 64 of the base key given to Init()
+//   and of the constants of every stage. Variants with the same key share
+//   one pipeline, and Find() looks pipelines up by key.
+class TutorialPipelineVariants {
+ public:
+  TutorialPipelineVariants();
+
+  // base, and everything it points to, must stay valid until the last
+  // Create() or Compile() returns; pStages is copied for each variant, with
+  // their pSpecializationInfo replaced. baseKey tells apart variants of
+  // different bases that end up with the same constants.
+  void Init(VkDevice device, const VkGraphicsPipelineCreateInfo& base,
+            uint64_t baseKey = 0);
+  // Destroy all pipelines
+  void Destroy(void);
+
+  // A new variant, without specialization yet; returns its index
+  uint32_t Add(const char* name);
+  // The constants of one stage of a variant, to Set() before Create()
+  TutorialSpecialization& Specialize(uint32_t variant,
+                                     VkShaderStageFlagBits stage);
+
+  // Create the pipelines of the variants added since the last call, in
+  // pipelineCache
+  VkResult Create(VkPipelineCache pipelineCache);
+  // Compile the variants added since the last call on compiler's threads;
+  // Pipeline() stays VK_NULL_HANDLE until the compiler has them, and the
+  // compiler owns them
+  void Compile(TutorialPipelineCompiler* compiler);
+
+  uint64_t Key(uint32_t variant) const;
+  // VK_NULL_HANDLE until created, or compiled
+  VkPipeline Pipeline(uint32_t variant) const;
+  VkPipeline Find(uint64_t key) const;
+  uint32_t Count(void) const { return static_cast<uint32_t>(variants_.size()); }
+
+ private:
+  struct Stage {
+    VkShaderStageFlagBits stage_;
+    TutorialSpecialization constants_;
+  };
+  struct Variant {
+    std::string name_;
+    std::vector<Stage> stages_;
+    VkPipeline pipeline_;
+    bool owner_;  // false when it shares the pipeline of an earlier variant
+    bool compiled_;  // the pipeline is handle_ of compiler_
+    TutorialPipelineCompiler::Handle handle_;
+  };
+
+  // The variants from created_ on that need a pipeline of their own, and a
+  // create info for each; stages holds the stages the infos point to
+  void Prepare(
+      std::vector<uint32_t>* creating,
+      std::vector<std::vector<VkPipelineShaderStageCreateInfo>>* stages,
+      std::vector<VkGraphicsPipelineCreateInfo>* infos);
+  // Mark all variants created, the others sharing the pipeline of the
+  // variant with their key
+  void Share(void);
+
+  VkDevice device_;
+  VkGraphicsPipelineCreateInfo base_;
+  uint64_t baseKey_;
+  std::vector<VkShaderStageFlagBits> baseStages_;
+  std::vector<Variant> variants_;
+  uint32_t created_;  // variants_[0, created_) have a pipeline, or a handle
+  TutorialPipelineCompiler* compiler_;
+};
+
+#endif  // TUTORIAL_PIPELINE_VARIANTS_HPP
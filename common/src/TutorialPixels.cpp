@@ -0,0 +1,246 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialPixels.hpp"
+#include <cassert>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TUTORIAL_PIXELS_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define TUTORIAL_PIXELS_SSSE3 1
+#endif
+
+// Each converter handles as many pixels as it can with vector code and
+// returns how many it did; the scalar loops below finish the row.
+
+#if defined(TUTORIAL_PIXELS_NEON)
+
+static size_t GreyToRGBA(uint8_t* dst, const uint8_t* src, size_t count) {
+  const uint8x16_t alpha = vdupq_n_u8(0xFF);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t rgba;
+    rgba.val[0] = rgba.val[1] = rgba.val[2] = vld1q_u8(src + i);
+    rgba.val[3] = alpha;
+    vst4q_u8(dst + i * 4, rgba);
+  }
+  return i;
+}
+
+static size_t GreyAlphaToRGBA(uint8_t* dst, const uint8_t* src,
+                              size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x2_t ga = vld2q_u8(src + i * 2);
+    uint8x16x4_t rgba;
+    rgba.val[0] = rgba.val[1] = rgba.val[2] = ga.val[0];
+    rgba.val[3] = ga.val[1];
+    vst4q_u8(dst + i * 4, rgba);
+  }
+  return i;
+}
+
+static size_t RGBToRGBA(uint8_t* dst, const uint8_t* src, size_t count) {
+  const uint8x16_t alpha = vdupq_n_u8(0xFF);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+    uint8x16x4_t rgba;
+    rgba.val[0] = rgb.val[0];
+    rgba.val[1] = rgb.val[1];
+    rgba.val[2] = rgb.val[2];
+    rgba.val[3] = alpha;
+    vst4q_u8(dst + i * 4, rgba);
+  }
+  return i;
+}
+
+static size_t SwizzleRB(uint8_t* dst, const uint8_t* src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+    uint8x16_t r = rgba.val[0];
+    rgba.val[0] = rgba.val[2];
+    rgba.val[2] = r;
+    vst4q_u8(dst + i * 4, rgba);
+  }
+  return i;
+}
+
+#elif defined(TUTORIAL_PIXELS_SSSE3)
+
+static size_t GreyToRGBA(uint8_t* dst, const uint8_t* src, size_t count) {
+  const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // gg pairs and g-alpha pairs, interleaved into g g g a
+    __m128i gg = _mm_unpacklo_epi8(g, g);
+    __m128i ga = _mm_unpacklo_epi8(g, alpha);
+    __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gg, ga));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg, ga));
+    gg = _mm_unpackhi_epi8(g, g);
+    ga = _mm_unpackhi_epi8(g, alpha);
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(gg, ga));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(gg, ga));
+  }
+  return i;
+}
+
+static size_t GreyAlphaToRGBA(uint8_t* dst, const uint8_t* src,
+                              size_t count) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i ga =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+                     _mm_shuffle_epi8(ga, shuffle));
+  }
+  return i;
+}
+
+static size_t RGBToRGBA(uint8_t* dst, const uint8_t* src, size_t count) {
+  // 4 pixels per 16 byte load; the last 4 bytes of each load are unused,
+  // so stop while 16 bytes can still be read from the source
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  size_t i = 0;
+  for (; i + 6 <= count; i += 4) {
+    __m128i rgb =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+                     _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+  }
+  return i;
+}
+
+static size_t SwizzleRB(uint8_t* dst, const uint8_t* src, size_t count) {
+  const __m128i shuffle =
+      _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i rgba =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+                     _mm_shuffle_epi8(rgba, shuffle));
+  }
+  return i;
+}
+
+#else
+
+static size_t GreyToRGBA(uint8_t*, const uint8_t*, size_t) { return 0; }
+static size_t GreyAlphaToRGBA(uint8_t*, const uint8_t*, size_t) { return 0; }
+static size_t RGBToRGBA(uint8_t*, const uint8_t*, size_t) { return 0; }
+static size_t SwizzleRB(uint8_t*, const uint8_t*, size_t) { return 0; }
+
+#endif
+
+void tutorialConvertRowToRGBA(uint8_t* dst, const uint8_t* src, size_t count,
+                              uint32_t srcChannels) {
+  size_t i = 0;
+  switch (srcChannels) {
+    case 1:
+      for (i = GreyToRGBA(dst, src, count); i < count; i++) {
+        dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+        dst[i * 4 + 3] = 0xFF;
+      }
+      break;
+    case 2:
+      for (i = GreyAlphaToRGBA(dst, src, count); i < count; i++) {
+        dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i * 2];
+        dst[i * 4 + 3] = src[i * 2 + 1];
+      }
+      break;
+    case 3:
+      for (i = RGBToRGBA(dst, src, count); i < count; i++) {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 0xFF;
+      }
+      break;
+    case 4:
+      memcpy(dst, src, count * 4);
+      break;
+    default:
+      assert(false && "unsupported channel count");
+  }
+}
+
+void tutorialCopyImageToRGBA(void* dst, size_t dstRowPitch, const void* src,
+                             uint32_t width, uint32_t height,
+                             uint32_t srcChannels) {
+  uint8_t* dstRow = static_cast<uint8_t*>(dst);
+  const uint8_t* srcRow = static_cast<const uint8_t*>(src);
+  const size_t srcRowSize = static_cast<size_t>(width) * srcChannels;
+  if (srcChannels == 4 && dstRowPitch == srcRowSize) {
+    memcpy(dstRow, srcRow, srcRowSize * height);
+    return;
+  }
+  for (uint32_t y = 0; y < height; y++) {
+    tutorialConvertRowToRGBA(dstRow, srcRow, width, srcChannels);
+    dstRow += dstRowPitch;
+    srcRow += srcRowSize;
+  }
+}
+
+void tutorialSwizzleRGBA(uint8_t* dst, const uint8_t* src, size_t count) {
+  for (size_t i = SwizzleRB(dst, src, count); i < count; i++) {
+    uint8_t r = src[i * 4 + 0];
+    dst[i * 4 + 0] = src[i * 4 + 2];
+    dst[i * 4 + 1] = src[i * 4 + 1];
+    dst[i * 4 + 2] = r;
+    dst[i * 4 + 3] = src[i * 4 + 3];
+  }
+}
+
+void tutorialDownsampleRGBA(uint8_t* dst, const uint8_t* src,
+                            uint32_t srcWidth, uint32_t srcHeight) {
+  const uint32_t dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+  const uint32_t dstHeight = srcHeight > 1 ? srcHeight / 2 : 1;
+  const size_t srcPitch = static_cast<size_t>(srcWidth) * 4;
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    const uint8_t* row0 = src + srcPitch * (2 * y);
+    // a single row source (height 1) averages with itself
+    const uint8_t* row1 = (2 * y + 1 < srcHeight) ? row0 + srcPitch : row0;
+    uint8_t* out = dst + static_cast<size_t>(dstWidth) * 4 * y;
+    for (uint32_t x = 0; x < dstWidth; x++) {
+      uint32_t x0 = 2 * x * 4;
+      uint32_t x1 = (2 * x + 1 < srcWidth) ? x0 + 4 : x0;
+      for (uint32_t c = 0; c < 4; c++) {
+        out[x * 4 + c] = static_cast<uint8_t>(
+            (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >>
+            2);
+      }
+    }
+  }
+}
+
+const char* tutorialPixelsBackend(void) {
+#if defined(TUTORIAL_PIXELS_NEON)
+  return "neon";
+#elif defined(TUTORIAL_PIXELS_SSSE3)
+  return "ssse3";
+#else
+  return "scalar";
+#endif
+}
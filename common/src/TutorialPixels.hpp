@@ -0,0 +1,53 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_PIXELS_HPP
+#define TUTORIAL_PIXELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel conversion for texture uploads. Everything converts into tightly
+// packed RGBA8 pixels, the layout of VK_FORMAT_R8G8B8A8_*.
+// NEON (arm) or SSSE3 (x86) code is used when the compiler targets it, with
+// a scalar fallback everywhere else. Source and destination must not
+// overlap, except for tutorialSwizzleRGBA() which also works in place.
+
+// Convert one row of count pixels with srcChannels 8 bit channels
+// (1: grey, 2: grey + alpha, 3: RGB, 4: RGBA) into RGBA8.
+// Missing alpha is set to 0xFF.
+void tutorialConvertRowToRGBA(uint8_t* dst, const uint8_t* src, size_t count,
+                              uint32_t srcChannels);
+
+// Copy a width x height image with tightly packed source rows into a
+// destination whose rows are dstRowPitch bytes apart (eg. a mapped linear
+// image, see VkSubresourceLayout::rowPitch). RGBA sources are copied with a
+// single memcpy when the pitches match, one memcpy per row otherwise.
+void tutorialCopyImageToRGBA(void* dst, size_t dstRowPitch, const void* src,
+                             uint32_t width, uint32_t height,
+                             uint32_t srcChannels);
+
+// RGBA <-> BGRA: swap the first and third channel of count pixels
+void tutorialSwizzleRGBA(uint8_t* dst, const uint8_t* src, size_t count);
+
+// 2x2 box filter of a tightly packed RGBA8 image into the next mip level,
+// max(1, srcWidth / 2) x max(1, srcHeight / 2). The last row or column of
+// odd sized images is dropped, as a plain 2x2 box filter does.
+void tutorialDownsampleRGBA(uint8_t* dst, const uint8_t* src,
+                            uint32_t srcWidth, uint32_t srcHeight);
+
+// The code path compiled in: "neon", "ssse3" or "scalar"
+const char* tutorialPixelsBackend(void);
+
+#endif  // TUTORIAL_PIXELS_HPP
@@ -0,0 +1,428 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "TutorialPngDecoder.hpp"
+#include <zlib.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "TutorialPixels.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TUTORIAL_PNG_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define TUTORIAL_PNG_SSSE3 1
+#endif
+
+static const uint8_t kPngSignature[8] = {0x89, 'P',  'N',  'G',
+                                         '\r', '\n', 0x1A, '\n'};
+
+// Color types, and the filter type each row starts with
+static const uint8_t kColorGrey = 0;
+static const uint8_t kColorRGB = 2;
+static const uint8_t kColorPalette = 3;
+static const uint8_t kColorGreyAlpha = 4;
+static const uint8_t kColorRGBA = 6;
+enum PngFilter {
+  kFilterNone = 0,
+  kFilterSub = 1,
+  kFilterUp = 2,
+  kFilterAverage = 3,
+  kFilterPaeth = 4,
+};
+
+// Rows inflated per call: zlib copies up to 32KB of each call's output into
+// its window, the larger the band the less that costs
+static const size_t kBandBytes = 256 * 1024;
+// The largest side stb_image accepts
+static const uint32_t kMaxDimension = 1 << 24;
+// Images of at most this many pixels are declined: setting up zlib and the
+// band buffers costs more than its faster inflate saves. stb_image decodes
+// the tutorial's 256 x 256 texture, and flat 256 x 256 images, at least as
+// fast (decode_bench); from about 384 x 384 on zlib wins.
+static const uint64_t kStbMaxPixels = 256 * 256;
+
+static uint32_t ReadU32BE(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c) {
+  const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+// Sub, Average and Paeth depend on the pixel to the left, which keeps them
+// serial: the vector code does one pixel of 3 or 4 bytes per step, all
+// channels at once. Up has no such dependency and does 16 bytes a step.
+// Each returns how many bytes it did; the scalar loops finish the row.
+
+#if defined(TUTORIAL_PNG_NEON)
+
+template <uint32_t kBpp>
+static uint8x8_t LoadPixel(const uint8_t* p) {
+  uint32_t bits = 0;
+  memcpy(&bits, p, kBpp);
+  return vreinterpret_u8_u32(vdup_n_u32(bits));
+}
+
+template <uint32_t kBpp>
+static void StorePixel(uint8_t* p, uint8x8_t pixel) {
+  uint32_t bits = vget_lane_u32(vreinterpret_u32_u8(pixel), 0);
+  memcpy(p, &bits, kBpp);
+}
+
+static size_t UnfilterUp(uint8_t* dst, const uint8_t* src,
+                         const uint8_t* prev, size_t bytes) {
+  size_t i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    vst1q_u8(dst + i, vaddq_u8(vld1q_u8(src + i), vld1q_u8(prev + i)));
+  }
+  return i;
+}
+
+template <uint32_t kBpp>
+static size_t UnfilterPixels(uint8_t filter, uint8_t* dst, const uint8_t* src,
+                             const uint8_t* prev, size_t bytes) {
+  uint8x8_t a = vdup_n_u8(0), c = vdup_n_u8(0);
+  switch (filter) {
+    case kFilterSub:
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        a = vadd_u8(LoadPixel<kBpp>(src + i), a);
+        StorePixel<kBpp>(dst + i, a);
+      }
+      return bytes;
+    case kFilterAverage:
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        a = vadd_u8(LoadPixel<kBpp>(src + i),
+                    vhadd_u8(a, LoadPixel<kBpp>(prev + i)));
+        StorePixel<kBpp>(dst + i, a);
+      }
+      return bytes;
+    case kFilterPaeth:
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        // p = a + b - c; |p - a|, |p - b| and |p - c| in 16 bits
+        uint8x8_t b = LoadPixel<kBpp>(prev + i);
+        uint16x8_t pa = vabdl_u8(b, c);
+        uint16x8_t pb = vabdl_u8(a, c);
+        uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vshll_n_u8(c, 1));
+        uint8x8_t useA =
+            vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+        uint8x8_t useB = vmovn_u16(vcleq_u16(pb, pc));
+        uint8x8_t predictor = vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+        a = vadd_u8(LoadPixel<kBpp>(src + i), predictor);
+        StorePixel<kBpp>(dst + i, a);
+        c = b;
+      }
+      return bytes;
+  }
+  return 0;
+}
+
+#elif defined(TUTORIAL_PNG_SSSE3)
+
+template <uint32_t kBpp>
+static __m128i LoadPixel(const uint8_t* p) {
+  uint32_t bits = 0;
+  memcpy(&bits, p, kBpp);
+  return _mm_cvtsi32_si128(static_cast<int>(bits));
+}
+
+template <uint32_t kBpp>
+static void StorePixel(uint8_t* p, __m128i pixel) {
+  uint32_t bits = static_cast<uint32_t>(_mm_cvtsi128_si32(pixel));
+  memcpy(p, &bits, kBpp);
+}
+
+static size_t UnfilterUp(uint8_t* dst, const uint8_t* src,
+                         const uint8_t* prev, size_t bytes) {
+  size_t i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi8(x, b));
+  }
+  return i;
+}
+
+template <uint32_t kBpp>
+static size_t UnfilterPixels(uint8_t filter, uint8_t* dst, const uint8_t* src,
+                             const uint8_t* prev, size_t bytes) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero;
+  switch (filter) {
+    case kFilterSub:
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        a = _mm_add_epi8(LoadPixel<kBpp>(src + i), a);
+        StorePixel<kBpp>(dst + i, a);
+      }
+      return bytes;
+    case kFilterAverage: {
+      // _mm_avg_epu8() rounds up, PNG rounds down
+      const __m128i one = _mm_set1_epi8(1);
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        __m128i b = LoadPixel<kBpp>(prev + i);
+        __m128i average = _mm_sub_epi8(
+            _mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(LoadPixel<kBpp>(src + i), average);
+        StorePixel<kBpp>(dst + i, a);
+      }
+      return bytes;
+    }
+    case kFilterPaeth:
+      // a, b and c in 16 bit lanes; p = a + b - c, so |p - a| = |b - c|,
+      // |p - b| = |a - c| and |p - c| = |(b - c) + (a - c)|
+      for (size_t i = 0; i < bytes; i += kBpp) {
+        __m128i b = _mm_unpacklo_epi8(LoadPixel<kBpp>(prev + i), zero);
+        __m128i bc = _mm_sub_epi16(b, c);
+        __m128i ac = _mm_sub_epi16(a, c);
+        __m128i pa = _mm_abs_epi16(bc);
+        __m128i pb = _mm_abs_epi16(ac);
+        __m128i pc = _mm_abs_epi16(_mm_add_epi16(bc, ac));
+        __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        __m128i useA = _mm_cmpeq_epi16(pa, smallest);
+        __m128i useB = _mm_cmpeq_epi16(pb, smallest);
+        __m128i bOrC = _mm_or_si128(_mm_and_si128(useB, b),
+                                    _mm_andnot_si128(useB, c));
+        __m128i predictor = _mm_or_si128(_mm_and_si128(useA, a),
+                                         _mm_andnot_si128(useA, bOrC));
+        __m128i x = _mm_add_epi8(LoadPixel<kBpp>(src + i),
+                                 _mm_packus_epi16(predictor, predictor));
+        StorePixel<kBpp>(dst + i, x);
+        a = _mm_unpacklo_epi8(x, zero);
+        c = b;
+      }
+      return bytes;
+  }
+  return 0;
+}
+
+#endif
+
+static size_t UnfilterVector(uint8_t filter, uint8_t* dst, const uint8_t* src,
+                             const uint8_t* prev, size_t bytes,
+                             uint32_t bpp) {
+#if defined(TUTORIAL_PNG_NEON) || defined(TUTORIAL_PNG_SSSE3)
+  if (filter == kFilterUp) return UnfilterUp(dst, src, prev, bytes);
+  if (bpp == 4) return UnfilterPixels<4>(filter, dst, src, prev, bytes);
+  if (bpp == 3) return UnfilterPixels<3>(filter, dst, src, prev, bytes);
+#endif
+  return 0;
+}
+
+// Reconstruct the bytes of a row from its filtered bytes src and the row
+// above, prev. False on an unknown filter type.
+static bool Unfilter(uint8_t filter, uint8_t* dst, const uint8_t* src,
+                     const uint8_t* prev, size_t bytes, uint32_t bpp) {
+  size_t i = UnfilterVector(filter, dst, src, prev, bytes, bpp);
+  switch (filter) {
+    case kFilterNone:
+      memcpy(dst, src, bytes);
+      return true;
+    case kFilterSub:
+      for (; i < bytes; i++) {
+        dst[i] = src[i] + (i >= bpp ? dst[i - bpp] : 0);
+      }
+      return true;
+    case kFilterUp:
+      for (; i < bytes; i++) dst[i] = src[i] + prev[i];
+      return true;
+    case kFilterAverage:
+      for (; i < bytes; i++) {
+        dst[i] = src[i] + (((i >= bpp ? dst[i - bpp] : 0) + prev[i]) >> 1);
+      }
+      return true;
+    case kFilterPaeth:
+      for (; i < bytes; i++) {
+        dst[i] = src[i] + (i >= bpp ? Paeth(dst[i - bpp], prev[i],
+                                            prev[i - bpp])
+                                    : prev[i]);
+      }
+      return true;
+  }
+  return false;
+}
+
+class PngDecoder : public TutorialImageDecoder {
+ public:
+  const char* Name(void) const override {
+#if defined(TUTORIAL_PNG_NEON)
+    return "zlib+neon";
+#elif defined(TUTORIAL_PNG_SSSE3)
+    return "zlib+ssse3";
+#else
+    return "zlib";
+#endif
+  }
+  bool Decode(const void* data, size_t size,
+              TutorialImage* image) const override;
+};
+
+bool PngDecoder::Decode(const void* data, size_t size,
+                        TutorialImage* image) const {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + size;
+  if (size < sizeof(kPngSignature) ||
+      memcmp(p, kPngSignature, sizeof(kPngSignature))) {
+    return false;
+  }
+  p += sizeof(kPngSignature);
+
+  // Walk the chunks first: the header and palette are needed before any
+  // row, and the image data may be split over many IDAT chunks
+  uint32_t width = 0, height = 0, bpp = 0;
+  uint8_t colorType = 0;
+  uint8_t palette[256 * 4];
+  for (uint32_t i = 0; i < 256; i++) {
+    memcpy(&palette[i * 4], "\0\0\0\xFF", 4);
+  }
+  bool hasPalette = false;
+  std::vector<std::pair<const uint8_t*, uint32_t>> idat;
+  while (end - p >= 12) {
+    const uint32_t length = ReadU32BE(p);
+    const uint8_t* type = p + 4;
+    const uint8_t* chunk = p + 8;
+    if (length > static_cast<size_t>(end - chunk) - 4) return false;
+    p = chunk + length + 4;  // past the CRC, which zlib's Adler-32 makes moot
+
+    if (!memcmp(type, "IHDR", 4)) {
+      if (length != 13 || width) return false;
+      width = ReadU32BE(chunk);
+      height = ReadU32BE(chunk + 4);
+      colorType = chunk[9];
+      // 8 bit, deflate, adaptive filtering, no interlace
+      if (chunk[8] != 8 || chunk[10] || chunk[11] || chunk[12]) return false;
+      switch (colorType) {
+        case kColorGrey:
+        case kColorPalette:
+          bpp = 1;
+          break;
+        case kColorGreyAlpha:
+          bpp = 2;
+          break;
+        case kColorRGB:
+          bpp = 3;
+          break;
+        case kColorRGBA:
+          bpp = 4;
+          break;
+        default:
+          return false;
+      }
+      if (!width || !height || width > kMaxDimension ||
+          height > kMaxDimension ||
+          static_cast<uint64_t>(width) * height * 4 > SIZE_MAX / 2) {
+        return false;
+      }
+      if (static_cast<uint64_t>(width) * height <= kStbMaxPixels) {
+        return false;  // small: left to stb_image
+      }
+    } else if (!width) {
+      return false;  // IHDR comes first; CgBI (Apple) files fail here too
+    } else if (!memcmp(type, "PLTE", 4)) {
+      if (length % 3 || length > 256 * 3) return false;
+      for (uint32_t i = 0; i < length / 3; i++) {
+        memcpy(&palette[i * 4], chunk + i * 3, 3);
+      }
+      hasPalette = true;
+    } else if (!memcmp(type, "tRNS", 4)) {
+      // color keys add an alpha channel stb_image computes; leave them to it
+      if (colorType != kColorPalette || length > 256) return false;
+      for (uint32_t i = 0; i < length; i++) palette[i * 4 + 3] = chunk[i];
+    } else if (!memcmp(type, "IDAT", 4)) {
+      idat.emplace_back(chunk, length);
+    } else if (!memcmp(type, "IEND", 4)) {
+      break;
+    } else if (!(type[0] & 0x20)) {
+      return false;  // an unknown critical chunk
+    }
+  }
+  if (idat.empty() || (colorType == kColorPalette && !hasPalette)) {
+    return false;
+  }
+
+  // Filtered rows are a filter type byte followed by the row's bytes.
+  // Rows unfilter against the one above: RGBA rows right in the output,
+  // the others in two alternating lines that are converted to RGBA.
+  const size_t rowBytes = static_cast<size_t>(width) * bpp;
+  const size_t stride = rowBytes + 1;
+  const uint32_t bandRows = static_cast<uint32_t>(
+      std::min<size_t>(std::max<size_t>(kBandBytes / stride, 1), height));
+  const bool direct = colorType == kColorRGBA;
+  std::vector<uint8_t> band(bandRows * stride);
+  std::vector<uint8_t> lines(direct ? 0 : rowBytes * 2);
+  std::vector<uint8_t> zero(rowBytes, 0);
+  image->width_ = width;
+  image->height_ = height;
+  image->mipLevels_ = 1;
+  image->pixels_.resize(static_cast<size_t>(width) * height * 4);
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK) return false;
+  size_t nextChunk = 0;
+  const uint8_t* prev = zero.data();
+  bool ok = true;
+  for (uint32_t y = 0; ok && y < height;) {
+    const uint32_t rows = std::min(bandRows, height - y);
+    stream.next_out = band.data();
+    stream.avail_out = static_cast<uInt>(rows * stride);
+    while (ok && stream.avail_out) {
+      if (!stream.avail_in) {
+        if (nextChunk == idat.size()) {
+          ok = false;  // truncated
+          break;
+        }
+        stream.next_in = const_cast<Bytef*>(idat[nextChunk].first);
+        stream.avail_in = idat[nextChunk].second;
+        nextChunk++;
+        continue;
+      }
+      int result = inflate(&stream, Z_NO_FLUSH);
+      if (result == Z_STREAM_END) {
+        ok = !stream.avail_out;
+      } else {
+        ok = result == Z_OK;
+      }
+    }
+
+    for (uint32_t row = 0; ok && row < rows; row++, y++) {
+      const uint8_t* filtered = &band[row * stride];
+      uint8_t* rgba = &image->pixels_[static_cast<size_t>(y) * width * 4];
+      uint8_t* line = direct ? rgba : &lines[(y & 1) * rowBytes];
+      ok = Unfilter(filtered[0], line, filtered + 1, prev, rowBytes, bpp);
+      if (colorType == kColorPalette) {
+        for (uint32_t x = 0; x < width; x++) {
+          memcpy(rgba + x * 4, &palette[line[x] * 4], 4);
+        }
+      } else if (!direct) {
+        tutorialConvertRowToRGBA(rgba, line, width, bpp);
+      }
+      prev = line;
+    }
+  }
+  inflateEnd(&stream);
+  return ok;
+}
+
+static PngDecoder pngDecoder;
+
+const TutorialImageDecoder& tutorialPngDecoder(void) { return pngDecoder; }
@@ -0,0 +1,39 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TUTORIAL_PNG_DECODER_HPP
+#define TUTORIAL_PNG_DECODER_HPP
+
+#include "TutorialImageDecode.hpp"
+
+// A PNG decoder built for throughput, see tutorialSetImageDecoder():
+//   - zlib inflates, in bands of rows, straight out of the IDAT chunks.
+//     Android's system zlib (and Chromium's, which it is built from) has
+//     NEON or SSE optimized inflate; stb_image inflates one bit at a time.
+//   - Rows are unfiltered with NEON or SSSE3 code when the compiler targets
+//     it (see tutorialPixelsBackend()), and converted to RGBA8 as soon as
+//     they are, while still in cache. RGBA rows are unfiltered straight
+//     into the output.
+// It reads non interlaced 8 bit grey, grey + alpha, RGB, RGBA and palette
+// images, the ones texture assets are made of. Everything else (16 bit or
+// sub byte depths, interlacing, tRNS color keys) is declined and left to
+// stb_image, and so are images of 256 x 256 pixels or less, which
+// stb_image decodes faster. Link zlib (-lz, or "z" in the NDK) to use it.
+// It is no clear win over stb_image yet (about 1.1x on large images, 0.78x
+// to 1.19x on mid-size ones): tutorial06 only selects it when built with
+// -DTUTORIAL_PNG_DECODER. Measure with tools/decode_bench first.
+const TutorialImageDecoder& tutorialPngDecoder(void);
+
+#endif  // TUTORIAL_PNG_DECODER_HPP
@@ -0,0 +1,572 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialShaderReflect.hpp"
+#include <android/log.h>
+#include <algorithm>
+#include <cstring>
+#include "TutorialAssetArchive.hpp"
+
+static const char* kReflectTAG = "Vulkan-Reflect";
+#define REFLECT_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kReflectTAG, __VA_ARGS__))
+
+// The parts of the SPIR-V specification the parser needs
+static const uint32_t kSpirvMagic = 0x07230203;
+enum SpirvOp : uint32_t {
+  kOpEntryPoint = 15,
+  kOpTypeBool = 20,
+  kOpTypeInt = 21,
+  kOpTypeFloat = 22,
+  kOpTypeVector = 23,
+  kOpTypeMatrix = 24,
+  kOpTypeImage = 25,
+  kOpTypeSampler = 26,
+  kOpTypeSampledImage = 27,
+  kOpTypeArray = 28,
+  kOpTypeRuntimeArray = 29,
+  kOpTypeStruct = 30,
+  kOpTypePointer = 32,
+  kOpConstant = 43,
+  kOpSpecConstant = 50,
+  kOpFunction = 54,
+  kOpVariable = 59,
+  kOpDecorate = 71,
+  kOpMemberDecorate = 72,
+};
+enum SpirvDecoration : uint32_t {
+  kDecorationSpecId = 1,
+  kDecorationBlock = 2,
+  kDecorationBufferBlock = 3,
+  kDecorationArrayStride = 6,
+  kDecorationMatrixStride = 7,
+  kDecorationBuiltIn = 11,
+  kDecorationLocation = 30,
+  kDecorationBinding = 33,
+  kDecorationDescriptorSet = 34,
+  kDecorationOffset = 35,
+};
+enum SpirvStorageClass : uint32_t {
+  kStorageUniformConstant = 0,
+  kStorageInput = 1,
+  kStorageUniform = 2,
+  kStoragePushConstant = 9,
+  kStorageStorageBuffer = 12,
+};
+static const uint32_t kDimBuffer = 5;
+static const uint32_t kDimSubpassData = 6;
+static const uint32_t kNone = ~0u;
+
+// Execution model of OpEntryPoint to stage
+static const VkShaderStageFlagBits kStages[] = {
+    VK_SHADER_STAGE_VERTEX_BIT,
+    VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+    VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+    VK_SHADER_STAGE_GEOMETRY_BIT,
+    VK_SHADER_STAGE_FRAGMENT_BIT,
+    VK_SHADER_STAGE_COMPUTE_BIT,
+};
+
+// 32 bit vertex input formats by component count - 1, then uint, int, float
+static const VkFormat kInputFormats[4][3] = {
+    {VK_FORMAT_R32_UINT, VK_FORMAT_R32_SINT, VK_FORMAT_R32_SFLOAT},
+    {VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32_SFLOAT},
+    {VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SINT,
+     VK_FORMAT_R32G32B32_SFLOAT},
+    {VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SINT,
+     VK_FORMAT_R32G32B32A32_SFLOAT},
+};
+
+// What the declarations say about one id
+struct SpirvId {
+  const uint32_t* op_;  // the instruction defining it, nullptr if none
+  uint32_t location_;
+  uint32_t binding_;
+  uint32_t set_;
+  uint32_t specId_;
+  uint32_t arrayStride_;
+  bool builtIn_;
+  bool block_;
+  bool bufferBlock_;
+  // structs: per member
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> matrixStrides_;
+};
+
+class SpirvModule {
+ public:
+  SpirvModule(const TutorialSpecialization* constants, std::string* error)
+      : constants_(constants), error_(error) {}
+
+  bool Parse(const uint32_t* code, size_t words);
+  bool Reflect(TutorialShaderReflection* reflection);
+
+ private:
+  bool Fail(const std::string& error) {
+    *error_ = error;
+    return false;
+  }
+  SpirvId* Id(uint32_t id) { return id < ids_.size() ? &ids_[id] : nullptr; }
+  // The defining instruction of id if it is op
+  const uint32_t* Op(uint32_t id, uint32_t op) {
+    SpirvId* info = Id(id);
+    if (!info || !info->op_ || (info->op_[0] & 0xFFFF) != op) return nullptr;
+    return info->op_;
+  }
+  uint32_t OpOf(uint32_t id) {
+    SpirvId* info = Id(id);
+    return (info && info->op_) ? (info->op_[0] & 0xFFFF) : 0;
+  }
+  // Value of an integer constant, specialized; kNone if it is none
+  uint32_t Constant(uint32_t id);
+  // Bytes a value of type takes in a block
+  uint32_t Size(uint32_t type, uint32_t matrixStride);
+  bool Resource(uint32_t variable, uint32_t storage, uint32_t type,
+                TutorialShaderReflection* reflection);
+  bool Input(uint32_t variable, uint32_t type,
+             TutorialShaderReflection* reflection);
+
+  const TutorialSpecialization* constants_;
+  std::string* error_;
+  std::vector<SpirvId> ids_;
+  const uint32_t* entryPoint_ = nullptr;
+  std::vector<uint32_t> variables_;
+};
+
+bool SpirvModule::Parse(const uint32_t* code, size_t words) {
+  if (words < 5 || code[0] != kSpirvMagic) return Fail("not SPIR-V");
+  ids_.assign(code[3], SpirvId{nullptr, kNone, kNone, 0, kNone, 0, false,
+                               false, false, {}, {}});
+  for (size_t at = 5; at < words;) {
+    const uint32_t* op = code + at;
+    const uint32_t count = op[0] >> 16;
+    if (!count || at + count > words) return Fail("truncated instruction");
+    at += count;
+    switch (op[0] & 0xFFFF) {
+      case kOpEntryPoint:
+        if (!entryPoint_) entryPoint_ = op;
+        break;
+      case kOpTypeBool:
+      case kOpTypeInt:
+      case kOpTypeFloat:
+      case kOpTypeVector:
+      case kOpTypeMatrix:
+      case kOpTypeImage:
+      case kOpTypeSampler:
+      case kOpTypeSampledImage:
+      case kOpTypeArray:
+      case kOpTypeRuntimeArray:
+      case kOpTypeStruct:
+      case kOpTypePointer:
+        if (count < 2 || !Id(op[1])) return Fail("bad type");
+        ids_[op[1]].op_ = op;
+        break;
+      case kOpConstant:
+      case kOpSpecConstant:
+      case kOpVariable:
+        if (count < 4 || !Id(op[2])) return Fail("bad declaration");
+        ids_[op[2]].op_ = op;
+        if ((op[0] & 0xFFFF) == kOpVariable) variables_.push_back(op[2]);
+        break;
+      case kOpDecorate: {
+        SpirvId* id = Id(count >= 3 ? op[1] : kNone);
+        if (!id) return Fail("bad decoration");
+        const uint32_t value = count >= 4 ? op[3] : 0;
+        switch (op[2]) {
+          case kDecorationSpecId: id->specId_ = value; break;
+          case kDecorationBlock: id->block_ = true; break;
+          case kDecorationBufferBlock: id->bufferBlock_ = true; break;
+          case kDecorationArrayStride: id->arrayStride_ = value; break;
+          case kDecorationBuiltIn: id->builtIn_ = true; break;
+          case kDecorationLocation: id->location_ = value; break;
+          case kDecorationBinding: id->binding_ = value; break;
+          case kDecorationDescriptorSet: id->set_ = value; break;
+        }
+        break;
+      }
+      case kOpMemberDecorate: {
+        SpirvId* id = Id(count >= 4 ? op[1] : kNone);
+        if (!id || op[2] > 0xFFFF) return Fail("bad member decoration");
+        const uint32_t member = op[2];
+        const uint32_t value = count >= 5 ? op[4] : 0;
+        if (id->offsets_.size() <= member) {
+          id->offsets_.resize(member + 1, 0);
+          id->matrixStrides_.resize(member + 1, 0);
+        }
+        if (op[3] == kDecorationOffset) id->offsets_[member] = value;
+        if (op[3] == kDecorationMatrixStride) {
+          id->matrixStrides_[member] = value;
+        }
+        if (op[3] == kDecorationBuiltIn) id->builtIn_ = true;
+        break;
+      }
+      case kOpFunction:
+        // declarations all come before the first function
+        at = words;
+        break;
+    }
+  }
+  if (!entryPoint_) return Fail("no entry point");
+  return true;
+}
+
+uint32_t SpirvModule::Constant(uint32_t id) {
+  SpirvId* info = Id(id);
+  uint32_t op = OpOf(id);
+  if (op != kOpConstant && op != kOpSpecConstant) return kNone;
+  uint32_t value = info->op_[3];
+  if (op == kOpSpecConstant && constants_ && info->specId_ != kNone) {
+    constants_->Get(info->specId_, &value);
+  }
+  return value;
+}
+
+uint32_t SpirvModule::Size(uint32_t type, uint32_t matrixStride) {
+  const uint32_t* op = Id(type) ? Id(type)->op_ : nullptr;
+  switch (OpOf(type)) {
+    case kOpTypeBool:
+      return 4;
+    case kOpTypeInt:
+    case kOpTypeFloat:
+      return op[2] / 8;
+    case kOpTypeVector:
+      return op[3] * Size(op[2], 0);
+    case kOpTypeMatrix:
+      return op[3] * (matrixStride ? matrixStride : Size(op[2], 0));
+    case kOpTypeArray: {
+      uint32_t length = Constant(op[3]);
+      uint32_t stride = Id(type)->arrayStride_;
+      if (length == kNone) return 0;
+      return length * (stride ? stride : Size(op[2], matrixStride));
+    }
+    case kOpTypeStruct: {
+      const SpirvId* info = Id(type);
+      uint32_t size = 0;
+      for (uint32_t member = 0; member + 2 < (op[0] >> 16); member++) {
+        uint32_t offset = 0, stride = 0;
+        if (member < info->offsets_.size()) {
+          offset = info->offsets_[member];
+          stride = info->matrixStrides_[member];
+        }
+        size = std::max(size, offset + Size(op[2 + member], stride));
+      }
+      return size;
+    }
+  }
+  return 0;
+}
+
+bool SpirvModule::Resource(uint32_t variable, uint32_t storage, uint32_t type,
+                           TutorialShaderReflection* reflection) {
+  const SpirvId& info = ids_[variable];
+  // arrays of descriptors
+  uint32_t count = 1;
+  while (OpOf(type) == kOpTypeArray) {
+    uint32_t length = Constant(Id(type)->op_[3]);
+    if (length == kNone) return Fail("array of descriptors of unknown size");
+    count *= length;
+    type = Id(type)->op_[2];
+  }
+  if (OpOf(type) == kOpTypeRuntimeArray) {
+    return Fail("runtime arrays of descriptors are not supported");
+  }
+
+  VkDescriptorType descriptorType;
+  const uint32_t* op = Id(type) ? Id(type)->op_ : nullptr;
+  switch (OpOf(type)) {
+    case kOpTypeSampledImage:
+      descriptorType = (Op(op[2], kOpTypeImage) &&
+                        Id(op[2])->op_[3] == kDimBuffer)
+                           ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+                           : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      break;
+    case kOpTypeSampler:
+      descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+      break;
+    case kOpTypeImage:
+      if (op[3] == kDimSubpassData) {
+        descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+      } else if (op[3] == kDimBuffer) {
+        descriptorType = op[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                    : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+      } else {
+        descriptorType = op[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                                    : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      }
+      break;
+    case kOpTypeStruct:
+      if (storage == kStorageStorageBuffer || Id(type)->bufferBlock_) {
+        descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      } else if (Id(type)->block_) {
+        descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      } else {
+        return Fail("uniform struct without Block decoration");
+      }
+      break;
+    default:
+      return Fail("unsupported descriptor type");
+  }
+  if (info.binding_ == kNone) return Fail("descriptor without binding");
+  reflection->bindings_.push_back(TutorialShaderBinding{
+      info.set_, info.binding_, descriptorType, count,
+      static_cast<VkShaderStageFlags>(reflection->stage_)});
+  return true;
+}
+
+bool SpirvModule::Input(uint32_t variable, uint32_t type,
+                        TutorialShaderReflection* reflection) {
+  const SpirvId& info = ids_[variable];
+  if (info.builtIn_ || (Id(type) && Id(type)->builtIn_)) return true;
+  if (info.location_ == kNone) return Fail("vertex input without location");
+  uint32_t components = 1, component = type;
+  if (OpOf(type) == kOpTypeVector) {
+    components = Id(type)->op_[3];
+    component = Id(type)->op_[2];
+  }
+  const uint32_t* op = Id(component) ? Id(component)->op_ : nullptr;
+  int kind;
+  if (OpOf(component) == kOpTypeFloat && op[2] == 32) {
+    kind = 2;
+  } else if (OpOf(component) == kOpTypeInt && op[2] == 32) {
+    kind = op[3] ? 1 : 0;
+  } else {
+    return Fail("vertex inputs must be 32 bit scalars or vectors");
+  }
+  if (components < 1 || components > 4) return Fail("bad vertex input");
+  reflection->inputs_.push_back(TutorialShaderInput{
+      info.location_, kInputFormats[components - 1][kind], components * 4});
+  return true;
+}
+
+bool SpirvModule::Reflect(TutorialShaderReflection* reflection) {
+  const uint32_t model = entryPoint_[1];
+  if (model >= sizeof(kStages) / sizeof(kStages[0])) {
+    return Fail("unsupported execution model");
+  }
+  reflection->stage_ = kStages[model];
+  reflection->bindings_.clear();
+  reflection->inputs_.clear();
+  reflection->pushConstantOffset_ = 0;
+  reflection->pushConstantSize_ = 0;
+
+  // the interface ids follow the NUL terminated name
+  const uint32_t count = entryPoint_[0] >> 16;
+  uint32_t at = 3;
+  while (at < count) {
+    uint32_t word = entryPoint_[at++];
+    if (!(word & 0xFF000000) || !(word & 0xFF0000) || !(word & 0xFF00) ||
+        !(word & 0xFF)) {
+      break;
+    }
+  }
+  std::vector<uint32_t> interface(entryPoint_ + at, entryPoint_ + count);
+
+  for (uint32_t variable : variables_) {
+    const uint32_t* op = ids_[variable].op_;
+    const uint32_t storage = op[3];
+    const uint32_t* pointer = Op(op[1], kOpTypePointer);
+    if (!pointer) return Fail("variable is not a pointer");
+    const uint32_t type = pointer[3];
+    switch (storage) {
+      case kStorageUniformConstant:
+      case kStorageUniform:
+      case kStorageStorageBuffer:
+        if (!Resource(variable, storage, type, reflection)) return false;
+        break;
+      case kStoragePushConstant: {
+        const SpirvId* block = Id(type);
+        if (OpOf(type) != kOpTypeStruct) return Fail("bad push constants");
+        uint32_t offset = ~0u;
+        for (uint32_t member : block->offsets_) {
+          offset = std::min(offset, member);
+        }
+        reflection->pushConstantOffset_ = offset == ~0u ? 0 : offset;
+        reflection->pushConstantSize_ =
+            Size(type, 0) - reflection->pushConstantOffset_;
+        break;
+      }
+      case kStorageInput:
+        if (reflection->stage_ == VK_SHADER_STAGE_VERTEX_BIT &&
+            std::find(interface.begin(), interface.end(), variable) !=
+                interface.end()) {
+          if (!Input(variable, type, reflection)) return false;
+        }
+        break;
+    }
+  }
+
+  std::sort(reflection->bindings_.begin(), reflection->bindings_.end(),
+            [](const TutorialShaderBinding& a, const TutorialShaderBinding& b) {
+              return a.set_ != b.set_ ? a.set_ < b.set_
+                                      : a.binding_ < b.binding_;
+            });
+  std::sort(reflection->inputs_.begin(), reflection->inputs_.end(),
+            [](const TutorialShaderInput& a, const TutorialShaderInput& b) {
+              return a.location_ < b.location_;
+            });
+  return true;
+}
+
+bool tutorialReflectShader(const uint32_t* code, size_t size,
+                           const TutorialSpecialization* constants,
+                           TutorialShaderReflection* reflection,
+                           std::string* error) {
+  SpirvModule module(constants, error);
+  return module.Parse(code, size / sizeof(uint32_t)) &&
+         module.Reflect(reflection);
+}
+
+const TutorialShaderReflection* TutorialShaderReflector::Reflect(
+    const uint32_t* code, size_t size,
+    const TutorialSpecialization* constants) {
+  uint64_t key = tutorialFnv1a64(code, size);
+  if (constants) key = constants->Hash(key);
+  auto it = reflections_.find(key);
+  if (it != reflections_.end()) return &it->second;
+
+  TutorialShaderReflection reflection;
+  std::string error;
+  if (!tutorialReflectShader(code, size, constants, &reflection, &error)) {
+    REFLECT_LOGE("cannot reflect shader: %s", error.c_str());
+    return nullptr;
+  }
+  return &(reflections_[key] = std::move(reflection));
+}
+
+TutorialShaderInterface::TutorialShaderInterface()
+    : pushConstants_{0, 0, 0}, stride_(0) {}
+
+void TutorialShaderInterface::Add(const TutorialShaderReflection& stage) {
+  for (auto& binding : stage.bindings_) {
+    auto it = std::lower_bound(
+        bindings_.begin(), bindings_.end(), binding,
+        [](const TutorialShaderBinding& a, const TutorialShaderBinding& b) {
+          return a.set_ != b.set_ ? a.set_ < b.set_ : a.binding_ < b.binding_;
+        });
+    if (it != bindings_.end() && it->set_ == binding.set_ &&
+        it->binding_ == binding.binding_) {
+      // the same descriptor seen by another stage
+      it->stages_ |= binding.stages_;
+      it->count_ = std::max(it->count_, binding.count_);
+    } else {
+      bindings_.insert(it, binding);
+    }
+  }
+
+  if (stage.pushConstantSize_) {
+    const uint32_t end = std::max(
+        pushConstants_.offset + pushConstants_.size,
+        stage.pushConstantOffset_ + stage.pushConstantSize_);
+    pushConstants_.offset =
+        pushConstants_.stageFlags
+            ? std::min(pushConstants_.offset, stage.pushConstantOffset_)
+            : stage.pushConstantOffset_;
+    pushConstants_.size = end - pushConstants_.offset;
+    pushConstants_.stageFlags |= stage.stage_;
+  }
+
+  if (stage.stage_ == VK_SHADER_STAGE_VERTEX_BIT) {
+    attributes_.clear();
+    stride_ = 0;
+    for (auto& input : stage.inputs_) {
+      attributes_.push_back(VkVertexInputAttributeDescription{
+          input.location_, 0, input.format_, stride_});
+      stride_ += input.size_;
+    }
+  }
+}
+
+VkResult TutorialShaderInterface::CreateSetLayouts(
+    VkDevice device, std::vector<VkDescriptorSetLayout>* layouts) const {
+  layouts->clear();
+  const uint32_t sets = bindings_.empty() ? 0 : bindings_.back().set_ + 1;
+  for (uint32_t set = 0; set < sets; set++) {
+    std::vector<VkDescriptorSetLayoutBinding> setBindings;
+    for (auto& binding : bindings_) {
+      if (binding.set_ != set) continue;
+      setBindings.push_back(VkDescriptorSetLayoutBinding{
+          binding.binding_, binding.type_, binding.count_, binding.stages_,
+          nullptr});
+    }
+    VkDescriptorSetLayoutCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .bindingCount = static_cast<uint32_t>(setBindings.size()),
+        .pBindings = setBindings.data(),
+    };
+    VkDescriptorSetLayout layout;
+    VkResult result =
+        vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &layout);
+    if (result != VK_SUCCESS) {
+      for (auto created : *layouts) {
+        vkDestroyDescriptorSetLayout(device, created, nullptr);
+      }
+      layouts->clear();
+      return result;
+    }
+    layouts->push_back(layout);
+  }
+  return VK_SUCCESS;
+}
+
+VkResult TutorialShaderInterface::CreatePipelineLayout(
+    VkDevice device, const std::vector<VkDescriptorSetLayout>& setLayouts,
+    VkPipelineLayout* layout) const {
+  VkPipelineLayoutCreateInfo createInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+      .pSetLayouts = setLayouts.data(),
+      .pushConstantRangeCount = pushConstants_.stageFlags ? 1u : 0u,
+      .pPushConstantRanges = &pushConstants_,
+  };
+  return vkCreatePipelineLayout(device, &createInfo, nullptr, layout);
+}
+
+std::vector<VkDescriptorPoolSize> TutorialShaderInterface::PoolSizes(
+    uint32_t set) const {
+  std::vector<VkDescriptorPoolSize> sizes;
+  for (auto& binding : bindings_) {
+    if (binding.set_ != set) continue;
+    auto it = std::find_if(sizes.begin(), sizes.end(),
+                           [&binding](const VkDescriptorPoolSize& size) {
+                             return size.type == binding.type_;
+                           });
+    if (it == sizes.end()) {
+      sizes.push_back(VkDescriptorPoolSize{binding.type_, binding.count_});
+    } else {
+      it->descriptorCount += binding.count_;
+    }
+  }
+  return sizes;
+}
+
+const VkPipelineVertexInputStateCreateInfo*
+TutorialShaderInterface::VertexInput(void) {
+  vertexBinding_ = VkVertexInputBindingDescription{
+      0, stride_, VK_VERTEX_INPUT_RATE_VERTEX};
+  vertexInput_ = VkPipelineVertexInputStateCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .vertexBindingDescriptionCount = attributes_.empty() ? 0u : 1u,
+      .pVertexBindingDescriptions = &vertexBinding_,
+      .vertexAttributeDescriptionCount =
+          static_cast<uint32_t>(attributes_.size()),
+      .pVertexAttributeDescriptions = attributes_.data(),
+  };
+  return &vertexInput_;
+}
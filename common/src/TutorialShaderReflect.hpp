@@ -0,0 +1,118 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_SHADER_REFLECT_HPP
+#define TUTORIAL_SHADER_REFLECT_HPP
+
+#include <vulkan_wrapper.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TutorialPipelineVariants.hpp"
+
+// A descriptor used by shaders: layout (set = S, binding = B)
+struct TutorialShaderBinding {
+  uint32_t set_;
+  uint32_t binding_;
+  VkDescriptorType type_;
+  uint32_t count_;  // array size, 1 for a single descriptor
+  VkShaderStageFlags stages_;
+};
+
+// A vertex shader input: layout (location = L) in
+struct TutorialShaderInput {
+  uint32_t location_;
+  VkFormat format_;
+  uint32_t size_;  // bytes
+};
+
+// What one shader module takes from its pipeline
+struct TutorialShaderReflection {
+  VkShaderStageFlagBits stage_;
+  std::vector<TutorialShaderBinding> bindings_;  // by set, then binding
+  // Bytes of the push constant block the shader reads, none if size is 0
+  uint32_t pushConstantOffset_;
+  uint32_t pushConstantSize_;
+  std::vector<TutorialShaderInput> inputs_;  // vertex shaders, by location
+};
+
+// Parse the declarations of a SPIR-V module: its first entry point, the
+// descriptors, the push constant block, and for vertex shaders the inputs.
+// Arrays sized by specialization constants take their value in constants,
+// or their default without. On failure error says why.
+bool tutorialReflectShader(const uint32_t* code, size_t size,
+                           const TutorialSpecialization* constants,
+                           TutorialShaderReflection* reflection,
+                           std::string* error);
+
+// TutorialShaderReflector:
+//   Reflect modules once: the reflections are kept by the FNV-1a 64 of the
+//   SPIR-V and of the specialization, so a module shared by many pipelines
+//   is parsed for the first one only. Render thread only.
+class TutorialShaderReflector {
+ public:
+  // The reflection of code, valid until Clear(); nullptr if it does not
+  // parse, after logging why
+  const TutorialShaderReflection* Reflect(
+      const uint32_t* code, size_t size,
+      const TutorialSpecialization* constants = nullptr);
+  void Clear(void) { reflections_.clear(); }
+  size_t Count(void) const { return reflections_.size(); }
+
+ private:
+  std::unordered_map<uint64_t, TutorialShaderReflection> reflections_;
+};
+
+// TutorialShaderInterface:
+//   The stages of a pipeline together, and the layouts they imply instead
+//   of tables kept in sync with the shaders by hand:
+//   - a descriptor set layout per set, the bindings of all stages merged
+//   - a pipeline layout with one push constant range for the stages using
+//     push constants
+//   - the vertex input state: one binding holding the vertex shader's
+//     inputs in location order, tightly packed
+class TutorialShaderInterface {
+ public:
+  TutorialShaderInterface();
+
+  void Add(const TutorialShaderReflection& stage);
+
+  // One layout for every set up to the highest used; sets in between get
+  // empty ones
+  VkResult CreateSetLayouts(VkDevice device,
+                            std::vector<VkDescriptorSetLayout>* layouts) const;
+  VkResult CreatePipelineLayout(
+      VkDevice device, const std::vector<VkDescriptorSetLayout>& setLayouts,
+      VkPipelineLayout* layout) const;
+  // Pool sizes for one descriptor set of set
+  std::vector<VkDescriptorPoolSize> PoolSizes(uint32_t set) const;
+  // Points into this object; valid until the next Add()
+  const VkPipelineVertexInputStateCreateInfo* VertexInput(void);
+
+  const std::vector<TutorialShaderBinding>& Bindings(void) const {
+    return bindings_;
+  }
+  uint32_t VertexStride(void) const { return stride_; }
+
+ private:
+  std::vector<TutorialShaderBinding> bindings_;  // by set, then binding
+  VkPushConstantRange pushConstants_;
+  std::vector<VkVertexInputAttributeDescription> attributes_;
+  uint32_t stride_;
+  VkVertexInputBindingDescription vertexBinding_;
+  VkPipelineVertexInputStateCreateInfo vertexInput_;
+};
+
+#endif  // TUTORIAL_SHADER_REFLECT_HPP
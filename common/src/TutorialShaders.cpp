@@ -12,32 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "TutorialShaders.hpp"
+#include "TutorialAsset.hpp"
 
 extern VkDevice tutorialDevice;
-extern AAssetManager* tutorialAssetManager;
+extern TutorialAssetSource* tutorialAssets;
 
 VkResult loadShaderFromFile(const char* filePath, VkShaderModule* shaderOut,
                             ShaderType type) {
-  // Read the file:
-  AAsset* file =
-      AAssetManager_open(tutorialAssetManager, filePath, AASSET_MODE_BUFFER);
-  size_t fileLength = AAsset_getLength(file);
-
-  char* fileContent = new char[fileLength];
-
-  AAsset_read(file, fileContent, fileLength);
+  // SPIR-V is read where the asset lives, it only has to be word aligned
+  TutorialAssetView file;
+  if (!tutorialAssets->Open(filePath, &file, sizeof(uint32_t))) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
 
   VkShaderModuleCreateInfo shaderModuleCreateInfo{
       .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
       .pNext = nullptr,
-      .codeSize = fileLength,
-      .pCode = (const uint32_t*)fileContent,
       .flags = 0,
+      .codeSize = file.Size(),
+      .pCode = reinterpret_cast<const uint32_t*>(file.Data()),
   };
-  VkResult result = vkCreateShaderModule(
-      tutorialDevice, &shaderModuleCreateInfo, nullptr, shaderOut);
-
-  delete[] fileContent;
-
-  return result;
+  return vkCreateShaderModule(tutorialDevice, &shaderModuleCreateInfo,
+                              nullptr, shaderOut);
 }
@@ -0,0 +1,197 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialStagingRing.hpp"
+#include <android/log.h>
+#include <cassert>
+
+static const char* kStagingTAG = "Vulkan-StagingRing";
+#define STAGING_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kStagingTAG, __VA_ARGS__))
+
+#define STAGING_CALL_VK(func)                                             \
+  if (VK_SUCCESS != (func)) {                                             \
+    __android_log_print(ANDROID_LOG_ERROR, kStagingTAG,                   \
+                        "Vulkan error. File[%s], line[%d]", __FILE__,     \
+                        __LINE__);                                        \
+    assert(false);                                                        \
+  }
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+TutorialStagingRing::TutorialStagingRing()
+    : device_(VK_NULL_HANDLE),
+      allocator_(nullptr),
+      buffer_(VK_NULL_HANDLE),
+      memory_(),
+      size_(0),
+      head_(0),
+      tail_(0),
+      used_(0),
+      peakUsed_(0),
+      batchBytes_(0),
+      nextValue_(1),
+      completedValue_(0) {}
+
+TutorialStagingRing::~TutorialStagingRing() {
+  assert(buffer_ == VK_NULL_HANDLE && "Destroy() was not called");
+}
+
+void TutorialStagingRing::Init(VkDevice device,
+                               TutorialMemoryAllocator* allocator,
+                               VkDeviceSize size) {
+  device_ = device;
+  allocator_ = allocator;
+  size_ = size;
+  head_ = tail_ = used_ = peakUsed_ = batchBytes_ = 0;
+
+  VkBufferCreateInfo bufferCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size = size_,
+      .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 0,
+      .pQueueFamilyIndices = nullptr,
+  };
+  STAGING_CALL_VK(
+      vkCreateBuffer(device_, &bufferCreateInfo, nullptr, &buffer_));
+  STAGING_CALL_VK(allocator_->AllocateBuffer(buffer_, kTutorialMemoryStaging,
+                                             "staging ring", &memory_));
+  assert(memory_.mapped_);
+}
+
+void TutorialStagingRing::Destroy(void) {
+  if (buffer_ == VK_NULL_HANDLE) return;
+  Update(true);
+  STAGING_LOGI("peak usage %llu of %llu KB",
+               static_cast<unsigned long long>(peakUsed_ >> 10),
+               static_cast<unsigned long long>(size_ >> 10));
+  for (auto fence : freeFences_) {
+    vkDestroyFence(device_, fence, nullptr);
+  }
+  freeFences_.clear();
+  vkDestroyBuffer(device_, buffer_, nullptr);
+  allocator_->Free(&memory_);
+  buffer_ = VK_NULL_HANDLE;
+}
+
+bool TutorialStagingRing::Place(VkDeviceSize size, VkDeviceSize alignment,
+                                VkDeviceSize* offset,
+                                VkDeviceSize* consumed) const {
+  if (size > size_) return false;
+  if (used_ == 0) {
+    // empty ring: start over from the beginning, nothing to wrap around
+    *offset = 0;
+    *consumed = size;
+    return true;
+  }
+
+  VkDeviceSize begin = AlignUp(head_, alignment);
+  if (head_ > tail_) {
+    // free space is [head_, size_) and [0, tail_)
+    if (begin + size <= size_) {
+      *offset = begin;
+      *consumed = begin + size - head_;
+      return true;
+    }
+    if (size <= tail_) {
+      *offset = 0;
+      *consumed = (size_ - head_) + size;
+      return true;
+    }
+    return false;
+  }
+  // free space is [head_, tail_); head_ == tail_ means full
+  if (head_ < tail_ && begin + size <= tail_) {
+    *offset = begin;
+    *consumed = begin + size - head_;
+    return true;
+  }
+  return false;
+}
+
+bool TutorialStagingRing::CanAllocate(VkDeviceSize size,
+                                      VkDeviceSize alignment) const {
+  VkDeviceSize offset, consumed;
+  return Place(size, alignment, &offset, &consumed);
+}
+
+bool TutorialStagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment,
+                                   TutorialStagingRegion* region) {
+  VkDeviceSize offset, consumed;
+  if (!Place(size, alignment, &offset, &consumed)) return false;
+
+  if (used_ == 0) {
+    // batches still in flight are empty; they must not move tail_ away
+    // from the restarted ring when they retire
+    head_ = tail_ = 0;
+    for (auto& batch : batches_) batch.end_ = 0;
+  }
+  head_ = offset + size;
+  if (head_ == size_) head_ = 0;
+  used_ += consumed;
+  batchBytes_ += consumed;
+  if (used_ > peakUsed_) peakUsed_ = used_;
+
+  region->buffer_ = buffer_;
+  region->offset_ = offset;
+  region->size_ = size;
+  region->mapped_ = static_cast<uint8_t*>(memory_.mapped_) + offset;
+  return true;
+}
+
+void TutorialStagingRing::Flush(const TutorialStagingRegion& region) {
+  allocator_->Flush(memory_, region.offset_, region.size_);
+}
+
+VkFence TutorialStagingRing::EndBatch(uint64_t* value) {
+  VkFence fence;
+  if (!freeFences_.empty()) {
+    fence = freeFences_.back();
+    freeFences_.pop_back();
+  } else {
+    VkFenceCreateInfo fenceInfo{
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+    };
+    STAGING_CALL_VK(vkCreateFence(device_, &fenceInfo, nullptr, &fence));
+  }
+  batches_.push_back(Batch{nextValue_, fence, head_, batchBytes_});
+  batchBytes_ = 0;
+  *value = nextValue_++;
+  return fence;
+}
+
+uint64_t TutorialStagingRing::Update(bool wait) {
+  while (!batches_.empty()) {
+    Batch& batch = batches_.front();
+    VkResult status =
+        wait ? vkWaitForFences(device_, 1, &batch.fence_, VK_TRUE, UINT64_MAX)
+             : vkGetFenceStatus(device_, batch.fence_);
+    if (status != VK_SUCCESS) break;
+
+    STAGING_CALL_VK(vkResetFences(device_, 1, &batch.fence_));
+    freeFences_.push_back(batch.fence_);
+    tail_ = batch.end_;
+    used_ -= batch.bytes_;
+    completedValue_ = batch.value_;
+    batches_.pop_front();
+  }
+  return completedValue_;
+}
@@ -0,0 +1,108 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_STAGING_RING_HPP
+#define TUTORIAL_STAGING_RING_HPP
+
+#include <vulkan_wrapper.h>
+#include <deque>
+#include <vector>
+#include "TutorialMemory.hpp"
+
+// A piece of the staging ring: write size_ bytes at mapped_, then copy from
+// (buffer_, offset_) with vkCmdCopyBufferToImage/vkCmdCopyBuffer.
+struct TutorialStagingRegion {
+  VkBuffer buffer_;
+  VkDeviceSize offset_;
+  VkDeviceSize size_;
+  uint8_t* mapped_;
+};
+
+// TutorialStagingRing:
+//   One persistently mapped staging buffer, handed out as a ring. Regions
+//   allocated between two EndBatch() calls form a batch; EndBatch() returns
+//   the fence to submit the batch's copies with, and the batch gets the next
+//   value of a 64 bit timeline. Update() reclaims the space of the batches
+//   whose fence has signaled, oldest first, and reports the last completed
+//   timeline value, so callers can tell which of their uploads are done.
+//   Nothing is allocated after Init(): peak staging memory is the ring size.
+//   Render thread only.
+class TutorialStagingRing {
+ public:
+  TutorialStagingRing();
+  ~TutorialStagingRing();
+
+  void Init(VkDevice device, TutorialMemoryAllocator* allocator,
+            VkDeviceSize size = kDefaultSize);
+  // Waits for every batch submitted so far
+  void Destroy(void);
+
+  // Reserve size bytes aligned to alignment (a power of two). Returns false
+  // when they do not fit until older batches complete.
+  bool Allocate(VkDeviceSize size, VkDeviceSize alignment,
+                TutorialStagingRegion* region);
+  // Whether Allocate() would succeed right now
+  bool CanAllocate(VkDeviceSize size, VkDeviceSize alignment) const;
+  // Make the host writes to region visible to the device
+  void Flush(const TutorialStagingRegion& region);
+
+  // Close the current batch. Submit the copies reading its regions with the
+  // returned fence (exactly once); *value receives the batch's timeline value.
+  VkFence EndBatch(uint64_t* value);
+
+  // Reclaim completed batches; with wait, block until every submitted batch
+  // is done. Returns the last completed timeline value.
+  uint64_t Update(bool wait = false);
+  uint64_t CompletedValue(void) const { return completedValue_; }
+  // Nothing allocated, nothing in flight
+  bool Idle(void) const { return used_ == 0; }
+
+  VkDeviceSize Size(void) const { return size_; }
+  VkDeviceSize PeakUsage(void) const { return peakUsed_; }
+
+  static const VkDeviceSize kDefaultSize = 16 * 1024 * 1024;
+
+ private:
+  struct Batch {
+    uint64_t value_;
+    VkFence fence_;
+    VkDeviceSize end_;    // head_ when the batch was closed
+    VkDeviceSize bytes_;  // ring bytes used, alignment and wrap included
+  };
+
+  // Offset a region of size bytes would get, and the ring bytes it would
+  // consume; false if it does not fit
+  bool Place(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset,
+             VkDeviceSize* consumed) const;
+
+  VkDevice device_;
+  TutorialMemoryAllocator* allocator_;
+  VkBuffer buffer_;
+  TutorialAllocation memory_;
+  VkDeviceSize size_;
+
+  // In use: [tail_, head_), wrapping around the end of the buffer
+  VkDeviceSize head_;
+  VkDeviceSize tail_;
+  VkDeviceSize used_;
+  VkDeviceSize peakUsed_;
+  VkDeviceSize batchBytes_;  // used by the batch still open
+
+  uint64_t nextValue_;
+  uint64_t completedValue_;
+  std::deque<Batch> batches_;       // submitted, oldest first
+  std::vector<VkFence> freeFences_;  // unsignaled, ready for reuse
+};
+
+#endif  // TUTORIAL_STAGING_RING_HPP
@@ -0,0 +1,212 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialTextureAtlas.hpp"
+#include <algorithm>
+#include <cstring>
+
+void TutorialSkylinePacker::Init(uint32_t width, uint32_t height) {
+  width_ = width;
+  height_ = height;
+  skyline_.assign(1, Segment{0, 0, width});
+}
+
+bool TutorialSkylinePacker::Fit(size_t i, uint32_t width, uint32_t height,
+                                uint32_t* y) const {
+  if (skyline_[i].x_ + width > width_) return false;
+  *y = 0;
+  // the segments under the rectangle; together they reach the right edge,
+  // so this stops before running off the list
+  for (uint32_t covered = 0; covered < width; i++) {
+    *y = std::max(*y, skyline_[i].y_);
+    if (*y + height > height_) return false;
+    covered += skyline_[i].width_;
+  }
+  return true;
+}
+
+bool TutorialSkylinePacker::Insert(uint32_t width, uint32_t height,
+                                   uint32_t* x, uint32_t* y) {
+  size_t best = skyline_.size();
+  uint32_t bestTop = UINT32_MAX, bestWidth = UINT32_MAX, bestY = 0;
+  for (size_t i = 0; i < skyline_.size(); i++) {
+    uint32_t top;
+    if (!Fit(i, width, height, &top)) continue;
+    // lowest top edge first, then the narrowest segment to waste less
+    if (top + height < bestTop ||
+        (top + height == bestTop && skyline_[i].width_ < bestWidth)) {
+      best = i;
+      bestTop = top + height;
+      bestWidth = skyline_[i].width_;
+      bestY = top;
+    }
+  }
+  if (best == skyline_.size()) return false;
+  *x = skyline_[best].x_;
+  *y = bestY;
+
+  // the rectangle's top becomes a segment; what it covers shrinks or goes
+  skyline_.insert(skyline_.begin() + best, Segment{*x, bestTop, width});
+  const uint32_t right = *x + width;
+  for (size_t i = best + 1; i < skyline_.size();) {
+    Segment& segment = skyline_[i];
+    if (segment.x_ >= right) break;
+    uint32_t end = segment.x_ + segment.width_;
+    if (end <= right) {
+      skyline_.erase(skyline_.begin() + i);
+      continue;
+    }
+    segment.width_ = end - right;
+    segment.x_ = right;
+    break;
+  }
+  // neighbours at the same height merge
+  for (size_t i = 0; i + 1 < skyline_.size();) {
+    if (skyline_[i].y_ == skyline_[i + 1].y_) {
+      skyline_[i].width_ += skyline_[i + 1].width_;
+      skyline_.erase(skyline_.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+  return true;
+}
+
+void TutorialTextureAtlas::Add(const std::string& name,
+                               TutorialImage&& image) {
+  for (auto& entry : entries_) {
+    if (entry.name_ == name) {
+      entry.image_ = std::move(image);
+      return;
+    }
+  }
+  entries_.push_back(Entry{name, std::move(image)});
+}
+
+// Copy image into atlas at (x, y), with padding texels around it repeating
+// its edge texels
+static void Blit(const TutorialImage& image, uint32_t x, uint32_t y,
+                 uint32_t padding, TutorialImage* atlas) {
+  const uint32_t width = image.width_, height = image.height_;
+  for (int32_t row = -static_cast<int32_t>(padding);
+       row < static_cast<int32_t>(height + padding); row++) {
+    uint32_t srcRow = static_cast<uint32_t>(
+        std::min(std::max(row, 0), static_cast<int32_t>(height) - 1));
+    const uint8_t* src = &image.pixels_[static_cast<size_t>(srcRow) * width * 4];
+    uint8_t* dst = &atlas->pixels_[((y + row) * static_cast<size_t>(
+                                               atlas->width_) + x) * 4];
+    memcpy(dst, src, static_cast<size_t>(width) * 4);
+    for (uint32_t i = 1; i <= padding; i++) {
+      memcpy(dst - i * 4, src, 4);
+      memcpy(dst + (width - 1 + i) * 4, src + (width - 1) * 4, 4);
+    }
+  }
+}
+
+bool TutorialTextureAtlas::BuildAtlas(uint32_t maxSize, uint32_t padding,
+                                      TutorialImage* atlas) {
+  if (entries_.empty()) return false;
+  // tallest first packs tightest; names break ties so the layout only
+  // depends on what was added
+  std::vector<Entry*> order;
+  uint64_t area = 0;
+  uint32_t width = 1, height = 1;
+  for (auto& entry : entries_) {
+    order.push_back(&entry);
+    uint32_t entryWidth = entry.image_.width_ + 2 * padding;
+    uint32_t entryHeight = entry.image_.height_ + 2 * padding;
+    area += static_cast<uint64_t>(entryWidth) * entryHeight;
+    while (width < entryWidth) width *= 2;
+    while (height < entryHeight) height *= 2;
+  }
+  // one side at a time, so the atlas is square or twice as wide as high
+  auto grow = [&width, &height]() {
+    if (width > height) {
+      height *= 2;
+    } else {
+      width *= 2;
+    }
+  };
+  while (static_cast<uint64_t>(width) * height < area) grow();
+  std::sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) {
+    if (a->image_.height_ != b->image_.height_) {
+      return a->image_.height_ > b->image_.height_;
+    }
+    if (a->image_.width_ != b->image_.width_) {
+      return a->image_.width_ > b->image_.width_;
+    }
+    return a->name_ < b->name_;
+  });
+
+  // grow the atlas until everything fits
+  std::vector<uint32_t> positions(order.size() * 2);
+  TutorialSkylinePacker packer;
+  for (;; grow()) {
+    if (width > maxSize || height > maxSize) return false;
+    packer.Init(width, height);
+    size_t i = 0;
+    for (; i < order.size(); i++) {
+      if (!packer.Insert(order[i]->image_.width_ + 2 * padding,
+                         order[i]->image_.height_ + 2 * padding,
+                         &positions[i * 2], &positions[i * 2 + 1])) {
+        break;
+      }
+    }
+    if (i == order.size()) break;
+  }
+
+  atlas->width_ = width;
+  atlas->height_ = height;
+  atlas->mipLevels_ = 1;
+  atlas->pixels_.assign(static_cast<size_t>(width) * height * 4, 0);
+  regions_.clear();
+  for (size_t i = 0; i < order.size(); i++) {
+    const TutorialImage& image = order[i]->image_;
+    uint32_t x = positions[i * 2] + padding;
+    uint32_t y = positions[i * 2 + 1] + padding;
+    Blit(image, x, y, padding, atlas);
+    regions_[order[i]->name_] = TutorialAtlasRegion{
+        0,
+        {static_cast<float>(x) / width, static_cast<float>(y) / height},
+        {static_cast<float>(image.width_) / width,
+         static_cast<float>(image.height_) / height}};
+  }
+  entries_.clear();
+  return true;
+}
+
+bool TutorialTextureAtlas::BuildArray(std::vector<TutorialImage>* layers) {
+  if (entries_.empty()) return false;
+  for (auto& entry : entries_) {
+    if (entry.image_.width_ != entries_[0].image_.width_ ||
+        entry.image_.height_ != entries_[0].image_.height_) {
+      return false;
+    }
+  }
+  layers->clear();
+  regions_.clear();
+  for (auto& entry : entries_) {
+    regions_[entry.name_] = TutorialAtlasRegion{
+        static_cast<uint32_t>(layers->size()), {0.0f, 0.0f}, {1.0f, 1.0f}};
+    layers->push_back(std::move(entry.image_));
+  }
+  entries_.clear();
+  return true;
+}
+
+const TutorialAtlasRegion* TutorialTextureAtlas::Find(
+    const std::string& name) const {
+  auto it = regions_.find(name);
+  return it == regions_.end() ? nullptr : &it->second;
+}
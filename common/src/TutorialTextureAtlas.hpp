@@ -0,0 +1,93 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_TEXTURE_ATLAS_HPP
+#define TUTORIAL_TEXTURE_ATLAS_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TutorialImageDecode.hpp"
+
+// Where a texture ended up: the array layer, and the rectangle of it to
+// sample, as uv' = uvOffset_ + uv * uvScale_. Array layers use all of it.
+struct TutorialAtlasRegion {
+  uint32_t layer_;
+  float uvOffset_[2];
+  float uvScale_[2];
+};
+
+// Skyline bottom-left rectangle packer: the top edge of what was packed is
+// kept as a list of horizontal segments, and each rectangle goes where its
+// top ends lowest.
+class TutorialSkylinePacker {
+ public:
+  void Init(uint32_t width, uint32_t height);
+  // Place a width x height rectangle; false if it does not fit
+  bool Insert(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y);
+
+ private:
+  struct Segment {
+    uint32_t x_, y_, width_;
+  };
+  // Lowest y a rectangle can sit at with its left edge on segment i, or
+  // false if it runs past the right edge or the top
+  bool Fit(size_t i, uint32_t width, uint32_t height, uint32_t* y) const;
+
+  uint32_t width_;
+  uint32_t height_;
+  std::vector<Segment> skyline_;
+};
+
+// TutorialTextureAtlas:
+//   Put many textures behind one image view, so draws bind one descriptor
+//   set and look their texture up instead:
+//   - BuildAtlas() packs images of any size into one 2D image, each one
+//     surrounded by padding texels that repeat its edges, so that linear
+//     filtering never reads a neighbour. Mip level n stays clean with a
+//     padding of 2^n.
+//   - BuildArray() stacks images of the same size as the layers of a
+//     VK_IMAGE_VIEW_TYPE_2D_ARRAY (see TutorialTextureStreamer::
+//     UploadArray()), with no packing, padding or size limit besides
+//     maxImageArrayLayers.
+//   Either way Find() gives the region of a texture by name. Images are
+//   tightly packed RGBA8, level 0 only; a successful build consumes them.
+class TutorialTextureAtlas {
+ public:
+  // Queue an image under name; a name added twice keeps the last image
+  void Add(const std::string& name, TutorialImage&& image);
+
+  // Pack everything added into the smallest power of two atlas it fits in,
+  // square or twice as wide as high, with no side over maxSize. Returns
+  // false if it does not fit.
+  bool BuildAtlas(uint32_t maxSize, uint32_t padding, TutorialImage* atlas);
+  // Move everything added into layers, in the order added. Returns false
+  // unless all images have the same size.
+  bool BuildArray(std::vector<TutorialImage>* layers);
+
+  // Region of a texture of the last build, nullptr if unknown
+  const TutorialAtlasRegion* Find(const std::string& name) const;
+  size_t Count(void) const { return regions_.size(); }
+
+ private:
+  struct Entry {
+    std::string name_;
+    TutorialImage image_;
+  };
+  std::vector<Entry> entries_;
+  std::unordered_map<std::string, TutorialAtlasRegion> regions_;
+};
+
+#endif  // TUTORIAL_TEXTURE_ATLAS_HPP
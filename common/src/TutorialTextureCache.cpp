@@ -0,0 +1,198 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialTextureCache.hpp"
+#include <android/log.h>
+#include <cassert>
+
+static const char* kCacheTAG = "Vulkan-TextureCache";
+#define CACHE_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kCacheTAG, __VA_ARGS__))
+#define CACHE_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kCacheTAG, __VA_ARGS__))
+
+TutorialTextureCache::TutorialTextureCache()
+    : device_(VK_NULL_HANDLE),
+      streamer_(nullptr),
+      allocator_(nullptr),
+      budget_(0),
+      residentBytes_(0),
+      hits_(0),
+      misses_(0),
+      failures_(0),
+      evictions_(0) {}
+
+TutorialTextureCache::~TutorialTextureCache() {
+  assert(entries_.empty() && "Destroy() was not called");
+}
+
+void TutorialTextureCache::Init(VkDevice device,
+                                TutorialTextureStreamer* streamer,
+                                TutorialMemoryAllocator* allocator,
+                                VkDeviceSize budget) {
+  device_ = device;
+  streamer_ = streamer;
+  allocator_ = allocator;
+  budget_ = budget;
+  residentBytes_ = 0;
+  hits_ = misses_ = failures_ = evictions_ = 0;
+}
+
+void TutorialTextureCache::Destroy(void) {
+  for (auto& it : entries_) {
+    if (it.second.refs_) {
+      CACHE_LOGI("%s still referenced %u time(s)", it.first.c_str(),
+                 it.second.refs_);
+    }
+    if (it.second.resident_) DestroyTexture(&it.second.texture_);
+  }
+  entries_.clear();
+  lru_.clear();
+  residentBytes_ = 0;
+}
+
+std::string TutorialTextureCache::Key(const char* assetPath, bool mipmaps) {
+  return std::string(assetPath) + (mipmaps ? "|mipmaps" : "");
+}
+
+void TutorialTextureCache::Acquire(const char* assetPath, bool mipmaps,
+                                   ReadyCallback onReady) {
+  const std::string key = Key(assetPath, mipmaps);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    hits_++;
+    Entry& entry = it->second;
+    if (entry.resident_) {
+      if (!entry.refs_++) lru_.erase(entry.lru_);
+      onReady(entry.texture_);
+    } else {
+      entry.refs_++;
+      entry.joined_++;
+      entry.waiting_.push_back(onReady);
+    }
+    return;
+  }
+
+  misses_++;
+  Entry& entry = entries_[key];
+  entry.refs_ = 1;
+  entry.joined_ = 0;
+  entry.resident_ = false;
+  entry.waiting_.push_back(onReady);
+  streamer_->Request(assetPath,
+                     [this, key](const TutorialStreamedTexture& texture) {
+                       OnReady(key, texture);
+                     },
+                     mipmaps);
+}
+
+void TutorialTextureCache::Release(const char* assetPath, bool mipmaps) {
+  auto it = entries_.find(Key(assetPath, mipmaps));
+  assert(it != entries_.end() && it->second.refs_ > 0);
+  Entry& entry = it->second;
+  if (--entry.refs_) return;
+  if (!entry.resident_) {
+    // still loading: nobody is left to hand it to, OnReady() caches it
+    entry.waiting_.clear();
+    return;
+  }
+  entry.lru_ = lru_.insert(lru_.end(), it->first);
+  Evict();
+}
+
+void TutorialTextureCache::OnReady(const std::string& key,
+                                   const TutorialStreamedTexture& texture) {
+  Entry& entry = entries_[key];
+  assert(!entry.resident_);
+  if (texture.failed_) {
+    // forget it: the waiters keep whatever they had, a later Acquire()
+    // requests it again
+    CACHE_LOGE("%s failed to load, %zu waiting", key.c_str(),
+               entry.waiting_.size());
+    failures_++;
+    hits_ -= entry.joined_;
+    misses_ += entry.joined_;
+    std::vector<ReadyCallback> waiting;
+    waiting.swap(entry.waiting_);
+    entries_.erase(key);
+    for (auto& onReady : waiting) onReady(texture);
+    return;
+  }
+  entry.resident_ = true;
+  entry.texture_ = texture;
+  residentBytes_ += texture.mem_.size_;
+  if (!entry.refs_) entry.lru_ = lru_.insert(lru_.end(), key);
+
+  std::vector<ReadyCallback> waiting;
+  waiting.swap(entry.waiting_);
+  for (auto& onReady : waiting) onReady(entry.texture_);
+  Evict();
+}
+
+// Only unreferenced textures are in lru_, and Release() guarantees no
+// command buffer still uses those: they can go without waiting
+void TutorialTextureCache::Evict(void) {
+  while (residentBytes_ > budget_ && !lru_.empty()) {
+    auto it = entries_.find(lru_.front());
+    lru_.pop_front();
+    residentBytes_ -= it->second.texture_.mem_.size_;
+    DestroyTexture(&it->second.texture_);
+    entries_.erase(it);
+    evictions_++;
+  }
+}
+
+void TutorialTextureCache::SetBudget(VkDeviceSize budget) {
+  budget_ = budget;
+  Evict();
+}
+
+void TutorialTextureCache::DestroyTexture(TutorialStreamedTexture* texture) {
+  vkDestroyImageView(device_, texture->view_, nullptr);
+  vkDestroyImage(device_, texture->image_, nullptr);
+  allocator_->Free(&texture->mem_);
+}
+
+TutorialTextureCacheStats TutorialTextureCache::GetStats(void) const {
+  TutorialTextureCacheStats stats{
+      .hits_ = hits_,
+      .misses_ = misses_,
+      .failures_ = failures_,
+      .evictions_ = evictions_,
+      .residentCount_ = 0,
+      .referencedCount_ = 0,
+      .residentBytes_ = residentBytes_,
+      .budget_ = budget_,
+  };
+  for (auto& it : entries_) {
+    if (!it.second.resident_) continue;
+    stats.residentCount_++;
+    stats.referencedCount_ += (it.second.refs_ > 0);
+  }
+  return stats;
+}
+
+void TutorialTextureCache::LogStats(void) const {
+  TutorialTextureCacheStats stats = GetStats();
+  CACHE_LOGI("%llu hit(s), %llu miss(es), %llu failure(s), %llu eviction(s), "
+             "%u texture(s) resident (%u referenced), %llu KB of %llu KB "
+             "budget",
+             static_cast<unsigned long long>(stats.hits_),
+             static_cast<unsigned long long>(stats.misses_),
+             static_cast<unsigned long long>(stats.failures_),
+             static_cast<unsigned long long>(stats.evictions_),
+             stats.residentCount_, stats.referencedCount_,
+             static_cast<unsigned long long>(stats.residentBytes_ / 1024),
+             static_cast<unsigned long long>(stats.budget_ / 1024));
+}
@@ -0,0 +1,112 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_TEXTURE_CACHE_HPP
+#define TUTORIAL_TEXTURE_CACHE_HPP
+
+#include <vulkan_wrapper.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TutorialMemory.hpp"
+#include "TutorialTextureStreamer.hpp"
+
+struct TutorialTextureCacheStats {
+  uint64_t hits_;    // Acquire() of a texture resident or being loaded
+  uint64_t misses_;  // Acquire() that had to request it, or joined a failure
+  uint64_t failures_;  // requests the streamer could not load
+  uint64_t evictions_;
+  uint32_t residentCount_;
+  uint32_t referencedCount_;  // resident and still acquired
+  VkDeviceSize residentBytes_;
+  VkDeviceSize budget_;
+};
+
+// TutorialTextureCache:
+//   Share textures streamed by a TutorialTextureStreamer between their users
+//   instead of loading an asset once per user. Textures are keyed by asset
+//   path and load options and reference counted: Acquire() takes a
+//   reference, Release() drops it. A texture nobody references stays
+//   resident, so that acquiring it again is free, until the device memory
+//   of all resident textures exceeds the budget; then the least recently
+//   released ones are destroyed first. Referenced textures are never
+//   evicted, the budget is exceeded instead.
+//   Render thread only, like TutorialTextureStreamer::Update(). The cache
+//   never waits on the GPU: an unreferenced texture may be destroyed by
+//   any Release(), SetBudget() or texture delivery, with no fence checked.
+//   So Release() only once the GPU is done with the texture, i.e. once the
+//   fences of every submitted command buffer that samples it have
+//   signalled (or after vkDeviceWaitIdle()), and do not resubmit those
+//   command buffers after. The cache owns the textures and destroys those
+//   left in Destroy(), which must run after the streamer's Destroy().
+class TutorialTextureCache {
+ public:
+  typedef TutorialTextureStreamer::ReadyCallback ReadyCallback;
+  static const VkDeviceSize kDefaultBudget = 64 * 1024 * 1024;
+
+  TutorialTextureCache();
+  ~TutorialTextureCache();
+
+  void Init(VkDevice device, TutorialTextureStreamer* streamer,
+            TutorialMemoryAllocator* allocator,
+            VkDeviceSize budget = kDefaultBudget);
+  void Destroy(void);
+
+  // Take a reference to the texture of assetPath; onReady gets it once it is
+  // resident, before returning when it already is. When the load fails
+  // every waiting onReady gets a texture with failed_ set, the references
+  // are dropped (no Release() then) and the next Acquire() is a miss that
+  // tries again.
+  void Acquire(const char* assetPath, bool mipmaps, ReadyCallback onReady);
+  // Drop a reference taken by Acquire() with the same arguments. The GPU
+  // must be done with the texture: it may be destroyed before this returns.
+  void Release(const char* assetPath, bool mipmaps);
+
+  // Evict down to the new budget right away
+  void SetBudget(VkDeviceSize budget);
+  TutorialTextureCacheStats GetStats(void) const;
+  void LogStats(void) const;
+
+ private:
+  struct Entry {
+    uint32_t refs_;
+    uint32_t joined_;  // hits while loading, misses if the load fails
+    bool resident_;
+    TutorialStreamedTexture texture_;
+    std::vector<ReadyCallback> waiting_;  // Acquire() calls before resident
+    std::list<std::string>::iterator lru_;  // when resident and unreferenced
+  };
+  static std::string Key(const char* assetPath, bool mipmaps);
+  void OnReady(const std::string& key, const TutorialStreamedTexture& texture);
+  // Destroy unreferenced textures, least recently released first, until
+  // resident bytes are within budget
+  void Evict(void);
+  void DestroyTexture(TutorialStreamedTexture* texture);
+
+  VkDevice device_;
+  TutorialTextureStreamer* streamer_;
+  TutorialMemoryAllocator* allocator_;
+  VkDeviceSize budget_;
+  VkDeviceSize residentBytes_;
+  uint64_t hits_;
+  uint64_t misses_;
+  uint64_t failures_;
+  uint64_t evictions_;
+  std::unordered_map<std::string, Entry> entries_;
+  // keys of the resident textures nobody references, least recent first
+  std::list<std::string> lru_;
+};
+
+#endif  // TUTORIAL_TEXTURE_CACHE_HPP
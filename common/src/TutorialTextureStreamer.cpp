@@ -0,0 +1,573 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialTextureStreamer.hpp"
+#include <android/log.h>
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+static const char* kStreamerTAG = "Vulkan-TextureStreamer";
+#define STREAM_LOGI(...) \
+  ((void)__android_log_print(ANDROID_LOG_INFO, kStreamerTAG, __VA_ARGS__))
+#define STREAM_LOGE(...) \
+  ((void)__android_log_print(ANDROID_LOG_ERROR, kStreamerTAG, __VA_ARGS__))
+
+#define STREAM_CALL_VK(func)                                              \
+  if (VK_SUCCESS != (func)) {                                             \
+    __android_log_print(ANDROID_LOG_ERROR, kStreamerTAG,                  \
+                        "Vulkan error. File[%s], line[%d]", __FILE__,     \
+                        __LINE__);                                        \
+    assert(false);                                                        \
+  }
+
+static const VkFormat kStreamedFormat = VK_FORMAT_R8G8B8A8_UNORM;
+static const uint32_t kStreamedTexelSize = 4;
+// bufferOffset of a copy must be a multiple of the texel or block size (and
+// of 4)
+static const VkDeviceSize kStagingAlignment = 16;
+
+TutorialTextureStreamer::TutorialTextureStreamer()
+    : gpu_(VK_NULL_HANDLE),
+      device_(VK_NULL_HANDLE),
+      queue_(VK_NULL_HANDLE),
+      queueFamilyIndex_(0),
+      allocator_(nullptr),
+      assets_(nullptr),
+      pool_(nullptr),
+      gpuMipmaps_(false),
+      cmdPool_(VK_NULL_HANDLE),
+      stop_(false),
+      decoding_(0),
+      queued_(0) {}
+
+TutorialTextureStreamer::~TutorialTextureStreamer() {
+  assert(cmdPool_ == VK_NULL_HANDLE && "Destroy() was not called");
+}
+
+void TutorialTextureStreamer::Init(VkPhysicalDevice gpu, VkDevice device,
+                                   VkQueue queue, uint32_t queueFamilyIndex,
+                                   TutorialMemoryAllocator* allocator,
+                                   TutorialAssetSource* assets,
+                                   TutorialThreadPool* pool,
+                                   VkDeviceSize stagingSize) {
+  gpu_ = gpu;
+  device_ = device;
+  queue_ = queue;
+  queueFamilyIndex_ = queueFamilyIndex;
+  allocator_ = allocator;
+  assets_ = assets;
+  pool_ = pool;
+
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(gpu, kStreamedFormat, &props);
+  const VkFormatFeatureFlags blitFeatures =
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  gpuMipmaps_ = (props.optimalTilingFeatures & blitFeatures) == blitFeatures;
+  if (!gpuMipmaps_) {
+    STREAM_LOGI("no linear blits for the texture format, mipmaps on the CPU");
+  }
+
+  VkCommandPoolCreateInfo cmdPoolCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+               VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      .queueFamilyIndex = queueFamilyIndex_,
+  };
+  STREAM_CALL_VK(
+      vkCreateCommandPool(device_, &cmdPoolCreateInfo, nullptr, &cmdPool_));
+  ring_.Init(device_, allocator_, stagingSize);
+  stop_ = false;
+}
+
+void TutorialTextureStreamer::Destroy(void) {
+  {
+    // tasks still queued on the pool find nothing left to decode
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+    pending_.clear();
+    decodeDone_.wait(lock, [this] { return queued_ == 0; });
+  }
+  decoded_.clear();
+
+  SubmitBatch();
+  Reclaim(ring_.Update(true));
+  for (auto& upload : uploads_) DestroyTexture(&upload.texture_);
+  uploads_.clear();
+  ring_.Destroy();
+  if (cmdPool_ != VK_NULL_HANDLE) {
+    // frees the command buffers too
+    vkDestroyCommandPool(device_, cmdPool_, nullptr);
+    cmdPool_ = VK_NULL_HANDLE;
+  }
+  freeCmdBuffers_.clear();
+}
+
+const char* TutorialTextureStreamer::SelectVariant(
+    const std::vector<const char*>& assetPaths) {
+  for (auto path : assetPaths) {
+    // a view: only the header pages are touched
+    TutorialAssetView file;
+    if (!assets_->Open(path, &file)) continue;
+    uint32_t vkFormat;
+    if (!tutorialKtx2Format(file.Data(), file.Size(), &vkFormat)) {
+      return path;  // not KTX2: decoded to RGBA8, which every GPU samples
+    }
+    uint32_t blockWidth, blockHeight, blockBytes;
+    if (!tutorialFormatBlockInfo(vkFormat, &blockWidth, &blockHeight,
+                                 &blockBytes)) {
+      continue;
+    }
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(gpu_, static_cast<VkFormat>(vkFormat),
+                                        &props);
+    if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) {
+      return path;
+    }
+    STREAM_LOGI("%s: VkFormat %u cannot be sampled, skipped", path, vkFormat);
+  }
+  return nullptr;
+}
+
+void TutorialTextureStreamer::Request(const char* assetPath,
+                                      ReadyCallback onReady, bool mipmaps) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(
+        Job{assetPath, onReady, TutorialImage(), mipmaps, false, 0});
+    queued_++;
+  }
+  pool_->Submit([this]() { DecodeNext(); });
+}
+
+void TutorialTextureStreamer::Upload(const char* name, TutorialImage&& image,
+                                     ReadyCallback onReady, bool mipmaps) {
+  if (mipmaps && !gpuMipmaps_ && image.mipLevels_ == 1) {
+    tutorialGenerateMipmaps(&image);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoded_.push_back(
+      Job{name, onReady, std::move(image), mipmaps, false, 0});
+}
+
+void TutorialTextureStreamer::UploadArray(const char* name,
+                                          std::vector<TutorialImage>&& layers,
+                                          ReadyCallback onReady,
+                                          bool mipmaps) {
+  assert(!layers.empty());
+  TutorialImage image;
+  image.width_ = layers[0].width_;
+  image.height_ = layers[0].height_;
+  image.mipLevels_ = layers[0].mipLevels_;
+  for (auto& layer : layers) {
+    if (mipmaps && !gpuMipmaps_ && layer.mipLevels_ == 1) {
+      tutorialGenerateMipmaps(&layer);
+    }
+    assert(layer.width_ == image.width_ && layer.height_ == image.height_);
+    image.mipLevels_ = layer.mipLevels_;
+    image.pixels_.insert(image.pixels_.end(), layer.pixels_.begin(),
+                         layer.pixels_.end());
+  }
+  assert(image.pixels_.size() == layers[0].pixels_.size() * layers.size());
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoded_.push_back(Job{name, onReady, std::move(image), mipmaps, false,
+                         static_cast<uint32_t>(layers.size())});
+}
+
+bool TutorialTextureStreamer::Idle(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.empty() && decoded_.empty() && decoding_ == 0 &&
+         uploads_.empty();
+}
+
+void TutorialTextureStreamer::DecodeNext(void) {
+  Job job;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty()) {
+      // dropped by Destroy()
+      queued_--;
+      decodeDone_.notify_all();
+      return;
+    }
+    job = std::move(pending_.front());
+    pending_.pop_front();
+    decoding_++;
+  }
+
+  // The decoder reads the asset in place
+  TutorialAssetView file;
+  if (!assets_->Open(job.name_.c_str(), &file)) {
+    STREAM_LOGE("cannot open %s", job.name_.c_str());
+    job.failed_ = true;
+  } else if (tutorialIsKtx2(file.Data(), file.Size())) {
+    // kept open until the upload, which copies levels_ straight out of it
+    std::string error;
+    job.failed_ =
+        !tutorialParseKtx2(file.Data(), file.Size(), &job.ktx2_, &error);
+    if (job.failed_) {
+      STREAM_LOGE("%s: %s", job.name_.c_str(), error.c_str());
+    } else {
+      job.ktx2File_ = std::move(file);
+    }
+  } else {
+    job.failed_ = !tutorialDecodeImage(file.Data(), file.Size(), &job.image_);
+    if (job.failed_) STREAM_LOGE("cannot decode %s", job.name_.c_str());
+  }
+  if (!job.failed_ && !job.ktx2File_.Data() && job.mipmaps_ &&
+      !gpuMipmaps_) {
+    tutorialGenerateMipmaps(&job.image_);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoding_--;
+  queued_--;
+  if (!stop_) decoded_.push_back(std::move(job));
+  decodeDone_.notify_all();
+}
+
+VkCommandBuffer TutorialTextureStreamer::BeginCommandBuffer(void) {
+  VkCommandBuffer cmd;
+  if (!freeCmdBuffers_.empty()) {
+    cmd = freeCmdBuffers_.back();
+    freeCmdBuffers_.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo cmdBufferAllocateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = cmdPool_,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    STREAM_CALL_VK(
+        vkAllocateCommandBuffers(device_, &cmdBufferAllocateInfo, &cmd));
+  }
+  // the pool has RESET_COMMAND_BUFFER_BIT: beginning resets a reused buffer
+  VkCommandBufferBeginInfo beginInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = nullptr,
+  };
+  STREAM_CALL_VK(vkBeginCommandBuffer(cmd, &beginInfo));
+  return cmd;
+}
+
+void TutorialTextureStreamer::SubmitBatch(void) {
+  if (batch_.Empty()) return;
+  VkCommandBuffer cmd = BeginCommandBuffer();
+  const uint32_t images = batch_.ImagesRecorded();
+  const uint32_t barriers = batch_.BarriersRecorded();
+  batch_.Record(cmd);
+  STREAM_CALL_VK(vkEndCommandBuffer(cmd));
+
+  uint64_t value;
+  VkFence fence = ring_.EndBatch(&value);
+  VkSubmitInfo submitInfo{
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = nullptr,
+      .waitSemaphoreCount = 0,
+      .pWaitSemaphores = nullptr,
+      .pWaitDstStageMask = nullptr,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &cmd,
+      .signalSemaphoreCount = 0,
+      .pSignalSemaphores = nullptr,
+  };
+  STREAM_CALL_VK(vkQueueSubmit(queue_, 1, &submitInfo, fence));
+  inFlight_.push_back(InFlightCommands{value, cmd});
+  STREAM_LOGI("upload batch %llu: %u textures, %u barriers",
+              static_cast<unsigned long long>(value),
+              batch_.ImagesRecorded() - images,
+              batch_.BarriersRecorded() - barriers);
+
+  // uploads added since the last batch complete with this one
+  for (auto it = uploads_.rbegin(); it != uploads_.rend() && !it->value_;
+       ++it) {
+    it->value_ = value;
+  }
+}
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Every level of every layer starts kStagingAlignment aligned, as
+// RecordUpload() lays them out in the job's one allocation
+VkDeviceSize TutorialTextureStreamer::JobBytes(const Job& job) {
+  VkDeviceSize bytes = 0;
+  if (job.ktx2File_.Data()) {
+    for (auto& level : job.ktx2_.levels_) {
+      bytes += AlignUp(
+          tutorialLevelSize(level.width_, level.height_, job.ktx2_.blockWidth_,
+                            job.ktx2_.blockHeight_, job.ktx2_.blockBytes_),
+          kStagingAlignment);
+    }
+    return bytes;
+  }
+  for (uint32_t level = 0; level < job.image_.mipLevels_; level++) {
+    uint32_t width, height;
+    size_t levelOffset;
+    tutorialMipLevel(job.image_, level, &width, &height, &levelOffset);
+    bytes += AlignUp(tutorialLevelSize(width, height, 1, 1, kStreamedTexelSize),
+                     kStagingAlignment);
+  }
+  return bytes * std::max(job.arrayLayers_, 1u);
+}
+
+void TutorialTextureStreamer::Reclaim(uint64_t completedValue) {
+  while (!inFlight_.empty() && inFlight_.front().value_ <= completedValue) {
+    freeCmdBuffers_.push_back(inFlight_.front().cmdBuffer_);
+    inFlight_.pop_front();
+  }
+}
+
+// Stage the pixels and add the copies into a new image to the batch, which
+// also takes care of layout transitions and mip blits
+void TutorialTextureStreamer::RecordUpload(Job&& job) {
+  // Queued for delivery once all of it is added: an image split over
+  // batches is ready with the last one
+  PendingUpload upload;
+  upload.value_ = 0;
+  TutorialStreamedTexture& texture = upload.texture_;
+  texture.name_ = job.name_;
+  texture.failed_ = false;
+
+  // Where each level's texels are, in blocks of blockWidth x blockHeight
+  // texels (1 x 1 for RGBA8)
+  const bool ktx2 = job.ktx2File_.Data() != nullptr;
+  const uint8_t* pixels;
+  uint32_t levelCount, blockWidth, blockHeight, blockBytes;
+  if (ktx2) {
+    texture.format_ = static_cast<VkFormat>(job.ktx2_.vkFormat_);
+    texture.width_ = job.ktx2_.width_;
+    texture.height_ = job.ktx2_.height_;
+    pixels = job.ktx2File_.Data();
+    levelCount = static_cast<uint32_t>(job.ktx2_.levels_.size());
+    blockWidth = job.ktx2_.blockWidth_;
+    blockHeight = job.ktx2_.blockHeight_;
+    blockBytes = job.ktx2_.blockBytes_;
+  } else {
+    texture.format_ = kStreamedFormat;
+    texture.width_ = job.image_.width_;
+    texture.height_ = job.image_.height_;
+    pixels = job.image_.pixels_.data();
+    levelCount = job.image_.mipLevels_;
+    blockWidth = blockHeight = 1;
+    blockBytes = kStreamedTexelSize;
+  }
+  // either every level comes from the CPU, or level 0 does and the GPU
+  // blits the others
+  const bool blitMipmaps = !ktx2 && job.mipmaps_ && levelCount == 1 &&
+                           gpuMipmaps_ &&
+                           (texture.width_ > 1 || texture.height_ > 1);
+  texture.mipLevels_ =
+      blitMipmaps ? tutorialMipLevelCount(texture.width_, texture.height_)
+                  : levelCount;
+  texture.layers_ = std::max(job.arrayLayers_, 1u);
+  // UploadArray() textures get an array view even with a single layer
+  const bool arrayTexture = job.arrayLayers_ > 0;
+  const size_t layerBytes = job.image_.pixels_.size() / texture.layers_;
+
+  VkImageUsageFlags usage =
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  if (blitMipmaps) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  VkImageCreateInfo imageCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = texture.format_,
+      .extent = {texture.width_, texture.height_, 1},
+      .mipLevels = texture.mipLevels_,
+      .arrayLayers = texture.layers_,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 1,
+      .pQueueFamilyIndices = &queueFamilyIndex_,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  STREAM_CALL_VK(
+      vkCreateImage(device_, &imageCreateInfo, nullptr, &texture.image_));
+  STREAM_CALL_VK(allocator_->AllocateImage(
+      texture.image_, VK_IMAGE_TILING_OPTIMAL, kTutorialMemoryGpuOnly,
+      texture.name_.c_str(), &texture.mem_));
+
+  batch_.AddImage(texture.image_, texture.width_, texture.height_,
+                  texture.mipLevels_, texture.layers_);
+
+  // The whole image in one ring allocation when the ring can hold it, which
+  // Update() made sure it can right now; otherwise each level of each layer
+  // in bands of as many rows of blocks as fit, allocated one by one
+  const VkDeviceSize jobBytes = JobBytes(job);
+  const bool reserved = jobBytes <= ring_.Size();
+  TutorialStagingRegion reservation;
+  VkDeviceSize reservationUsed = 0;
+  if (reserved) {
+    bool allocated = ring_.Allocate(jobBytes, kStagingAlignment, &reservation);
+    assert(allocated);
+    (void)allocated;
+  }
+  std::vector<TutorialCopyBand> bands;
+  for (uint32_t i = 0; i < texture.layers_ * levelCount; i++) {
+    const uint32_t layer = i / levelCount, level = i % levelCount;
+    uint32_t width, height;
+    size_t levelOffset;
+    if (ktx2) {
+      const TutorialKtx2Level& info = job.ktx2_.levels_[level];
+      width = info.width_;
+      height = info.height_;
+      levelOffset = info.offset_;
+    } else {
+      tutorialMipLevel(job.image_, level, &width, &height, &levelOffset);
+      levelOffset += layer * layerBytes;
+    }
+    bool fits = tutorialSplitLevel(width, height, blockWidth, blockHeight,
+                                   blockBytes, ring_.Size(), &bands);
+    assert(fits);
+    if (bands.size() > 1) {
+      STREAM_LOGI("%s is larger than the staging ring, copied in %u bands",
+                  texture.name_.c_str(), static_cast<uint32_t>(bands.size()));
+    }
+    for (auto& band : bands) {
+      TutorialStagingRegion region;
+      if (reserved) {
+        region = reservation;
+        region.offset_ += reservationUsed;
+        region.size_ = band.size_;
+        region.mapped_ += reservationUsed;
+        reservationUsed += AlignUp(band.size_, kStagingAlignment);
+        assert(reservationUsed <= jobBytes);
+      } else {
+        while (!ring_.Allocate(band.size_, kStagingAlignment, &region)) {
+          // the ring is full of this very image: push it out and wait
+          SubmitBatch();
+          Reclaim(ring_.Update(true));
+        }
+      }
+      memcpy(region.mapped_, pixels + levelOffset + band.offset_, band.size_);
+      ring_.Flush(region);
+
+      // extents of block formats may stop short of a block at the edges
+      VkBufferImageCopy copy{
+          .bufferOffset = region.offset_,
+          .bufferRowLength = 0,  // tightly packed
+          .bufferImageHeight = 0,
+          .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1},
+          .imageOffset = {0, static_cast<int32_t>(band.y_), 0},
+          .imageExtent = {width, band.height_, 1},
+      };
+      batch_.AddCopy(region.buffer_, copy);
+    }
+  }
+  batch_.FinishImage(blitMipmaps);
+  // The pixels live in the staging ring from now on
+  job.image_.pixels_ = std::vector<uint8_t>();
+  job.ktx2File_.Close();
+  upload.job_ = std::move(job);
+
+  VkImageViewCreateInfo viewCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .image = texture.image_,
+      .viewType = arrayTexture ? VK_IMAGE_VIEW_TYPE_2D_ARRAY
+                               : VK_IMAGE_VIEW_TYPE_2D,
+      .format = texture.format_,
+      .components =
+          {
+              VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
+              VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A,
+          },
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels_, 0,
+                           texture.layers_},
+  };
+  STREAM_CALL_VK(
+      vkCreateImageView(device_, &viewCreateInfo, nullptr, &texture.view_));
+  uploads_.push_back(std::move(upload));
+}
+
+void TutorialTextureStreamer::DestroyTexture(
+    TutorialStreamedTexture* texture) {
+  vkDestroyImageView(device_, texture->view_, nullptr);
+  vkDestroyImage(device_, texture->image_, nullptr);
+  allocator_->Free(&texture->mem_);
+}
+
+uint32_t TutorialTextureStreamer::Update(bool wait) {
+  Reclaim(ring_.Update());
+
+  std::deque<Job> decoded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded.swap(decoded_);
+  }
+  uint32_t delivered = 0;
+  while (!decoded.empty()) {
+    Job& job = decoded.front();
+    if (job.failed_) {
+      // nothing to upload, but the requester still has to hear about it
+      TutorialStreamedTexture texture{
+          .name_ = job.name_,
+          .failed_ = true,
+          .image_ = VK_NULL_HANDLE,
+          .view_ = VK_NULL_HANDLE,
+          .mem_ = {},
+          .format_ = VK_FORMAT_UNDEFINED,
+          .width_ = 0,
+          .height_ = 0,
+          .mipLevels_ = 0,
+          .layers_ = 0,
+      };
+      job.onReady_(texture);
+      decoded.pop_front();
+      delivered++;
+      continue;
+    }
+    VkDeviceSize size = JobBytes(job);
+    if (!ring_.CanAllocate(size, kStagingAlignment) && !ring_.Idle()) {
+      if (!wait) break;
+      // make room: everything before this job has to land first
+      SubmitBatch();
+      Reclaim(ring_.Update(true));
+      continue;
+    }
+    RecordUpload(std::move(job));
+    decoded.pop_front();
+  }
+  if (!decoded.empty()) {
+    // no room in the ring this frame, try again on the next one
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_.insert(decoded_.begin(), std::make_move_iterator(decoded.begin()),
+                    std::make_move_iterator(decoded.end()));
+  }
+  SubmitBatch();
+
+  uint64_t completed = ring_.Update(wait);
+  Reclaim(completed);
+  while (!uploads_.empty() && uploads_.front().value_ <= completed) {
+    PendingUpload& upload = uploads_.front();
+    STREAM_LOGI("%s ready (%ux%u)", upload.texture_.name_.c_str(),
+                upload.texture_.width_, upload.texture_.height_);
+    upload.job_.onReady_(upload.texture_);
+    uploads_.pop_front();
+    delivered++;
+  }
+  return delivered;
+}
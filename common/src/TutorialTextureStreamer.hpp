@@ -0,0 +1,182 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_TEXTURE_STREAMER_HPP
+#define TUTORIAL_TEXTURE_STREAMER_HPP
+
+#include <vulkan_wrapper.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TutorialAsset.hpp"
+#include "TutorialImageDecode.hpp"
+#include "TutorialKtx2.hpp"
+#include "TutorialMemory.hpp"
+#include "TutorialStagingRing.hpp"
+#include "TutorialThreadPool.hpp"
+#include "TutorialUploadBatch.hpp"
+
+// A sampled texture produced by TutorialTextureStreamer, in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Ownership goes to the ready
+// callback, which must eventually destroy view_ and image_ and free mem_.
+// view_ is a VK_IMAGE_VIEW_TYPE_2D_ARRAY for UploadArray() textures, a 2D
+// view otherwise.
+// failed_ is set when the asset could not be read or decoded: only name_ is
+// valid then, there is nothing to own.
+struct TutorialStreamedTexture {
+  std::string name_;
+  bool failed_;
+  VkImage image_;
+  VkImageView view_;
+  TutorialAllocation mem_;
+  VkFormat format_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t mipLevels_;
+  uint32_t layers_;
+};
+
+// TutorialTextureStreamer:
+//   Load textures without stalling the render thread. Asset reads and image
+//   decoding run on a TutorialThreadPool, one task per requested texture,
+//   so that several textures decode in parallel; the render thread calls
+//   Update() once a frame to copy decoded images into device local images
+//   and to hand finished textures over to their ready callbacks.
+//   Pixels go through a TutorialStagingRing: all uploads of one Update()
+//   share one command buffer and one fence, and a texture is delivered once
+//   the ring's timeline passes its batch. A TutorialUploadBatch records
+//   them, with the layout transitions of all textures coalesced into a
+//   couple of barriers. Images larger than the ring are copied in bands of
+//   rows.
+//   On request the full mip chain is built: with vkCmdBlitImage when the
+//   format can be blitted and linearly filtered, by the decoding thread with
+//   a box filter otherwise. Textures are delivered as they complete, not in
+//   request order. Nothing ever waits on the GPU unless asked to with
+//   Update(true), or an image does not fit in the ring at all.
+//   KTX2 assets skip decoding altogether: their levels are copied as stored,
+//   in the file's own (usually block compressed) format. Such textures have
+//   the mip levels of the file, none are generated.
+//   Every request ends in its ready callback, failures included: assets
+//   that are missing or do not decode are delivered with failed_ set.
+class TutorialTextureStreamer {
+ public:
+  typedef std::function<void(const TutorialStreamedTexture&)> ReadyCallback;
+
+  TutorialTextureStreamer();
+  ~TutorialTextureStreamer();
+
+  void Init(VkPhysicalDevice gpu, VkDevice device, VkQueue queue,
+            uint32_t queueFamilyIndex, TutorialMemoryAllocator* allocator,
+            TutorialAssetSource* assets, TutorialThreadPool* pool,
+            VkDeviceSize stagingSize = TutorialStagingRing::kDefaultSize);
+  // Wait for the textures being decoded and the uploads in flight, and drop
+  // whatever was not delivered yet. The pool may go on running after.
+  void Destroy(void);
+
+  // First of assetPaths the device can sample: KTX2 files whose VkFormat
+  // has VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT with optimal tiling, or any
+  // other image file. Missing assets are skipped; nullptr if none is left.
+  // Maps the files and reads their KTX2 headers only, on the calling
+  // thread.
+  const char* SelectVariant(const std::vector<const char*>& assetPaths);
+
+  // Queue an asset (a KTX2 file or anything tutorialDecodeImage() reads) for
+  // decoding and upload; with mipmaps, a decoded image gets its full mip
+  // chain
+  void Request(const char* assetPath, ReadyCallback onReady,
+               bool mipmaps = false);
+  // Upload already decoded pixels (placeholders, generated textures)
+  void Upload(const char* name, TutorialImage&& image, ReadyCallback onReady,
+              bool mipmaps = false);
+  // Upload same sized images as the layers of one 2D array texture (see
+  // TutorialTextureAtlas::BuildArray())
+  void UploadArray(const char* name, std::vector<TutorialImage>&& layers,
+                   ReadyCallback onReady, bool mipmaps = false);
+
+  // Render thread only. Submit uploads for decoded images and deliver the
+  // finished ones; with wait, block until every upload submitted so far is
+  // done. Returns the number of textures delivered, failed ones included.
+  uint32_t Update(bool wait = false);
+
+  // True when nothing is being decoded or uploaded
+  bool Idle(void);
+
+ private:
+  struct Job {
+    std::string name_;
+    ReadyCallback onReady_;
+    TutorialImage image_;
+    bool mipmaps_;
+    bool failed_;
+    // 0 for a 2D texture; else image_ holds the layers back to back, each
+    // with all its mip levels
+    uint32_t arrayLayers_;
+    // KTX2 assets: the whole file, levels_ pointing into it
+    TutorialAssetView ktx2File_;
+    TutorialKtx2Image ktx2_;
+  };
+  struct PendingUpload {
+    Job job_;
+    TutorialStreamedTexture texture_;
+    uint64_t value_;  // staging ring batch, 0 while still being recorded
+  };
+  struct InFlightCommands {
+    uint64_t value_;
+    VkCommandBuffer cmdBuffer_;
+  };
+
+  // Pool task: decode the oldest pending job
+  void DecodeNext(void);
+  // Staging bytes of the job's pixels, alignment included: the size of the
+  // single ring allocation RecordUpload() makes when the ring can hold it
+  static VkDeviceSize JobBytes(const Job& job);
+  // Add the copy of job into a new image to the current batch
+  void RecordUpload(Job&& job);
+  VkCommandBuffer BeginCommandBuffer(void);
+  // Record and submit the current batch, if anything was added
+  void SubmitBatch(void);
+  // Recycle the command buffers of completed batches
+  void Reclaim(uint64_t completedValue);
+  void DestroyTexture(TutorialStreamedTexture* texture);
+
+  VkPhysicalDevice gpu_;
+  VkDevice device_;
+  VkQueue queue_;
+  uint32_t queueFamilyIndex_;
+  TutorialMemoryAllocator* allocator_;
+  TutorialAssetSource* assets_;
+  TutorialThreadPool* pool_;
+  bool gpuMipmaps_;  // kStreamedFormat supports blits with linear filter
+  VkCommandPool cmdPool_;
+  TutorialStagingRing ring_;
+
+  std::mutex mutex_;
+  std::condition_variable decodeDone_;
+  bool stop_;
+  std::deque<Job> pending_;  // waiting for a pool thread
+  std::deque<Job> decoded_;  // waiting for the render thread
+  uint32_t decoding_;
+  uint32_t queued_;  // DecodeNext() tasks submitted and not finished
+
+  // render thread only
+  TutorialUploadBatch batch_;
+  std::deque<InFlightCommands> inFlight_;
+  std::vector<VkCommandBuffer> freeCmdBuffers_;
+  std::deque<PendingUpload> uploads_;
+};
+
+#endif  // TUTORIAL_TEXTURE_STREAMER_HPP
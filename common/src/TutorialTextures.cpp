@@ -14,19 +14,20 @@
 
 #include "TutorialUtils.hpp"
 #include "TutorialTextures.hpp"
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_ONLY_PNG
-#include "stb_image.h"
 #include "TutoWindowManager.hpp"
+#include "TutorialAsset.hpp"
+#include "TutorialImageDecode.hpp"
+#include "TutorialPixels.hpp"
 #include "TutorialUtils.hpp"
 
 #include <stdexcept>
 
 extern VkDevice tutorialDevice;
-extern AAssetManager* tutorialAssetManager;
+extern TutorialAssetSource* tutorialAssets;
 extern VkPhysicalDeviceMemoryProperties tutorialMemoryProperties;
 extern VkCommandPool cmdPool;
 extern VkPhysicalDevice tutorialGpu;
+extern TutorialMemoryAllocator tutorialMemoryAllocator;
 
 // Open texture file from asset, load it into the created texture
 // The supported texture format is in kTexFmt
@@ -54,17 +55,17 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
     needBlit = false;
   }
 
-    // Read the file:
-  AAsset* file = AAssetManager_open(tutorialAssetManager, filePath,
-                                    AASSET_MODE_BUFFER);
-  size_t fileLength = AAsset_getLength(file);
-  stbi_uc* fileContent = new unsigned char[fileLength];
-  AAsset_read(file, fileContent, fileLength);
+  // Decode straight from the asset
+  TutorialAssetView file;
+  if (!tutorialAssets->Open(filePath, &file)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
 
-  uint32_t imgWidth, imgHeight, n;
-  unsigned char* imageData = stbi_load_from_memory(
-          fileContent, fileLength, reinterpret_cast<int*>(&imgWidth),
-          reinterpret_cast<int*>(&imgHeight), reinterpret_cast<int*>(&n), 0);
+  TutorialImage image;
+  if (!tutorialDecodeImage(file.Data(), file.Size(), &image)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const uint32_t imgWidth = image.width_, imgHeight = image.height_;
 
   tex_obj->tex_width = imgWidth;
   tex_obj->tex_height = imgHeight;
@@ -87,23 +88,12 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
           .queueFamilyIndexCount = 0,
           .flags = 0,
   };
-  VkMemoryAllocateInfo mem_alloc = {
-          .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-          .pNext = nullptr,
-          .allocationSize = 0,
-          .memoryTypeIndex = 0,
-  };
-
-  VkMemoryRequirements mem_reqs;
   CALL_VK(vkCreateImage(tutorialDevice, &image_create_info,
                       nullptr, &tex_obj->image));
-  vkGetImageMemoryRequirements(tutorialDevice, tex_obj->image, &mem_reqs);
-  mem_alloc.allocationSize = mem_reqs.size;
-  VK_CHECK(memory_type_from_properties(mem_reqs.memoryTypeBits,
-                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                              &mem_alloc.memoryTypeIndex));
-  CALL_VK(vkAllocateMemory(tutorialDevice, &mem_alloc, nullptr, &tex_obj->mem));
-  CALL_VK(vkBindImageMemory(tutorialDevice, tex_obj->image, tex_obj->mem, 0));
+  CALL_VK(tutorialMemoryAllocator.AllocateImage(
+      tex_obj->image, VK_IMAGE_TILING_LINEAR,
+      needBlit ? kTutorialMemoryStaging : kTutorialMemoryCpuToGpu, filePath,
+      &tex_obj->mem));
 
   if (required_props & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
     const VkImageSubresource subres = {
@@ -112,27 +102,17 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
             .arrayLayer = 0,
     };
     VkSubresourceLayout layout;
-    void* data;
+    // host visible memory stays mapped for its whole lifetime
+    void* data = tex_obj->mem.mapped_;
 
     vkGetImageSubresourceLayout(tutorialDevice, tex_obj->image, &subres,
                                 &layout);
-    CALL_VK(vkMapMemory(tutorialDevice, tex_obj->mem, 0, mem_alloc.allocationSize,
-                      0, &data));
-
-    for (int32_t y = 0; y < imgHeight; y++) {
-      unsigned char* row = (unsigned char*)((char*)data + layout.rowPitch * y);
-      for (int32_t x = 0; x < imgWidth; x++) {
-        row[x * 4] = imageData[(x + y * imgWidth) * 4];
-        row[x * 4 + 1] = imageData[(x + y * imgWidth) * 4 + 1];
-        row[x * 4 + 2] = imageData[(x + y * imgWidth) * 4 + 2];
-        row[x * 4 + 3] = imageData[(x + y * imgWidth) * 4 + 3];
-      }
-    }
-
-    vkUnmapMemory(tutorialDevice, tex_obj->mem);
-    delete[] imageData;
+
+    tutorialCopyImageToRGBA(data, layout.rowPitch, image.pixels_.data(),
+                            imgWidth, imgHeight, 4);
+
+    tutorialMemoryAllocator.Flush(tex_obj->mem);
   }
-  delete [] fileContent;
 
   tex_obj->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
  
@@ -143,9 +123,9 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
 
   // save current image and mem as staging image and memory
   VkImage stageImage = tex_obj->image;
-  VkDeviceMemory stageMem = tex_obj->mem;
+  TutorialAllocation stageMem = tex_obj->mem;
   tex_obj->image = VK_NULL_HANDLE;
-  tex_obj->mem   = VK_NULL_HANDLE;
+  tex_obj->mem   = {};
 
   // Create a tile texture to blit into
   image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -153,14 +133,9 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
                              VK_IMAGE_USAGE_SAMPLED_BIT;
   CALL_VK(vkCreateImage(tutorialDevice, &image_create_info,
                                     nullptr, &tex_obj->image));
-  vkGetImageMemoryRequirements(tutorialDevice, tex_obj->image, &mem_reqs);
-
-  mem_alloc.allocationSize = mem_reqs.size;
-  VK_CHECK(memory_type_from_properties(mem_reqs.memoryTypeBits,
-                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                     &mem_alloc.memoryTypeIndex));
-  CALL_VK(vkAllocateMemory(tutorialDevice, &mem_alloc, nullptr, &tex_obj->mem));
-  CALL_VK(vkBindImageMemory(tutorialDevice, tex_obj->image, tex_obj->mem, 0));
+  CALL_VK(tutorialMemoryAllocator.AllocateImage(
+      tex_obj->image, VK_IMAGE_TILING_OPTIMAL, kTutorialMemoryGpuOnly,
+      filePath, &tex_obj->mem));
 
   VkCommandBuffer gfxCmd;
   const VkCommandBufferAllocateInfo cmd = {
@@ -229,6 +204,6 @@ VkResult tutorialLoadTextureFromFile(const char* filePath,
 
   vkFreeCommandBuffers(tutorialDevice, cmdPool, 1, &gfxCmd);
   vkDestroyImage(tutorialDevice, stageImage, nullptr);
-  vkFreeMemory(tutorialDevice, stageMem, nullptr);
+  tutorialMemoryAllocator.Free(&stageMem);
   return VK_SUCCESS;
 }
@@ -17,12 +17,13 @@
 
 #include <android/asset_manager.h>
 #include <vulkan_wrapper.h>
+#include "TutorialMemory.hpp"
 
 typedef struct texture_object {
   VkSampler sampler;
   VkImage image;
   VkImageLayout imageLayout;
-  VkDeviceMemory mem;
+  TutorialAllocation mem;
   VkImageView view;
   int32_t tex_width, tex_height;
 } texture_object;
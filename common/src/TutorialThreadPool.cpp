@@ -0,0 +1,98 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TutorialThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+TutorialThreadPool::TutorialThreadPool() : stop_(false) {}
+
+TutorialThreadPool::~TutorialThreadPool() {
+  assert(threads_.empty() && "Destroy() was not called");
+}
+
+void TutorialThreadPool::Init(uint32_t threadCount) {
+  if (!threadCount) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  stop_ = false;
+  for (uint32_t i = 0; i < threadCount; i++) {
+    threads_.emplace_back(&TutorialThreadPool::WorkerLoop, this);
+  }
+}
+
+void TutorialThreadPool::Destroy(void) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeUp_.notify_all();
+  for (auto& thread : threads_) thread.join();
+  threads_.clear();
+}
+
+void TutorialThreadPool::Submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  wakeUp_.notify_one();
+}
+
+void TutorialThreadPool::WorkerLoop(void) {
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wakeUp_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      // the queue is drained before stopping
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void TutorialThreadPool::ParallelFor(
+    uint32_t count, const std::function<void(uint32_t)>& body) {
+  // Shared with the helper tasks, which may only get to run after this
+  // returns and then find nothing left to do
+  struct Loop {
+    std::atomic<uint32_t> next_;
+    uint32_t done_;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+  };
+  std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+  loop->next_ = 0;
+  loop->done_ = 0;
+  const std::function<void(uint32_t)>* bodyPtr = &body;
+  auto run = [loop, bodyPtr, count]() {
+    uint32_t done = 0;
+    for (uint32_t i; (i = loop->next_++) < count; done++) (*bodyPtr)(i);
+    if (!done) return;  // body may be gone already
+    std::lock_guard<std::mutex> lock(loop->mutex_);
+    loop->done_ += done;
+    if (loop->done_ == count) loop->finished_.notify_all();
+  };
+
+  const uint32_t helpers = std::min(ThreadCount(), count ? count - 1 : 0);
+  for (uint32_t i = 0; i < helpers; i++) Submit(run);
+  run();
+  std::unique_lock<std::mutex> lock(loop->mutex_);
+  loop->finished_.wait(lock, [&loop, count] { return loop->done_ == count; });
+}
@@ -0,0 +1,62 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TUTORIAL_THREAD_POOL_HPP
+#define TUTORIAL_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// TutorialThreadPool:
+//   One set of worker threads shared by everything that loads in the
+//   background (texture decoding, pipeline builds), instead of each owning
+//   threads of its own that then compete for the same cores. Tasks run in
+//   submission order, on whichever thread is free.
+//   ParallelFor() fans a loop out over the pool, the calling thread
+//   included, and returns once every iteration is done.
+class TutorialThreadPool {
+ public:
+  typedef std::function<void(void)> Task;
+
+  TutorialThreadPool();
+  ~TutorialThreadPool();
+
+  // threadCount 0: one thread per CPU core
+  void Init(uint32_t threadCount = 0);
+  // Finish the tasks submitted so far, then stop the threads
+  void Destroy(void);
+
+  void Submit(Task task);
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body);
+
+  uint32_t ThreadCount(void) const {
+    return static_cast<uint32_t>(threads_.size());
+  }
+
+ private:
+  void WorkerLoop(void);
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wakeUp_;
+  std::deque<Task> tasks_;
+  bool stop_;
+};
+
+#endif  // TUTORIAL_THREAD_POOL_HPP
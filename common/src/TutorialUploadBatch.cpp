@@ -0,0 +1,183 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "TutorialUploadBatch.hpp"
+#include <algorithm>
+#include <cassert>
+
+TutorialUploadBatch::TutorialUploadBatch()
+    : finished_(0), imagesRecorded_(0), barriersRecorded_(0) {}
+
+void TutorialUploadBatch::AddImage(VkImage image, uint32_t width,
+                                   uint32_t height, uint32_t mipLevels,
+                                   uint32_t layers) {
+  assert(images_.empty() || images_.back().finished_);
+  images_.push_back(Image{image, static_cast<int32_t>(width),
+                          static_cast<int32_t>(height), mipLevels, layers,
+                          false, false, false});
+}
+
+void TutorialUploadBatch::AddCopy(VkBuffer buffer,
+                                  const VkBufferImageCopy& copy) {
+  assert(!images_.empty() && !images_.back().finished_);
+  copies_.push_back(
+      Copy{static_cast<uint32_t>(images_.size() - 1), buffer, copy});
+}
+
+void TutorialUploadBatch::FinishImage(bool blitMipmaps) {
+  Image& image = images_.back();
+  assert(!image.finished_);
+  image.finished_ = true;
+  image.blitMipmaps_ = blitMipmaps && image.mipLevels_ > 1;
+  finished_++;
+}
+
+void TutorialUploadBatch::Barrier(VkCommandBuffer cmd,
+                                  VkPipelineStageFlags srcStage,
+                                  VkPipelineStageFlags dstStage) {
+  if (barriers_.empty()) return;
+  vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers_.size()),
+                       barriers_.data());
+  barriers_.clear();
+  barriersRecorded_++;
+}
+
+// A layout transition of levels [baseLevel, baseLevel + levelCount) of all
+// layers of image
+static VkImageMemoryBarrier LayoutBarrier(VkImage image, uint32_t baseLevel,
+                                          uint32_t levelCount,
+                                          uint32_t layers,
+                                          VkAccessFlags srcAccess,
+                                          VkAccessFlags dstAccess,
+                                          VkImageLayout oldLayout,
+                                          VkImageLayout newLayout) {
+  return VkImageMemoryBarrier{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = srcAccess,
+      .dstAccessMask = dstAccess,
+      .oldLayout = oldLayout,
+      .newLayout = newLayout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0,
+                           layers},
+  };
+}
+
+void TutorialUploadBatch::Record(VkCommandBuffer cmd,
+                                 VkPipelineStageFlags dstStage) {
+  // Nothing was written to the new images yet, their contents may go
+  for (auto& image : images_) {
+    if (image.started_) continue;
+    barriers_.push_back(LayoutBarrier(
+        image.image_, 0, image.mipLevels_, image.layers_, 0,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+    image.started_ = true;
+  }
+  Barrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+          VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  for (size_t i = 0; i < copies_.size();) {
+    const Copy& first = copies_[i];
+    regions_.clear();
+    for (; i < copies_.size() && copies_[i].image_ == first.image_ &&
+           copies_[i].buffer_ == first.buffer_;
+         i++) {
+      regions_.push_back(copies_[i].region_);
+    }
+    vkCmdCopyBufferToImage(cmd, first.buffer_, images_[first.image_].image_,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions_.size()),
+                           regions_.data());
+  }
+  copies_.clear();
+
+  // Blit cascade: level - 1 goes to TRANSFER_SRC and is blitted, linearly
+  // filtered, into level, for every image that has that level
+  uint32_t levels = 0;
+  for (auto& image : images_) {
+    if (image.finished_ && image.blitMipmaps_) {
+      levels = std::max(levels, image.mipLevels_);
+    }
+  }
+  for (uint32_t level = 1; level < levels; level++) {
+    for (auto& image : images_) {
+      if (!image.finished_ || !image.blitMipmaps_ ||
+          level >= image.mipLevels_) {
+        continue;
+      }
+      barriers_.push_back(LayoutBarrier(
+          image.image_, level - 1, 1, image.layers_,
+          VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+    }
+    Barrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (auto& image : images_) {
+      if (!image.finished_ || !image.blitMipmaps_ ||
+          level >= image.mipLevels_) {
+        continue;
+      }
+      const int32_t width = std::max(image.width_ >> (level - 1), 1);
+      const int32_t height = std::max(image.height_ >> (level - 1), 1);
+      VkImageBlit blit{
+          .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0,
+                             image.layers_},
+          .srcOffsets = {{0, 0, 0}, {width, height, 1}},
+          .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0,
+                             image.layers_},
+          .dstOffsets = {{0, 0, 0},
+                         {std::max(width / 2, 1), std::max(height / 2, 1), 1}},
+      };
+      vkCmdBlitImage(cmd, image.image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     image.image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                     &blit, VK_FILTER_LINEAR);
+    }
+  }
+
+  // Hand the finished images over: blitted ones have all but their last
+  // level in TRANSFER_SRC, the rest is TRANSFER_DST
+  for (auto& image : images_) {
+    if (!image.finished_) continue;
+    const uint32_t sources = image.blitMipmaps_ ? image.mipLevels_ - 1 : 0;
+    if (sources) {
+      barriers_.push_back(LayoutBarrier(
+          image.image_, 0, sources, image.layers_,
+          VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    }
+    barriers_.push_back(LayoutBarrier(
+        image.image_, sources, image.mipLevels_ - sources, image.layers_,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+  }
+  Barrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage);
+
+  // An image still being copied carries over to the next batch
+  imagesRecorded_ += finished_;
+  finished_ = 0;
+  images_.erase(std::remove_if(images_.begin(), images_.end(),
+                               [](const Image& image) {
+                                 return image.finished_;
+                               }),
+                images_.end());
+}
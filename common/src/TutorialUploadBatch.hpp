@@ -0,0 +1,95 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TUTORIAL_UPLOAD_BATCH_HPP
+#define TUTORIAL_UPLOAD_BATCH_HPP
+
+#include <vulkan_wrapper.h>
+#include <vector>
+
+// TutorialUploadBatch:
+//   Record the uploads of many images into one command buffer with as few
+//   barriers as the work allows. Images are added with their buffer to
+//   image copies and recorded together by Record():
+//   - one vkCmdPipelineBarrier takes every new image from UNDEFINED to
+//     TRANSFER_DST_OPTIMAL
+//   - all the copies, adjacent ones into the same image in one command
+//   - mip chains are blitted level by level across all images, one barrier
+//     per level for all of them
+//   - one vkCmdPipelineBarrier hands every finished image, all levels and
+//     layers, to the shaders in SHADER_READ_ONLY_OPTIMAL
+//   So n textures cost 2 barriers instead of 2n (plus one per mip level
+//   blitted, instead of one per level and texture). The caller submits the
+//   command buffer, with one fence for the whole batch.
+//   An image may be split over batches, when its pixels do not all fit in
+//   staging memory at once: it stays TRANSFER_DST_OPTIMAL until the batch
+//   that records its last copy.
+class TutorialUploadBatch {
+ public:
+  TutorialUploadBatch();
+
+  // Start an image of mipLevels levels and layers array layers, created
+  // in VK_IMAGE_LAYOUT_UNDEFINED
+  void AddImage(VkImage image, uint32_t width, uint32_t height,
+                uint32_t mipLevels, uint32_t layers);
+  // Copy from buffer into the image added last
+  void AddCopy(VkBuffer buffer, const VkBufferImageCopy& copy);
+  // The image added last has all its copies. With blitMipmaps, levels 1..
+  // are blitted from level 0 (which needs TRANSFER_SRC usage, and blit and
+  // linear filter support in the format).
+  void FinishImage(bool blitMipmaps);
+
+  // Record what was added since the last Record() into cmd. Finished
+  // images are made visible to dstStage.
+  void Record(VkCommandBuffer cmd,
+              VkPipelineStageFlags dstStage =
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  // Nothing to record
+  bool Empty(void) const { return copies_.empty() && !finished_; }
+
+  // What was recorded so far, for logs
+  uint32_t ImagesRecorded(void) const { return imagesRecorded_; }
+  uint32_t BarriersRecorded(void) const { return barriersRecorded_; }
+
+ private:
+  struct Image {
+    VkImage image_;
+    int32_t width_;
+    int32_t height_;
+    uint32_t mipLevels_;
+    uint32_t layers_;
+    bool started_;  // in TRANSFER_DST_OPTIMAL, copies recorded
+    bool finished_;
+    bool blitMipmaps_;
+  };
+  struct Copy {
+    uint32_t image_;  // index in images_
+    VkBuffer buffer_;
+    VkBufferImageCopy region_;
+  };
+
+  void Barrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStage,
+               VkPipelineStageFlags dstStage);
+
+  std::vector<Image> images_;
+  std::vector<Copy> copies_;
+  uint32_t finished_;  // images finished and not recorded yet
+  std::vector<VkImageMemoryBarrier> barriers_;
+  std::vector<VkBufferImageCopy> regions_;
+  uint32_t imagesRecorded_;
+  uint32_t barriersRecorded_;
+};
+
+#endif  // TUTORIAL_UPLOAD_BATCH_HPP
@@ -13,23 +13,18 @@
 // limitations under the License.
 
 #include "TutorialUtils.hpp"
+#include "TutorialMemoryType.hpp"
 
 
 extern VkPhysicalDeviceMemoryProperties tutorialMemoryProperties;
 
+// Kept for older callers, see tutorialFindMemoryType() for the selection
 VkResult memory_type_from_properties(uint32_t typeBits, VkFlags requirements_mask,
                                  uint32_t *typeIndex) {
-  // Search memtypes to find first index with those properties
-  for (uint32_t i = 0; i < 32; i++) {
-    if ((typeBits & 1) == 1) {
-      // Type is available, does it match user properties?
-      if ((tutorialMemoryProperties.memoryTypes[i].propertyFlags &
-           requirements_mask) == requirements_mask) {
-        *typeIndex = i;
-        return VK_SUCCESS;
-      }
-    }
-    typeBits >>= 1;
+  if (tutorialFindMemoryType(tutorialMemoryProperties, typeBits,
+                             TutorialMemoryUsage(requirements_mask),
+                             typeIndex)) {
+    return VK_SUCCESS;
   }
   // No memory types matched, return failure
   return VK_ERROR_MEMORY_MAP_FAILED;
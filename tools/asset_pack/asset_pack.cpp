@@ -0,0 +1,230 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// asset_pack:
+//   Pack a directory of assets into one TutorialAssetArchive file, or check
+//   an existing archive:
+//     asset_pack [-a ALIGN] -o ARCHIVE DIR   pack every file under DIR
+//     asset_pack -l ARCHIVE                  list the entries
+//     asset_pack --verify ARCHIVE            check checksums and lookups
+//   Entries are named by their path under DIR ('/' separated) and sorted,
+//   so the output only depends on the files. Hidden files and *.pak files
+//   (earlier archives) are skipped. ALIGN defaults to 64 bytes.
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "TutorialAsset.hpp"
+#include "TutorialAssetArchive.hpp"
+
+static const uint32_t kDefaultAlignment = 64;
+
+static void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out->push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void PutU64(std::vector<uint8_t>* out, uint64_t value) {
+  PutU32(out, static_cast<uint32_t>(value));
+  PutU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static bool EndsWith(const std::string& s, const char* suffix) {
+  size_t n = strlen(suffix);
+  return s.size() >= n && !s.compare(s.size() - n, n, suffix);
+}
+
+// Paths of the files under root/dir, relative to root
+static void CollectFiles(const std::string& root, const std::string& dir,
+                         std::vector<std::string>* files) {
+  const std::string path = dir.empty() ? root : root + "/" + dir;
+  DIR* handle = opendir(path.c_str());
+  if (!handle) return;
+  while (dirent* entry = readdir(handle)) {
+    const std::string name = entry->d_name;
+    if (name[0] == '.' || EndsWith(name, ".pak")) continue;
+    const std::string relative = dir.empty() ? name : dir + "/" + name;
+    struct stat info;
+    if (stat((root + "/" + relative).c_str(), &info) != 0) continue;
+    if (S_ISDIR(info.st_mode)) {
+      CollectFiles(root, relative, files);
+    } else if (S_ISREG(info.st_mode)) {
+      files->push_back(relative);
+    }
+  }
+  closedir(handle);
+}
+
+static int Pack(const char* dir, const char* output, uint32_t alignment) {
+  std::vector<std::string> names;
+  CollectFiles(dir, "", &names);
+  // the order TutorialAssetArchive searches in
+  std::sort(names.begin(), names.end());
+
+  TutorialDirectoryAssets source;
+  source.Init(dir);
+  std::vector<TutorialAssetView> files(names.size());
+  uint32_t namesSize = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    if (!source.Open(names[i].c_str(), &files[i])) {
+      fprintf(stderr, "%s/%s: cannot read\n", dir, names[i].c_str());
+      return EXIT_FAILURE;
+    }
+    namesSize += static_cast<uint32_t>(names[i].size());
+  }
+
+  std::vector<uint8_t> out(std::begin(kTutorialArchiveMagic),
+                           std::end(kTutorialArchiveMagic));
+  PutU32(&out, kTutorialArchiveVersion);
+  PutU32(&out, static_cast<uint32_t>(names.size()));
+  PutU32(&out, alignment);
+  PutU32(&out, namesSize);
+  uint64_t offset = kTutorialArchiveHeaderSize + names.size() * 32 + namesSize;
+  uint32_t nameOffset = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    PutU32(&out, nameOffset);
+    PutU32(&out, static_cast<uint32_t>(names[i].size()));
+    PutU64(&out, offset);
+    PutU64(&out, files[i].Size());
+    PutU64(&out, tutorialFnv1a64(files[i].Data(), files[i].Size()));
+    nameOffset += static_cast<uint32_t>(names[i].size());
+    offset += files[i].Size();
+  }
+  for (auto& name : names) out.insert(out.end(), name.begin(), name.end());
+  for (auto& file : files) {
+    out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+    out.insert(out.end(), file.Data(), file.Data() + file.Size());
+  }
+
+  FILE* fp = fopen(output, "wb");
+  bool ok = fp && fwrite(out.data(), 1, out.size(), fp) == out.size();
+  if (fp) ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    fprintf(stderr, "%s: cannot write\n", output);
+    return EXIT_FAILURE;
+  }
+  printf("%s: %zu entries, %zu bytes\n", output, names.size(), out.size());
+  return EXIT_SUCCESS;
+}
+
+static bool Load(const char* path, TutorialAssetArchive* archive) {
+  TutorialAssetView file;
+  std::string error;
+  if (!file.OpenFile(path)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return false;
+  }
+  if (!archive->Init(std::move(file), &error)) {
+    fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return false;
+  }
+  return true;
+}
+
+static int List(const char* path) {
+  TutorialAssetArchive archive;
+  if (!Load(path, &archive)) return EXIT_FAILURE;
+  printf("%zu entries, %u byte alignment\n", archive.Count(),
+         archive.Alignment());
+  for (size_t i = 0; i < archive.Count(); i++) {
+    const TutorialArchiveEntry& entry = archive.Entry(i);
+    printf("%10" PRIu64 " %10" PRIu64 "  %016" PRIx64 "  %s\n", entry.offset_,
+           entry.size_, entry.checksum_, archive.Name(i).c_str());
+  }
+  return EXIT_SUCCESS;
+}
+
+static int Verify(const char* path) {
+  TutorialAssetArchive archive;
+  if (!Load(path, &archive)) return EXIT_FAILURE;
+  std::vector<std::string> corrupted;
+  int failures = 0;
+  if (!archive.Verify(&corrupted)) {
+    for (auto& name : corrupted) {
+      fprintf(stderr, "%s: bad checksum\n", name.c_str());
+    }
+    failures += static_cast<int>(corrupted.size());
+  }
+  // every entry found by name, at its alignment, and nothing else
+  for (size_t i = 0; i < archive.Count(); i++) {
+    const std::string name = archive.Name(i);
+    TutorialAssetView view;
+    if (!archive.Open(name.c_str(), &view, archive.Alignment()) ||
+        view.Size() != archive.Entry(i).size_ || view.Copied()) {
+      fprintf(stderr, "%s: lookup failed\n", name.c_str());
+      failures++;
+    }
+    TutorialAssetView missing;
+    if (archive.Open((name + "~").c_str(), &missing) ||
+        archive.Open(name.substr(0, name.size() - 1).c_str(), &missing)) {
+      fprintf(stderr, "%s: lookup of a near miss succeeded\n", name.c_str());
+      failures++;
+    }
+  }
+  printf("%s: %zu entries, %d problem(s)\n", path, archive.Count(), failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int Usage(const char* self) {
+  fprintf(stderr,
+          "usage: %s [-a ALIGN] -o ARCHIVE DIR\n"
+          "       %s -l ARCHIVE\n"
+          "       %s --verify ARCHIVE\n",
+          self, self, self);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+  const char* output = nullptr;
+  const char* input = nullptr;
+  uint32_t alignment = kDefaultAlignment;
+  enum { kPack, kList, kVerify } mode = kPack;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "-o") && i + 1 < argc) {
+      output = argv[++i];
+    } else if (!strcmp(arg, "-a") && i + 1 < argc) {
+      alignment = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-l")) {
+      mode = kList;
+    } else if (!strcmp(arg, "--verify")) {
+      mode = kVerify;
+    } else if (arg[0] == '-' || input) {
+      return Usage(argv[0]);
+    } else {
+      input = arg;
+    }
+  }
+  if (!input) return Usage(argv[0]);
+  switch (mode) {
+    case kList:
+      return List(input);
+    case kVerify:
+      return Verify(input);
+    default:
+      if (!output) return Usage(argv[0]);
+      if (alignment < 16 || (alignment & (alignment - 1))) {
+        fprintf(stderr, "alignment must be a power of two, at least 16\n");
+        return EXIT_FAILURE;
+      }
+      return Pack(input, output, alignment);
+  }
+}
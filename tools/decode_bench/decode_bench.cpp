@@ -0,0 +1,280 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// decode_bench:
+//   Measure texture decoding at startup:
+//   - every image decoder (see TutorialImageDecoder) decodes each file and
+//     the synthetic images on one thread; MB/s of RGBA8 pixels out, and
+//     whether the pixels match stb_image's
+//   - how decoding (and mip mapping, as TutorialTextureStreamer does without
+//     GPU blits) scales over a TutorialThreadPool of 1, 2, 4 ... MAX threads
+//     decode_bench [-n COUNT] [-s SIZE] [-t MAX] [-r RUNS] [-d stb|png]
+//                  [--no-mips] [file.png...]
+//   The files come with COUNT synthetic SIZE x SIZE RGBA PNGs (default 16
+//   of 2048 x 2048, -n 0 for none), scaled up to 8 threads with the png
+//   decoder, best of 3 runs. For instance, with the tutorial's texture:
+//     decode_bench tutorial06_texture/app/src/main/assets/sample_tex.png
+
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TutorialAsset.hpp"
+#include "TutorialImageDecode.hpp"
+#include "TutorialPngDecoder.hpp"
+#include "TutorialThreadPool.hpp"
+
+static void PutU32BE(std::vector<uint8_t>* out, uint32_t value) {
+  for (int i = 3; i >= 0; i--) out->push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void PutChunk(std::vector<uint8_t>* out, const char* type,
+                     const std::vector<uint8_t>& data) {
+  PutU32BE(out, static_cast<uint32_t>(data.size()));
+  const size_t start = out->size();
+  out->insert(out->end(), type, type + 4);
+  out->insert(out->end(), data.begin(), data.end());
+  PutU32BE(out, static_cast<uint32_t>(
+                    crc32(0, out->data() + start, out->size() - start)));
+}
+
+// A photo-like RGBA image: smooth gradients and waves with some noise,
+// rows Sub filtered, deflated at zlib's default level
+static std::vector<uint8_t> SyntheticPng(uint32_t size, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::vector<uint8_t> rows;
+  rows.reserve((size * 4 + 1) * static_cast<size_t>(size));
+  for (uint32_t y = 0; y < size; y++) {
+    rows.push_back(1);  // Sub
+    uint8_t left[4] = {0, 0, 0, 0};
+    for (uint32_t x = 0; x < size; x++) {
+      const float u = static_cast<float>(x) / size;
+      const float v = static_cast<float>(y) / size;
+      const float wave = sinf((u * 7.0f + v * 3.0f + seed) * 3.14159f);
+      uint8_t pixel[4] = {
+          static_cast<uint8_t>(u * 200.0f + wave * 20.0f + 20.0f),
+          static_cast<uint8_t>(v * 180.0f + 30.0f),
+          static_cast<uint8_t>((1.0f - u) * 150.0f + wave * 40.0f + 50.0f),
+          0xFF,
+      };
+      for (int c = 0; c < 3; c++) pixel[c] += random() % 8;
+      for (int c = 0; c < 4; c++) {
+        rows.push_back(static_cast<uint8_t>(pixel[c] - left[c]));
+        left[c] = pixel[c];
+      }
+    }
+  }
+  std::vector<uint8_t> idat(compressBound(rows.size()));
+  uLongf idatSize = idat.size();
+  compress2(idat.data(), &idatSize, rows.data(), rows.size(),
+            Z_DEFAULT_COMPRESSION);
+  idat.resize(idatSize);
+
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n',
+                                        0x1A, '\n'};
+  std::vector<uint8_t> png(kSignature, kSignature + sizeof(kSignature));
+  std::vector<uint8_t> header;
+  PutU32BE(&header, size);
+  PutU32BE(&header, size);
+  const uint8_t rest[] = {8, 6, 0, 0, 0};  // 8 bit RGBA, no interlace
+  header.insert(header.end(), rest, rest + sizeof(rest));
+  PutChunk(&png, "IHDR", header);
+  PutChunk(&png, "IDAT", idat);
+  PutChunk(&png, "IEND", std::vector<uint8_t>());
+  return png;
+}
+
+typedef std::pair<const uint8_t*, size_t> Input;
+
+// Best time of runs decodes of inputs on this thread, in ms
+static double TimeDecode(const TutorialImageDecoder& decoder,
+                         const std::vector<Input>& inputs, uint32_t runs,
+                         std::vector<TutorialImage>* images) {
+  images->resize(inputs.size());
+  double best = INFINITY;
+  for (uint32_t run = 0; run < runs; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < inputs.size(); i++) {
+      if (!decoder.Decode(inputs[i].first, inputs[i].second, &(*images)[i])) {
+        return NAN;
+      }
+    }
+    best = std::min(best, std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+  }
+  return best;
+}
+
+static int Usage(const char* self) {
+  fprintf(stderr,
+          "usage: %s [-n COUNT] [-s SIZE] [-t MAX] [-r RUNS] [-d stb|png] "
+          "[--no-mips] [file.png...]\n",
+          self);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+  uint32_t count = 16, size = 2048, maxThreads = 8, runs = 3;
+  bool mipmaps = true;
+  const TutorialImageDecoder* decoder = &tutorialPngDecoder();
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "-n") && i + 1 < argc) {
+      count = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-s") && i + 1 < argc) {
+      size = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-t") && i + 1 < argc) {
+      maxThreads = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-r") && i + 1 < argc) {
+      runs = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-d") && i + 1 < argc) {
+      const char* name = argv[++i];
+      if (!strcmp(name, "stb")) {
+        decoder = &tutorialStbImageDecoder();
+      } else if (!strcmp(name, "png")) {
+        decoder = &tutorialPngDecoder();
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (!strcmp(arg, "--no-mips")) {
+      mipmaps = false;
+    } else if (arg[0] == '-') {
+      return Usage(argv[0]);
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if ((!count && files.empty()) || !size || !maxThreads || !runs) {
+    return Usage(argv[0]);
+  }
+
+  // The encoded images, as the asset views would hand them out
+  std::vector<TutorialAssetView> views(files.size());
+  std::vector<std::vector<uint8_t>> generated;
+  std::vector<Input> inputs;
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!views[i].OpenFile(files[i])) {
+      fprintf(stderr, "%s: cannot read\n", files[i]);
+      return EXIT_FAILURE;
+    }
+    inputs.emplace_back(views[i].Data(), views[i].Size());
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    generated.push_back(SyntheticPng(size, i));
+  }
+  for (auto& png : generated) inputs.emplace_back(png.data(), png.size());
+  size_t encodedBytes = 0;
+  for (auto& input : inputs) encodedBytes += input.second;
+
+  // Every decoder on its own, against stb_image's pixels; each file is a
+  // group, the synthetic images another
+  std::vector<std::pair<std::string, std::vector<Input>>> groups;
+  for (size_t i = 0; i < files.size(); i++) {
+    groups.emplace_back(files[i], std::vector<Input>(1, inputs[i]));
+  }
+  if (count) {
+    char name[64];
+    snprintf(name, sizeof(name), "%u synthetic %ux%u", count, size, size);
+    groups.emplace_back(name, std::vector<Input>(inputs.begin() + files.size(),
+                                                 inputs.end()));
+  }
+  const TutorialImageDecoder* decoders[] = {&tutorialStbImageDecoder(),
+                                            &tutorialPngDecoder()};
+  printf("one thread, best of %u:\n", runs);
+  bool mismatch = false;
+  for (auto& group : groups) {
+    std::vector<TutorialImage> reference, images;
+    double stbTime = 0.0;
+    for (const TutorialImageDecoder* candidate : decoders) {
+      double time = TimeDecode(*candidate, group.second, runs, &images);
+      if (std::isnan(time)) {
+        printf("  %-12s %s: declined\n", candidate->Name(),
+               group.first.c_str());
+        continue;
+      }
+      size_t bytes = 0;
+      bool same = true;
+      for (size_t i = 0; i < images.size(); i++) {
+        bytes += images[i].pixels_.size();
+        if (!reference.empty()) {
+          same = same && images[i].pixels_ == reference[i].pixels_;
+        }
+      }
+      if (candidate == decoders[0]) {
+        reference.swap(images);
+        stbTime = time;
+      }
+      mismatch = mismatch || !same;
+      printf("  %-12s %s: %8.1f ms, %7.1f MB/s, %.2fx%s\n", candidate->Name(),
+             group.first.c_str(), time, bytes / 1e3 / time, stbTime / time,
+             same ? "" : ", PIXELS DIFFER");
+    }
+  }
+
+  tutorialSetImageDecoder(*decoder);
+  std::vector<TutorialImage> images(inputs.size());
+  size_t decodedBytes = 0;
+  for (uint32_t i = 0; i < inputs.size(); i++) {
+    if (!tutorialDecodeImage(inputs[i].first, inputs[i].second, &images[i])) {
+      fprintf(stderr, "image %u: cannot decode\n", i);
+      return EXIT_FAILURE;
+    }
+    decodedBytes += images[i].pixels_.size();
+  }
+  printf("%zu images, %.1f MB encoded, %.1f MB decoded, %s, %s, %u core(s)\n",
+         inputs.size(), encodedBytes / 1e6, decodedBytes / 1e6,
+         decoder->Name(), mipmaps ? "with mipmaps" : "level 0 only",
+         std::thread::hardware_concurrency());
+
+  // 1, 2, 4 ... and maxThreads itself
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  double single = 0.0;
+  for (uint32_t threads : threadCounts) {
+    // ParallelFor() runs on the calling thread too
+    TutorialThreadPool pool;
+    if (threads > 1) pool.Init(threads - 1);
+    double best = INFINITY;
+    for (uint32_t run = 0; run < runs; run++) {
+      auto start = std::chrono::steady_clock::now();
+      pool.ParallelFor(static_cast<uint32_t>(inputs.size()),
+                       [&](uint32_t i) {
+                         tutorialDecodeImage(inputs[i].first, inputs[i].second,
+                                             &images[i]);
+                         if (mipmaps) tutorialGenerateMipmaps(&images[i]);
+                       });
+      best = std::min(best, std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+    }
+    pool.Destroy();
+    if (threads == 1) single = best;
+    printf("%2u thread(s): %8.1f ms, %7.1f MB/s decoded, %.2fx\n", threads,
+           best, decodedBytes / 1e3 / best, single / best);
+  }
+  return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// ktx2_info:
+//   ktx2_info [--staging KB] file.ktx2...
+//     Print what TutorialKtx2 makes of KTX2 files: format, block size, mip
+//     levels, and the vkCmdCopyBufferToImage bands TutorialTextureStreamer
+//     would record with a staging ring of the given size (16 MB default).
+//   ktx2_info --self-test
+//     Build KTX2 files in memory (ASTC, ETC2, BC7 and RGBA8, full and
+//     partial mip chains, sizes that are not multiples of the block) and
+//     check the parsed levels and their upload bands, then check that
+//     truncated and corrupt files are rejected. Exits non zero on failure.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "TutorialKtx2.hpp"
+
+static const size_t kDefaultStagingSize = 16 * 1024 * 1024;
+
+static void PrintFile(const char* path, size_t stagingSize) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    printf("%s: cannot open\n", path);
+    return;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  fclose(file);
+
+  TutorialKtx2Image image;
+  std::string error;
+  if (!tutorialParseKtx2(data.data(), data.size(), &image, &error)) {
+    printf("%s: %s\n", path, error.c_str());
+    return;
+  }
+  printf("%s: VkFormat %u, %ux%u, %ux%u blocks of %u bytes, %zu levels\n",
+         path, image.vkFormat_, image.width_, image.height_,
+         image.blockWidth_, image.blockHeight_, image.blockBytes_,
+         image.levels_.size());
+  std::vector<TutorialCopyBand> bands;
+  for (size_t i = 0; i < image.levels_.size(); i++) {
+    const TutorialKtx2Level& level = image.levels_[i];
+    printf("  level %zu: %ux%u, %zu bytes at %zu", i, level.width_,
+           level.height_, level.size_, level.offset_);
+    if (!tutorialSplitLevel(level.width_, level.height_, image.blockWidth_,
+                            image.blockHeight_, image.blockBytes_,
+                            stagingSize, &bands)) {
+      printf(", a row of blocks is larger than the staging ring\n");
+      continue;
+    }
+    printf(", %zu copies\n", bands.size());
+    if (bands.size() == 1) continue;
+    for (auto& band : bands) {
+      printf("    rows %u..%u: %zu bytes at +%zu\n", band.y_,
+             band.y_ + band.height_ - 1, band.size_, band.offset_);
+    }
+  }
+}
+
+// Self test
+
+static uint32_t failures = 0;
+#define CHECK(cond)                                                \
+  do {                                                             \
+    if (!(cond)) {                                                 \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                  \
+    }                                                              \
+  } while (0)
+
+static void PutU32(std::vector<uint8_t>* out, size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; i++) (*out)[offset + i] = (value >> (8 * i)) & 0xFF;
+}
+
+static void PutU64(std::vector<uint8_t>* out, size_t offset, uint64_t value) {
+  PutU32(out, offset, static_cast<uint32_t>(value));
+  PutU32(out, offset + 4, static_cast<uint32_t>(value >> 32));
+}
+
+// A KTX2 file with levelCount levels (0: base level only) of a recognizable
+// byte pattern, stored smallest first as the specification recommends.
+// No data format descriptor: TutorialKtx2 does not read it.
+static std::vector<uint8_t> MakeKtx2(uint32_t vkFormat, uint32_t width,
+                                     uint32_t height, uint32_t levelCount) {
+  uint32_t blockWidth, blockHeight, blockBytes;
+  bool known =
+      tutorialFormatBlockInfo(vkFormat, &blockWidth, &blockHeight, &blockBytes);
+  CHECK(known);
+  const uint32_t levels = levelCount ? levelCount : 1;
+  const size_t alignment = blockBytes < 4 ? 4 : blockBytes;
+
+  std::vector<uint8_t> out(kTutorialKtx2HeaderSize + levels * 24, 0);
+  static const uint8_t identifier[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                         '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+  memcpy(out.data(), identifier, sizeof(identifier));
+  PutU32(&out, 12, vkFormat);
+  PutU32(&out, 16, 1);  // typeSize
+  PutU32(&out, 20, width);
+  PutU32(&out, 24, height);
+  PutU32(&out, 28, 0);  // pixelDepth
+  PutU32(&out, 32, 0);  // layerCount
+  PutU32(&out, 36, 1);  // faceCount
+  PutU32(&out, 40, levelCount);
+  PutU32(&out, 44, 0);  // supercompressionScheme
+
+  for (uint32_t level = levels; level-- > 0;) {
+    uint32_t w = width >> level ? width >> level : 1;
+    uint32_t h = height >> level ? height >> level : 1;
+    size_t size = tutorialLevelSize(w, h, blockWidth, blockHeight, blockBytes);
+    out.resize((out.size() + alignment - 1) / alignment * alignment);
+    PutU64(&out, kTutorialKtx2HeaderSize + level * 24, out.size());
+    PutU64(&out, kTutorialKtx2HeaderSize + level * 24 + 8, size);
+    PutU64(&out, kTutorialKtx2HeaderSize + level * 24 + 16, size);
+    for (size_t i = 0; i < size; i++) {
+      out.push_back(static_cast<uint8_t>(level * 31 + i));
+    }
+  }
+  return out;
+}
+
+static uint32_t FullChain(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t s = width > height ? width : height; s > 1; s >>= 1) levels++;
+  return levels;
+}
+
+// Parse a generated file and check every level, and that the bands of each
+// level cover it exactly, in whole blocks, within the staging size
+static void CheckValid(const char* what, uint32_t vkFormat, uint32_t width,
+                       uint32_t height, uint32_t levelCount,
+                       size_t stagingSize) {
+  printf("%s\n", what);
+  std::vector<uint8_t> file = MakeKtx2(vkFormat, width, height, levelCount);
+  uint32_t parsedFormat = 0;
+  CHECK(tutorialKtx2Format(file.data(), kTutorialKtx2HeaderSize,
+                           &parsedFormat));
+  CHECK(parsedFormat == vkFormat);
+
+  TutorialKtx2Image image;
+  std::string error;
+  bool parsed = tutorialParseKtx2(file.data(), file.size(), &image, &error);
+  CHECK(parsed);
+  if (!parsed) {
+    printf("  %s\n", error.c_str());
+    return;
+  }
+  CHECK(image.vkFormat_ == vkFormat);
+  CHECK(image.width_ == width && image.height_ == height);
+  CHECK(image.levels_.size() == (levelCount ? levelCount : 1));
+
+  std::vector<TutorialCopyBand> bands;
+  for (uint32_t i = 0; i < image.levels_.size(); i++) {
+    const TutorialKtx2Level& level = image.levels_[i];
+    CHECK(level.width_ == (width >> i ? width >> i : 1));
+    CHECK(level.height_ == (height >> i ? height >> i : 1));
+    CHECK(level.offset_ % image.blockBytes_ == 0 && level.offset_ % 4 == 0);
+    CHECK(level.offset_ + level.size_ <= file.size());
+    CHECK(file[level.offset_] == static_cast<uint8_t>(i * 31));
+
+    bool fits = tutorialSplitLevel(level.width_, level.height_,
+                                   image.blockWidth_, image.blockHeight_,
+                                   image.blockBytes_, stagingSize, &bands);
+    CHECK(fits);
+    if (!fits) continue;
+    uint32_t y = 0;
+    size_t offset = 0;
+    for (auto& band : bands) {
+      CHECK(band.y_ == y && band.y_ % image.blockHeight_ == 0);
+      CHECK(band.offset_ == offset);
+      CHECK(band.size_ <= stagingSize);
+      CHECK(band.height_ > 0);
+      y += band.height_;
+      offset += band.size_;
+    }
+    CHECK(y == level.height_);
+    CHECK(offset == level.size_);
+  }
+}
+
+// A valid file, modified by corrupt, must be rejected
+template <typename Fn>
+static void CheckRejected(const char* what, Fn corrupt) {
+  printf("%s\n", what);
+  std::vector<uint8_t> file =
+      MakeKtx2(171 /* ASTC 8x8 UNORM */, 100, 60, FullChain(100, 60));
+  corrupt(&file);
+  TutorialKtx2Image image;
+  std::string error;
+  CHECK(!tutorialParseKtx2(file.data(), file.size(), &image, &error));
+  CHECK(!error.empty());
+  if (!error.empty()) printf("  rejected: %s\n", error.c_str());
+}
+
+static int SelfTest(void) {
+  CheckValid("ASTC 8x8, 100x60, full chain", 171, 100, 60, FullChain(100, 60),
+             kDefaultStagingSize);
+  CheckValid("ASTC 6x5, 100x60, banded through 1 KB", 161, 100, 60,
+             FullChain(100, 60), 1024);
+  CheckValid("ASTC 12x12 sRGB, 1x1", 184, 1, 1, 1, kDefaultStagingSize);
+  CheckValid("ETC2 RGB8, 256x128, 3 levels", 147, 256, 128, 3, 4096);
+  CheckValid("ETC2 RGBA8, 30x17, levelCount 0", 151, 30, 17, 0,
+             kDefaultStagingSize);
+  CheckValid("BC7, 64x64, full chain", 145, 64, 64, FullChain(64, 64), 512);
+  CheckValid("RGBA8, 33x7, full chain", 37, 33, 7, FullChain(33, 7), 200);
+
+  CheckRejected("truncated level data", [](std::vector<uint8_t>* file) {
+    file->resize(file->size() - 1);
+  });
+  CheckRejected("truncated level index", [](std::vector<uint8_t>* file) {
+    file->resize(kTutorialKtx2HeaderSize + 10);
+  });
+  CheckRejected("truncated header", [](std::vector<uint8_t>* file) {
+    file->resize(kTutorialKtx2HeaderSize - 1);
+  });
+  CheckRejected("bad identifier", [](std::vector<uint8_t>* file) {
+    (*file)[5] = '1';
+  });
+  CheckRejected("unknown VkFormat", [](std::vector<uint8_t>* file) {
+    PutU32(file, 12, 1000);
+  });
+  CheckRejected("supercompressed", [](std::vector<uint8_t>* file) {
+    PutU32(file, 44, 2);  // Zstandard
+  });
+  CheckRejected("cube map", [](std::vector<uint8_t>* file) {
+    PutU32(file, 36, 6);
+  });
+  CheckRejected("3D texture", [](std::vector<uint8_t>* file) {
+    PutU32(file, 28, 4);
+  });
+  CheckRejected("zero width", [](std::vector<uint8_t>* file) {
+    PutU32(file, 20, 0);
+  });
+  CheckRejected("more levels than a full chain", [](std::vector<uint8_t>* f) {
+    PutU32(f, 40, 9);
+  });
+  CheckRejected("wrong level size", [](std::vector<uint8_t>* file) {
+    PutU64(file, kTutorialKtx2HeaderSize + 8, 16);
+  });
+  CheckRejected("level offset past the end", [](std::vector<uint8_t>* file) {
+    PutU64(file, kTutorialKtx2HeaderSize, 0xFFFFFFFFFFFFFF00ull);
+  });
+  CheckRejected("misaligned level", [](std::vector<uint8_t>* file) {
+    PutU64(file, kTutorialKtx2HeaderSize, 84);
+  });
+
+  std::vector<TutorialCopyBand> bands;
+  printf("row of blocks larger than the staging ring\n");
+  CHECK(!tutorialSplitLevel(4096, 4, 4, 4, 16, 1024, &bands));
+
+  printf(failures ? "%u FAILED\n" : "all passed\n", failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 && !strcmp(argv[1], "--self-test")) return SelfTest();
+
+  size_t stagingSize = kDefaultStagingSize;
+  int first = 1;
+  if (argc > 2 && !strcmp(argv[1], "--staging")) {
+    stagingSize = static_cast<size_t>(atoi(argv[2])) * 1024;
+    first = 3;
+  }
+  if (first >= argc) {
+    printf("usage: %s [--staging KB] file.ktx2...\n"
+           "       %s --self-test\n",
+           argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (int i = first; i < argc; i++) PrintFile(argv[i], stagingSize);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// pixel_bench:
+//   Time the texture upload copy, the per byte nested loop the tutorials
+//   used to have against TutorialPixels, for square RGB and RGBA images
+//   from 256x256 to 8192x8192 (or up to the size given on the command line).
+//   Destinations are either tightly packed or padded to a 256 byte row
+//   pitch, like a linear image on many GPUs.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "TutorialPixels.hpp"
+
+// The original upload loop, generalized to n source channels
+static void NaiveCopy(uint8_t* dst, size_t dstRowPitch, const uint8_t* src,
+                      uint32_t width, uint32_t height, uint32_t n) {
+  for (uint32_t y = 0; y < height; y++) {
+    uint8_t* row = dst + dstRowPitch * y;
+    for (uint32_t x = 0; x < width; x++) {
+      row[x * 4] = src[(x + y * width) * n];
+      row[x * 4 + 1] = src[(x + y * width) * n + 1];
+      row[x * 4 + 2] = src[(x + y * width) * n + 2];
+      row[x * 4 + 3] = (n == 4) ? src[(x + y * width) * n + 3] : 0xFF;
+    }
+  }
+}
+
+// Run fn until at least 200 ms have passed; returns ms per run
+template <typename Fn>
+static double Time(Fn fn) {
+  using Clock = std::chrono::steady_clock;
+  uint32_t runs = 0;
+  auto start = Clock::now();
+  double elapsed = 0.0;
+  do {
+    fn();
+    runs++;
+    elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                  .count();
+  } while (elapsed < 200.0);
+  return elapsed / runs;
+}
+
+int main(int argc, char** argv) {
+  uint32_t maxSize = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 8192;
+
+  printf("backend: %s\n", tutorialPixelsBackend());
+  printf("%-10s %2s %6s %12s %12s %8s\n", "size", "ch", "pitch", "naive ms",
+         "pixels ms", "speedup");
+  for (uint32_t size = 256; size <= maxSize; size *= 2) {
+    for (uint32_t channels = 3; channels <= 4; channels++) {
+      std::vector<uint8_t> src(static_cast<size_t>(size) * size * channels);
+      for (size_t i = 0; i < src.size(); i++) src[i] = static_cast<uint8_t>(i * 7);
+
+      for (int padded = 0; padded < 2; padded++) {
+        size_t pitch = static_cast<size_t>(size) * 4 + (padded ? 256 : 0);
+        std::vector<uint8_t> expected(pitch * size), actual(pitch * size);
+
+        double naiveMs = Time([&] {
+          NaiveCopy(expected.data(), pitch, src.data(), size, size, channels);
+        });
+        double pixelsMs = Time([&] {
+          tutorialCopyImageToRGBA(actual.data(), pitch, src.data(), size, size,
+                                  channels);
+        });
+        for (uint32_t y = 0; y < size; y++) {
+          if (memcmp(&expected[pitch * y], &actual[pitch * y], size * 4)) {
+            fprintf(stderr, "mismatch: %u ch %u, row %u\n", size, channels, y);
+            return 1;
+          }
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "%ux%u", size, size);
+        printf("%-10s %2u %6zu %12.3f %12.3f %7.1fx\n", label, channels, pitch,
+               naiveMs, pixelsMs, naiveMs / pixelsMs);
+      }
+    }
+  }
+
+  // RGBA <-> BGRA, in place
+  for (uint32_t size = 256; size <= maxSize; size *= 4) {
+    std::vector<uint8_t> image(static_cast<size_t>(size) * size * 4);
+    for (size_t i = 0; i < image.size(); i++) image[i] = static_cast<uint8_t>(i);
+    std::vector<uint8_t> original(image);
+    tutorialSwizzleRGBA(image.data(), image.data(), image.size() / 4);
+    for (size_t i = 0; i < image.size(); i += 4) {
+      if (image[i] != original[i + 2] || image[i + 2] != original[i] ||
+          image[i + 1] != original[i + 1] || image[i + 3] != original[i + 3]) {
+        fprintf(stderr, "swizzle mismatch at pixel %zu\n", i / 4);
+        return 1;
+      }
+    }
+    double ms = Time([&] {
+      tutorialSwizzleRGBA(image.data(), image.data(), image.size() / 4);
+    });
+    printf("swizzle %ux%u: %.3f ms\n", size, size, ms);
+  }
+  return 0;
+}
@@ -0,0 +1,304 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "etc2_codec.hpp"
+#include <algorithm>
+
+// Block pixels are numbered column by column, i = x * 4 + y, the order of
+// the per pixel index bits in both ETC2 color and EAC blocks.
+
+// ETC1 modifier tables; pixel index 0: +small, 1: +large, 2: -small,
+// 3: -large
+static const int kColorModifiers[8][2] = {
+    {2, 8},   {5, 17},  {9, 29},  {13, 42},
+    {18, 60}, {24, 80}, {33, 106}, {47, 183},
+};
+
+static const int kAlphaModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8},
+};
+
+static int Clamp255(int value) { return std::min(std::max(value, 0), 255); }
+
+static int ColorModifier(int table, int index) {
+  int modifier = kColorModifiers[table][index & 1];
+  return (index & 2) ? -modifier : modifier;
+}
+
+// Subblock (0 or 1) of pixel i: left/right halves, or top/bottom if flipped
+static int Subblock(int flip, int i) {
+  return flip ? ((i & 3) >= 2) : (i >= 8);
+}
+
+static int Expand4(int c) { return (c << 4) | c; }
+static int Expand5(int c) { return (c << 3) | (c >> 2); }
+
+static void StoreBlock(uint64_t bits, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+}
+
+static uint64_t LoadBlock(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; i++) bits = (bits << 8) | in[i];
+  return bits;
+}
+
+// Best modifier table and pixel indices for one subblock around base;
+// returns the squared error
+static uint32_t FitSubblock(const uint8_t pixels[16][4], int flip, int sub,
+                            const int base[3], int* table,
+                            uint8_t indices[16]) {
+  uint32_t bestError = UINT32_MAX;
+  for (int t = 0; t < 8; t++) {
+    uint32_t error = 0;
+    uint8_t tableIndices[16];
+    for (int i = 0; i < 16; i++) {
+      if (Subblock(flip, i) != sub) continue;
+      uint32_t pixelError = UINT32_MAX;
+      for (int index = 0; index < 4; index++) {
+        int modifier = ColorModifier(t, index);
+        uint32_t e = 0;
+        for (int c = 0; c < 3; c++) {
+          int d = Clamp255(base[c] + modifier) - pixels[i][c];
+          e += d * d;
+        }
+        if (e < pixelError) {
+          pixelError = e;
+          tableIndices[i] = static_cast<uint8_t>(index);
+        }
+      }
+      error += pixelError;
+    }
+    if (error < bestError) {
+      bestError = error;
+      *table = t;
+      for (int i = 0; i < 16; i++) {
+        if (Subblock(flip, i) == sub) indices[i] = tableIndices[i];
+      }
+    }
+  }
+  return bestError;
+}
+
+static uint64_t EncodeColorBlock(const uint8_t pixels[16][4]) {
+  uint64_t bestBits = 0;
+  uint32_t bestError = UINT32_MAX;
+  for (int flip = 0; flip < 2; flip++) {
+    int average[2][3] = {};
+    for (int i = 0; i < 16; i++) {
+      for (int c = 0; c < 3; c++) average[Subblock(flip, i)][c] += pixels[i][c];
+    }
+    int q4[2][3], q5[2][3];
+    bool differential = true;
+    for (int s = 0; s < 2; s++) {
+      for (int c = 0; c < 3; c++) {
+        average[s][c] = (average[s][c] + 4) / 8;
+        q4[s][c] = (average[s][c] * 15 + 127) / 255;
+        q5[s][c] = (average[s][c] * 31 + 127) / 255;
+      }
+    }
+    for (int c = 0; c < 3; c++) {
+      int delta = q5[1][c] - q5[0][c];
+      differential &= (delta >= -4 && delta <= 3);
+    }
+
+    // individual mode always works; differential mode (finer base colors)
+    // when the two are close enough
+    for (int diff = 0; diff <= (differential ? 1 : 0); diff++) {
+      int base[2][3];
+      for (int s = 0; s < 2; s++) {
+        for (int c = 0; c < 3; c++) {
+          base[s][c] = diff ? Expand5(q5[s][c]) : Expand4(q4[s][c]);
+        }
+      }
+      int table[2];
+      uint8_t indices[16];
+      uint32_t error = FitSubblock(pixels, flip, 0, base[0], &table[0],
+                                   indices) +
+                       FitSubblock(pixels, flip, 1, base[1], &table[1],
+                                   indices);
+      if (error >= bestError) continue;
+      bestError = error;
+
+      uint64_t bits = 0;
+      if (diff) {
+        for (int c = 0; c < 3; c++) {
+          uint64_t delta = (q5[1][c] - q5[0][c]) & 7;
+          bits |= (static_cast<uint64_t>(q5[0][c]) << (59 - 8 * c)) |
+                  (delta << (56 - 8 * c));
+        }
+      } else {
+        for (int c = 0; c < 3; c++) {
+          bits |= (static_cast<uint64_t>(q4[0][c]) << (60 - 8 * c)) |
+                  (static_cast<uint64_t>(q4[1][c]) << (56 - 8 * c));
+        }
+      }
+      bits |= (static_cast<uint64_t>(table[0]) << 37) |
+              (static_cast<uint64_t>(table[1]) << 34) |
+              (static_cast<uint64_t>(diff) << 33) |
+              (static_cast<uint64_t>(flip) << 32);
+      for (int i = 0; i < 16; i++) {
+        bits |= (static_cast<uint64_t>(indices[i] >> 1) << (16 + i)) |
+                (static_cast<uint64_t>(indices[i] & 1) << i);
+      }
+      bestBits = bits;
+    }
+  }
+  return bestBits;
+}
+
+static void DecodeColorBlock(uint64_t bits, uint8_t pixels[16][4]) {
+  int base[2][3];
+  if ((bits >> 33) & 1) {
+    for (int c = 0; c < 3; c++) {
+      int c1 = (bits >> (59 - 8 * c)) & 31;
+      int delta = (bits >> (56 - 8 * c)) & 7;
+      if (delta >= 4) delta -= 8;
+      base[0][c] = Expand5(c1);
+      base[1][c] = Expand5(c1 + delta);
+    }
+  } else {
+    for (int c = 0; c < 3; c++) {
+      base[0][c] = Expand4((bits >> (60 - 8 * c)) & 15);
+      base[1][c] = Expand4((bits >> (56 - 8 * c)) & 15);
+    }
+  }
+  const int table[2] = {static_cast<int>((bits >> 37) & 7),
+                        static_cast<int>((bits >> 34) & 7)};
+  const int flip = (bits >> 32) & 1;
+  for (int i = 0; i < 16; i++) {
+    int s = Subblock(flip, i);
+    int index = static_cast<int>((((bits >> (16 + i)) & 1) << 1) |
+                                 ((bits >> i) & 1));
+    for (int c = 0; c < 3; c++) {
+      pixels[i][c] =
+          static_cast<uint8_t>(Clamp255(base[s][c] + ColorModifier(table[s], index)));
+    }
+  }
+}
+
+static uint64_t EncodeAlphaBlock(const uint8_t pixels[16][4]) {
+  int minAlpha = 255, maxAlpha = 0;
+  for (int i = 0; i < 16; i++) {
+    minAlpha = std::min<int>(minAlpha, pixels[i][3]);
+    maxAlpha = std::max<int>(maxAlpha, pixels[i][3]);
+  }
+  if (minAlpha == maxAlpha) {
+    // table 13 has a 0 modifier (index 4); multiplier 0 is not allowed
+    uint64_t bits = (static_cast<uint64_t>(minAlpha) << 56) |
+                    (static_cast<uint64_t>(1) << 52) |
+                    (static_cast<uint64_t>(13) << 48);
+    for (int i = 0; i < 16; i++) bits |= static_cast<uint64_t>(4) << (45 - 3 * i);
+    return bits;
+  }
+
+  uint64_t bestBits = 0;
+  uint32_t bestError = UINT32_MAX;
+  for (int t = 0; t < 16; t++) {
+    const int low = kAlphaModifiers[t][3], high = kAlphaModifiers[t][7];
+    // multipliers around the one that spans the block's alpha range
+    int center = (maxAlpha - minAlpha + (high - low) / 2) / (high - low);
+    for (int m = std::max(center - 1, 1); m <= std::min(center + 1, 15);
+         m++) {
+      int base = Clamp255((minAlpha + maxAlpha - (low + high) * m + 1) / 2);
+      uint32_t error = 0;
+      uint64_t indexBits = 0;
+      for (int i = 0; i < 16; i++) {
+        uint32_t pixelError = UINT32_MAX;
+        int bestIndex = 0;
+        for (int index = 0; index < 8; index++) {
+          int d = Clamp255(base + kAlphaModifiers[t][index] * m) - pixels[i][3];
+          if (static_cast<uint32_t>(d * d) < pixelError) {
+            pixelError = d * d;
+            bestIndex = index;
+          }
+        }
+        error += pixelError;
+        indexBits |= static_cast<uint64_t>(bestIndex) << (45 - 3 * i);
+      }
+      if (error < bestError) {
+        bestError = error;
+        bestBits = (static_cast<uint64_t>(base) << 56) |
+                   (static_cast<uint64_t>(m) << 52) |
+                   (static_cast<uint64_t>(t) << 48) | indexBits;
+      }
+    }
+  }
+  return bestBits;
+}
+
+static void DecodeAlphaBlock(uint64_t bits, uint8_t pixels[16][4]) {
+  const int base = static_cast<int>(bits >> 56);
+  const int multiplier = (bits >> 52) & 15;
+  const int table = (bits >> 48) & 15;
+  for (int i = 0; i < 16; i++) {
+    int index = (bits >> (45 - 3 * i)) & 7;
+    pixels[i][3] = static_cast<uint8_t>(
+        Clamp255(base + kAlphaModifiers[table][index] * multiplier));
+  }
+}
+
+void EncodeEtc2(const uint8_t* rgba, uint32_t width, uint32_t height,
+                bool alpha, uint8_t* blocks) {
+  const size_t blockSize = alpha ? 16 : 8;
+  for (uint32_t by = 0; by < height; by += 4) {
+    for (uint32_t bx = 0; bx < width; bx += 4) {
+      uint8_t pixels[16][4];
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = std::min(bx + i / 4, width - 1);
+        uint32_t y = std::min(by + i % 4, height - 1);
+        const uint8_t* p = rgba + (static_cast<size_t>(y) * width + x) * 4;
+        for (int c = 0; c < 4; c++) pixels[i][c] = p[c];
+      }
+      if (alpha) {
+        StoreBlock(EncodeAlphaBlock(pixels), blocks);
+        StoreBlock(EncodeColorBlock(pixels), blocks + 8);
+      } else {
+        StoreBlock(EncodeColorBlock(pixels), blocks);
+      }
+      blocks += blockSize;
+    }
+  }
+}
+
+void DecodeEtc2(const uint8_t* blocks, uint32_t width, uint32_t height,
+                bool alpha, uint8_t* rgba) {
+  const size_t blockSize = alpha ? 16 : 8;
+  for (uint32_t by = 0; by < height; by += 4) {
+    for (uint32_t bx = 0; bx < width; bx += 4) {
+      uint8_t pixels[16][4];
+      if (alpha) {
+        DecodeAlphaBlock(LoadBlock(blocks), pixels);
+        DecodeColorBlock(LoadBlock(blocks + 8), pixels);
+      } else {
+        for (int i = 0; i < 16; i++) pixels[i][3] = 0xFF;
+        DecodeColorBlock(LoadBlock(blocks), pixels);
+      }
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = bx + i / 4, y = by + i % 4;
+        if (x >= width || y >= height) continue;
+        uint8_t* p = rgba + (static_cast<size_t>(y) * width + x) * 4;
+        for (int c = 0; c < 4; c++) p[c] = pixels[i][c];
+      }
+      blocks += blockSize;
+    }
+  }
+}
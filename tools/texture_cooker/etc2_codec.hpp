@@ -0,0 +1,42 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ETC2_CODEC_HPP
+#define ETC2_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// ETC2 encoding for texture_cooker, the block format every Vulkan capable
+// Android GPU samples (textureCompressionETC2).
+// Colors use the ETC1 compatible individual and differential modes only,
+// searched exhaustively over both block flips and all modifier tables;
+// alpha is EAC, searched over every table and multiplier. Output only
+// depends on the input pixels.
+// The decoders read what the encoders write (no T, H or planar mode
+// blocks) and are there to measure the error.
+
+// Encode a tightly packed RGBA8 level. blocks receives
+// ceil(width / 4) * ceil(height / 4) blocks, row by row, of 8 bytes
+// (VK_FORMAT_ETC2_R8G8B8_*, alpha ignored) or, with alpha, 16 bytes
+// (VK_FORMAT_ETC2_R8G8B8A8_*: EAC alpha then color). Edge blocks repeat
+// the last row and column.
+void EncodeEtc2(const uint8_t* rgba, uint32_t width, uint32_t height,
+                bool alpha, uint8_t* blocks);
+
+// Decode the output of EncodeEtc2() back into RGBA8 (alpha 0xFF without)
+void DecodeEtc2(const uint8_t* blocks, uint32_t width, uint32_t height,
+                bool alpha, uint8_t* rgba);
+
+#endif  // ETC2_CODEC_HPP
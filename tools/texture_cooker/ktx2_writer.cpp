@@ -0,0 +1,187 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ktx2_writer.hpp"
+#include <algorithm>
+#include "TutorialKtx2.hpp"
+
+// Khronos Data Format basic descriptor values
+static const uint8_t kModelRGBSDA = 1;
+static const uint8_t kModelETC2 = 161;
+static const uint8_t kPrimariesBT709 = 1;
+static const uint8_t kTransferLinear = 1;
+static const uint8_t kTransferSRGB = 2;
+static const uint8_t kChannelRed = 0;
+static const uint8_t kChannelGreen = 1;
+static const uint8_t kChannelBlue = 2;
+static const uint8_t kChannelAlpha = 15;
+static const uint8_t kChannelEtc2Color = 2;
+static const uint8_t kQualifierLinear = 0x10;  // linear alpha in sRGB data
+
+struct Sample {
+  uint16_t bitOffset;
+  uint8_t bitLength;  // bits - 1
+  uint8_t channel;
+  uint32_t upper;
+};
+
+static void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out->push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void SetU32(std::vector<uint8_t>* out, size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; i++) (*out)[offset + i] = (value >> (8 * i)) & 0xFF;
+}
+
+static void SetU64(std::vector<uint8_t>* out, size_t offset, uint64_t value) {
+  SetU32(out, offset, static_cast<uint32_t>(value));
+  SetU32(out, offset + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static void Align(std::vector<uint8_t>* out, size_t alignment) {
+  out->resize((out->size() + alignment - 1) / alignment * alignment, 0);
+}
+
+// The data format descriptor: total size, then one basic descriptor block
+static bool AppendDfd(uint32_t vkFormat, std::vector<uint8_t>* out) {
+  uint8_t model, transfer = kTransferLinear;
+  std::vector<Sample> samples;
+  switch (vkFormat) {
+    case 43:  // VK_FORMAT_R8G8B8A8_SRGB
+      transfer = kTransferSRGB;
+      // fall through
+    case 37:  // VK_FORMAT_R8G8B8A8_UNORM
+      model = kModelRGBSDA;
+      samples = {{0, 7, kChannelRed, 255},
+                 {8, 7, kChannelGreen, 255},
+                 {16, 7, kChannelBlue, 255},
+                 {24, 7, kChannelAlpha, 255}};
+      break;
+    case 50:  // VK_FORMAT_B8G8R8A8_SRGB
+      transfer = kTransferSRGB;
+      // fall through
+    case 44:  // VK_FORMAT_B8G8R8A8_UNORM
+      model = kModelRGBSDA;
+      samples = {{0, 7, kChannelBlue, 255},
+                 {8, 7, kChannelGreen, 255},
+                 {16, 7, kChannelRed, 255},
+                 {24, 7, kChannelAlpha, 255}};
+      break;
+    case 148:  // VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK
+      transfer = kTransferSRGB;
+      // fall through
+    case 147:  // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+      model = kModelETC2;
+      samples = {{0, 63, kChannelEtc2Color, 0xFFFFFFFF}};
+      break;
+    case 152:  // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+      transfer = kTransferSRGB;
+      // fall through
+    case 151:  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+      model = kModelETC2;
+      samples = {{0, 63, kChannelAlpha, 0xFFFFFFFF},
+                 {64, 63, kChannelEtc2Color, 0xFFFFFFFF}};
+      break;
+    default:
+      return false;
+  }
+  uint32_t blockWidth, blockHeight, blockBytes;
+  tutorialFormatBlockInfo(vkFormat, &blockWidth, &blockHeight, &blockBytes);
+
+  const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+  PutU32(out, 4 + blockSize);  // dfdTotalSize
+  PutU32(out, 0);              // vendorId 0 (Khronos), descriptorType 0
+  PutU32(out, 2 | (blockSize << 16));  // versionNumber, descriptorBlockSize
+  const uint8_t format[] = {
+      model, kPrimariesBT709, transfer, 0 /* straight alpha */,
+      static_cast<uint8_t>(blockWidth - 1), static_cast<uint8_t>(blockHeight - 1),
+      0, 0, static_cast<uint8_t>(blockBytes), 0, 0, 0, 0, 0, 0, 0,
+  };
+  out->insert(out->end(), format, format + sizeof(format));
+  for (auto& sample : samples) {
+    uint8_t channelType = sample.channel;
+    if (transfer == kTransferSRGB && sample.channel == kChannelAlpha) {
+      channelType |= kQualifierLinear;
+    }
+    PutU32(out, sample.bitOffset | (sample.bitLength << 16) |
+                    (static_cast<uint32_t>(channelType) << 24));
+    PutU32(out, 0);  // samplePosition
+    PutU32(out, 0);  // sampleLower
+    PutU32(out, sample.upper);
+  }
+  return true;
+}
+
+bool WriteKtx2(uint32_t vkFormat, uint32_t width, uint32_t height,
+               const std::vector<std::vector<uint8_t>>& levels,
+               std::vector<uint8_t>* file) {
+  static const uint8_t identifier[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                         '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+  uint32_t blockWidth, blockHeight, blockBytes;
+  if (levels.empty() || !tutorialFormatBlockInfo(vkFormat, &blockWidth,
+                                                 &blockHeight, &blockBytes)) {
+    return false;
+  }
+  const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+  std::vector<uint8_t>& out = *file;
+  out.assign(identifier, identifier + sizeof(identifier));
+  PutU32(&out, vkFormat);
+  PutU32(&out, 1);  // typeSize: 8 bit channels or blocks
+  PutU32(&out, width);
+  PutU32(&out, height);
+  PutU32(&out, 0);  // pixelDepth
+  PutU32(&out, 0);  // layerCount
+  PutU32(&out, 1);  // faceCount
+  PutU32(&out, levelCount);
+  PutU32(&out, 0);  // supercompressionScheme
+  // dfd, kvd and sgd offsets and sizes, and the level index, set below
+  out.resize(kTutorialKtx2HeaderSize + levelCount * 24, 0);
+
+  const size_t dfdOffset = out.size();
+  if (!AppendDfd(vkFormat, &out)) return false;
+  SetU32(&out, 48, static_cast<uint32_t>(dfdOffset));
+  SetU32(&out, 52, static_cast<uint32_t>(out.size() - dfdOffset));
+
+  const size_t kvdOffset = out.size();
+  static const char kWriterKey[] = "KTXwriter";
+  static const char kWriterValue[] = "texture_cooker";
+  PutU32(&out, sizeof(kWriterKey) + sizeof(kWriterValue));
+  out.insert(out.end(), kWriterKey, kWriterKey + sizeof(kWriterKey));
+  out.insert(out.end(), kWriterValue, kWriterValue + sizeof(kWriterValue));
+  Align(&out, 4);
+  SetU32(&out, 56, static_cast<uint32_t>(kvdOffset));
+  SetU32(&out, 60, static_cast<uint32_t>(out.size() - kvdOffset));
+  SetU64(&out, 64, 0);  // no supercompression global data
+  SetU64(&out, 72, 0);
+
+  // level data: smallest first, each on a multiple of lcm(block size, 4)
+  const size_t alignment = std::max<size_t>(blockBytes, 4);
+  for (uint32_t level = levelCount; level-- > 0;) {
+    uint32_t levelWidth = std::max(width >> level, 1u);
+    uint32_t levelHeight = std::max(height >> level, 1u);
+    if (levels[level].size() != tutorialLevelSize(levelWidth, levelHeight,
+                                                  blockWidth, blockHeight,
+                                                  blockBytes)) {
+      return false;
+    }
+    Align(&out, alignment);
+    const size_t entry = kTutorialKtx2HeaderSize + level * 24;
+    SetU64(&out, entry, out.size());
+    SetU64(&out, entry + 8, levels[level].size());
+    SetU64(&out, entry + 16, levels[level].size());  // uncompressed size
+    out.insert(out.end(), levels[level].begin(), levels[level].end());
+  }
+  return true;
+}
@@ -0,0 +1,32 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KTX2_WRITER_HPP
+#define KTX2_WRITER_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Serialize a 2D texture into a KTX2 file, with the data format descriptor
+// the specification requires and a KTXwriter entry. Levels are given level
+// 0 (largest) first and stored smallest first, as the specification
+// recommends. Nothing but the arguments goes into the file (no time stamp,
+// no version), so equal inputs give byte identical files.
+// Formats: VK_FORMAT_R8G8B8A8_* and B8G8R8A8_* (UNORM, SRGB) and
+// VK_FORMAT_ETC2_R8G8B8_* and R8G8B8A8_* blocks; false for others.
+bool WriteKtx2(uint32_t vkFormat, uint32_t width, uint32_t height,
+               const std::vector<std::vector<uint8_t>>& levels,
+               std::vector<uint8_t>* file);
+
+#endif  // KTX2_WRITER_HPP
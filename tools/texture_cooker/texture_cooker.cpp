@@ -0,0 +1,291 @@
+// Copyright 2016 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// texture_cooker:
+//   Turn PNG assets into KTX2 files the tutorials upload as they are
+//   (TutorialTextureStreamer reads KTX2 without decoding anything):
+//     texture_cooker [options] input...
+//   Inputs are PNG files or directories, whose *.png files are cooked.
+//   Options:
+//     -o DIR       write DIR/<name>.ktx2 (default: next to each input)
+//     -f FORMAT    rgba8 (default), bgra8, or etc2: ETC2_R8G8B8 blocks for
+//                  opaque images, ETC2_R8G8B8A8 ones otherwise
+//     --srgb       the _SRGB variant of the format
+//     --no-mips    level 0 only (default: full mip chain, box filtered)
+//     -j N         files cooked in parallel (default: one per CPU)
+//     -v           print the PSNR of block compressed level 0
+//   Every file is decoded, converted to the channel order of its format,
+//   mip mapped and compressed up front; at run time only the copy is left.
+//   Output only depends on the input pixels and the options, so it can be
+//   cached by content.
+
+#include <dirent.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TutorialImageDecode.hpp"
+#include "TutorialKtx2.hpp"
+#include "TutorialPixels.hpp"
+#include "etc2_codec.hpp"
+#include "ktx2_writer.hpp"
+
+enum OutputFormat { kFormatRGBA8, kFormatBGRA8, kFormatETC2 };
+
+struct Options {
+  std::string outDir;
+  OutputFormat format = kFormatRGBA8;
+  bool srgb = false;
+  bool mipmaps = true;
+  bool verbose = false;
+  uint32_t threads = 0;
+};
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* data) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  uint8_t chunk[64 * 1024];
+  size_t read;
+  data->clear();
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data->insert(data->end(), chunk, chunk + read);
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+static bool WriteFile(const std::string& path,
+                      const std::vector<uint8_t>& data) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return (fclose(file) == 0) && ok;
+}
+
+static bool EndsWith(const std::string& s, const char* suffix) {
+  size_t n = strlen(suffix);
+  return s.size() >= n && !s.compare(s.size() - n, n, suffix);
+}
+
+static std::string OutputPath(const std::string& input,
+                              const Options& options) {
+  std::string name = input.substr(0, input.size() - strlen(".png"));
+  if (!options.outDir.empty()) {
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    name = options.outDir + "/" + name;
+  }
+  return name + ".ktx2";
+}
+
+// Peak signal to noise ratio of the RGB (and alpha) channels, in dB
+static double Psnr(const uint8_t* a, const uint8_t* b, size_t pixels,
+                   bool alpha) {
+  const uint32_t channels = alpha ? 4 : 3;
+  double error = 0.0;
+  for (size_t i = 0; i < pixels; i++) {
+    for (uint32_t c = 0; c < channels; c++) {
+      double d = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+      error += d * d;
+    }
+  }
+  if (error == 0.0) return INFINITY;
+  return 10.0 * log10(255.0 * 255.0 * pixels * channels / error);
+}
+
+// Cook one file; on return, report holds the line to print
+static bool Cook(const std::string& input, const Options& options,
+                 std::string* report) {
+  char line[512];
+  std::vector<uint8_t> data;
+  TutorialImage image;
+  if (!ReadFile(input, &data)) {
+    *report = input + ": cannot read";
+    return false;
+  }
+  if (!tutorialDecodeImage(data.data(), data.size(), &image)) {
+    *report = input + ": cannot decode";
+    return false;
+  }
+  if (options.mipmaps) tutorialGenerateMipmaps(&image);
+
+  bool alpha = false;
+  for (size_t i = 3; i < image.pixels_.size() && !alpha; i += 4) {
+    alpha = image.pixels_[i] != 0xFF;
+  }
+  uint32_t vkFormat;
+  switch (options.format) {
+    case kFormatBGRA8:
+      vkFormat = options.srgb ? 50 : 44;  // VK_FORMAT_B8G8R8A8_*
+      break;
+    case kFormatETC2:
+      // VK_FORMAT_ETC2_R8G8B8A8_*_BLOCK, or R8G8B8 without alpha
+      vkFormat = alpha ? (options.srgb ? 152 : 151) : (options.srgb ? 148 : 147);
+      break;
+    default:
+      vkFormat = options.srgb ? 43 : 37;  // VK_FORMAT_R8G8B8A8_*
+  }
+  uint32_t blockWidth, blockHeight, blockBytes;
+  tutorialFormatBlockInfo(vkFormat, &blockWidth, &blockHeight, &blockBytes);
+
+  std::vector<std::vector<uint8_t>> levels(image.mipLevels_);
+  double psnr = INFINITY;
+  for (uint32_t level = 0; level < image.mipLevels_; level++) {
+    uint32_t width, height;
+    size_t offset;
+    tutorialMipLevel(image, level, &width, &height, &offset);
+    const uint8_t* pixels = &image.pixels_[offset];
+    const size_t count = static_cast<size_t>(width) * height;
+    std::vector<uint8_t>& out = levels[level];
+    out.resize(tutorialLevelSize(width, height, blockWidth, blockHeight,
+                                 blockBytes));
+    switch (options.format) {
+      case kFormatRGBA8:
+        memcpy(out.data(), pixels, out.size());
+        break;
+      case kFormatBGRA8:
+        tutorialSwizzleRGBA(out.data(), pixels, count);
+        break;
+      case kFormatETC2:
+        EncodeEtc2(pixels, width, height, alpha, out.data());
+        if (options.verbose && level == 0) {
+          std::vector<uint8_t> decoded(count * 4);
+          DecodeEtc2(out.data(), width, height, alpha, decoded.data());
+          psnr = Psnr(pixels, decoded.data(), count, alpha);
+        }
+        break;
+    }
+  }
+
+  std::vector<uint8_t> file;
+  WriteKtx2(vkFormat, image.width_, image.height_, levels, &file);
+  // what the tutorials will make of it
+  TutorialKtx2Image check;
+  std::string error;
+  if (!tutorialParseKtx2(file.data(), file.size(), &check, &error)) {
+    *report = input + ": output does not parse: " + error;
+    return false;
+  }
+  const std::string output = OutputPath(input, options);
+  if (!WriteFile(output, file)) {
+    *report = output + ": cannot write";
+    return false;
+  }
+  int n = snprintf(line, sizeof(line),
+                   " (%ux%u, %u levels, VkFormat %u, %zu -> %zu bytes)",
+                   image.width_, image.height_, image.mipLevels_, vkFormat,
+                   data.size(), file.size());
+  if (options.verbose && options.format == kFormatETC2 && n > 0) {
+    snprintf(line + n, sizeof(line) - n, ", PSNR %.2f dB", psnr);
+  }
+  *report = input + " -> " + output + line;
+  return true;
+}
+
+// Inputs in a fixed order: directories are listed sorted
+static void CollectInputs(const char* path, std::vector<std::string>* files) {
+  DIR* dir = opendir(path);
+  if (!dir) {
+    files->push_back(path);
+    return;
+  }
+  std::vector<std::string> names;
+  while (dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (EndsWith(name, ".png")) names.push_back(std::string(path) + "/" + name);
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  files->insert(files->end(), names.begin(), names.end());
+}
+
+static int Usage(const char* self) {
+  fprintf(stderr,
+          "usage: %s [-o DIR] [-f rgba8|bgra8|etc2] [--srgb] [--no-mips] "
+          "[-j N] [-v] input...\n",
+          self);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "-o") && i + 1 < argc) {
+      options.outDir = argv[++i];
+    } else if (!strcmp(arg, "-f") && i + 1 < argc) {
+      const char* format = argv[++i];
+      if (!strcmp(format, "rgba8")) {
+        options.format = kFormatRGBA8;
+      } else if (!strcmp(format, "bgra8")) {
+        options.format = kFormatBGRA8;
+      } else if (!strcmp(format, "etc2")) {
+        options.format = kFormatETC2;
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (!strcmp(arg, "--srgb")) {
+      options.srgb = true;
+    } else if (!strcmp(arg, "--no-mips")) {
+      options.mipmaps = false;
+    } else if (!strcmp(arg, "-j") && i + 1 < argc) {
+      options.threads = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (!strcmp(arg, "-v")) {
+      options.verbose = true;
+    } else if (arg[0] == '-') {
+      return Usage(argv[0]);
+    } else {
+      CollectInputs(arg, &inputs);
+    }
+  }
+  if (inputs.empty()) return Usage(argv[0]);
+  for (auto& input : inputs) {
+    if (!EndsWith(input, ".png")) {
+      fprintf(stderr, "%s: not a .png file\n", input.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  // One file per worker at a time; files are independent, so the output
+  // does not depend on the number of workers or their timing
+  uint32_t threads = options.threads ? options.threads
+                                     : std::thread::hardware_concurrency();
+  threads = std::max(1u, std::min<uint32_t>(
+                             threads, static_cast<uint32_t>(inputs.size())));
+  std::vector<std::string> reports(inputs.size());
+  std::vector<char> succeeded(inputs.size(), 0);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i; (i = next++) < inputs.size();) {
+      succeeded[i] = Cook(inputs[i], options, &reports[i]);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < threads; i++) workers.emplace_back(worker);
+  for (auto& thread : workers) thread.join();
+
+  int failures = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    fprintf(succeeded[i] ? stdout : stderr, "%s\n", reports[i].c_str());
+    failures += !succeeded[i];
+  }
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
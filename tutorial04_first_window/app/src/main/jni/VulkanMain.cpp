@@ -16,6 +16,7 @@
 #include <android/log.h>
 #include <android_native_app_glue.h>
 #include <cassert>
+#include <chrono>
 #include <vector>
 #include <cstring>
 #include "vulkan_wrapper.h"
@@ -38,6 +39,10 @@ static const char* kTAG = "Vulkan-Tutorial04";
     assert(false);                                                    \
   }
 
+// Number of frames the CPU may record and submit ahead of the GPU.
+// Setting it to 1 serializes CPU and GPU work, one frame at a time.
+#define MAX_FRAMES_IN_FLIGHT 2
+
 // Global Variables ...
 struct VulkanDeviceInfo {
   bool initialized_;
@@ -71,11 +76,34 @@ struct VulkanRenderInfo {
   VkCommandPool cmdPool_;
   VkCommandBuffer* cmdBuffer_;
   uint32_t cmdBufferLen_;
-  VkSemaphore semaphore_;
-  VkFence fence_;
+
+  // sync objects for each frame in flight
+  VkSemaphore acquireSemaphore_[MAX_FRAMES_IN_FLIGHT];
+  VkFence fence_[MAX_FRAMES_IN_FLIGHT];
+  uint32_t currentFrame_;
+
+  // rendering done, one per swapchain image: the present of an image waits
+  // on it, and only acquiring that image again proves the present is done
+  // with it. The frame fence does not, it only covers the submit.
+  std::vector<VkSemaphore> renderSemaphore_;
+
+  // fence of the frame that last submitted each swapchain image's
+  // command buffer, VK_NULL_HANDLE if none is pending
+  std::vector<VkFence> imageFence_;
 };
 VulkanRenderInfo render;
 
+// Frame time counter, logged every kFrameStatsPeriod
+struct FrameStats {
+  std::chrono::steady_clock::time_point lastFrame_;
+  std::chrono::steady_clock::time_point periodStart_;
+  uint32_t frameCount_;
+  double minFrameMs_;
+  double maxFrameMs_;
+};
+FrameStats frameStats;
+static const std::chrono::seconds kFrameStatsPeriod(2);
+
 // Android Native App pointer...
 android_app* androidAppCtx = nullptr;
 
@@ -180,9 +208,10 @@ void CreateVulkanDevice(ANativeWindow* platformWindow,
   vkGetDeviceQueue(device.device_, device.queueFamilyIndex_, 0, &device.queue_);
 }
 
-void CreateSwapChain(void) {
+// Create the swapchain; when oldSwapchain is given, its resources are handed
+// over to the new one (the caller still has to destroy oldSwapchain)
+void CreateSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
   LOGI("->createSwapChain");
-  memset(&swapchain, 0, sizeof(swapchain));
 
   // **********************************************************
   // Get the surface capabilities because:
@@ -206,6 +235,9 @@ void CreateSwapChain(void) {
     if (formats[chosenFormat].format == VK_FORMAT_R8G8B8A8_UNORM) break;
   }
   assert(chosenFormat < formatCount);
+  // the render pass is not re-created with the swapchain
+  assert(oldSwapchain == VK_NULL_HANDLE ||
+         swapchain.displayFormat_ == formats[chosenFormat].format);
 
   swapchain.displaySize_ = surfaceCapabilities.currentExtent;
   swapchain.displayFormat_ = formats[chosenFormat].format;
@@ -229,7 +261,7 @@ void CreateSwapChain(void) {
       .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
       .presentMode = VK_PRESENT_MODE_FIFO_KHR,
       .clipped = VK_FALSE,
-      .oldSwapchain = VK_NULL_HANDLE,
+      .oldSwapchain = oldSwapchain,
   };
   CALL_VK(vkCreateSwapchainKHR(device.device_, &swapchainCreateInfo, nullptr,
                                &swapchain.swapchain_));
@@ -241,12 +273,20 @@ void CreateSwapChain(void) {
   LOGI("<-createSwapChain");
 }
 
-void DeleteSwapChain(void) {
+// Destroy the views and framebuffers of the swapchain images. The images
+// themselves are owned by the swapchain.
+void DeleteFrameBuffers(void) {
   for (int i = 0; i < swapchain.swapchainLength_; i++) {
     vkDestroyFramebuffer(device.device_, swapchain.framebuffers_[i], nullptr);
     vkDestroyImageView(device.device_, swapchain.displayViews_[i], nullptr);
-    vkDestroyImage(device.device_, swapchain.displayImages_[i], nullptr);
   }
+  swapchain.framebuffers_.clear();
+  swapchain.displayViews_.clear();
+  swapchain.displayImages_.clear();
+}
+
+void DeleteSwapChain(void) {
+  DeleteFrameBuffers();
   vkDestroySwapchainKHR(device.device_, swapchain.swapchain_, nullptr);
 }
 
@@ -314,6 +354,98 @@ void CreateFrameBuffers(VkRenderPass& renderPass,
   }
 }
 
+// Record a command buffer that just clear the screen
+// 1 command buffer draw in 1 framebuffer
+// In our case we need 2 command as we have 2 framebuffer
+void RecordCommandBuffers(void) {
+  render.cmdBufferLen_ = swapchain.swapchainLength_;
+  render.cmdBuffer_ = new VkCommandBuffer[swapchain.swapchainLength_];
+  for (int bufferIndex = 0; bufferIndex < swapchain.swapchainLength_;
+       bufferIndex++) {
+    // We start by creating and declare the "beginning" our command buffer
+    VkCommandBufferAllocateInfo cmdBufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = render.cmdPool_,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    CALL_VK(vkAllocateCommandBuffers(device.device_, &cmdBufferCreateInfo,
+                                     &render.cmdBuffer_[bufferIndex]));
+
+    VkCommandBufferBeginInfo cmdBufferBeginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .pInheritanceInfo = nullptr,
+    };
+    CALL_VK(vkBeginCommandBuffer(render.cmdBuffer_[bufferIndex],
+                                 &cmdBufferBeginInfo));
+    // transition the display image to color attachment layout
+    setImageLayout(render.cmdBuffer_[bufferIndex],
+                   swapchain.displayImages_[bufferIndex],
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    // Now we start a renderpass. Any draw command has to be recorded in a
+    // renderpass
+    VkClearValue clearVals {
+        .color = { .float32 {0.0f, 0.34f, 0.90f,1.0f}}
+    };
+    VkRenderPassBeginInfo renderPassBeginInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = nullptr,
+        .renderPass = render.renderPass_,
+        .framebuffer = swapchain.framebuffers_[bufferIndex],
+        .renderArea = {  .offset {.x = 0, .y = 0,}, .extent = swapchain.displaySize_ },
+        .clearValueCount = 1,
+        .pClearValues = &clearVals};
+    vkCmdBeginRenderPass(render.cmdBuffer_[bufferIndex], &renderPassBeginInfo,
+                         VK_SUBPASS_CONTENTS_INLINE);
+    // Do more drawing !
+
+    vkCmdEndRenderPass(render.cmdBuffer_[bufferIndex]);
+    // transition back to swapchain image to PRESENT_SRC_KHR
+    setImageLayout(render.cmdBuffer_[bufferIndex],
+                   swapchain.displayImages_[bufferIndex],
+                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    CALL_VK(vkEndCommandBuffer(render.cmdBuffer_[bufferIndex]));
+  }
+}
+
+void FreeCommandBuffers(void) {
+  vkFreeCommandBuffers(device.device_, render.cmdPool_, render.cmdBufferLen_,
+                       render.cmdBuffer_);
+  delete[] render.cmdBuffer_;
+  render.cmdBuffer_ = nullptr;
+  render.cmdBufferLen_ = 0;
+}
+
+// One render-complete semaphore per swapchain image
+void CreateRenderSemaphores(void) {
+  VkSemaphoreCreateInfo semaphoreCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+  };
+  render.renderSemaphore_.resize(swapchain.swapchainLength_);
+  for (auto& semaphore : render.renderSemaphore_) {
+    CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
+                              &semaphore));
+  }
+}
+
+void DeleteRenderSemaphores(void) {
+  for (auto semaphore : render.renderSemaphore_) {
+    vkDestroySemaphore(device.device_, semaphore, nullptr);
+  }
+  render.renderSemaphore_.clear();
+}
+
 // InitVulkan:
 //   Initialize Vulkan Context when android application window is created
 //   upon return, vulkan is ready to draw frames
@@ -396,86 +528,36 @@ bool InitVulkan(android_app* app) {
   CALL_VK(vkCreateCommandPool(device.device_, &cmdPoolCreateInfo, nullptr,
                               &render.cmdPool_));
 
-  // Record a command buffer that just clear the screen
-  // 1 command buffer draw in 1 framebuffer
-  // In our case we need 2 command as we have 2 framebuffer
-  render.cmdBufferLen_ = swapchain.swapchainLength_;
-  render.cmdBuffer_ = new VkCommandBuffer[swapchain.swapchainLength_];
-  for (int bufferIndex = 0; bufferIndex < swapchain.swapchainLength_;
-       bufferIndex++) {
-    // We start by creating and declare the "beginning" our command buffer
-    VkCommandBufferAllocateInfo cmdBufferCreateInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext = nullptr,
-        .commandPool = render.cmdPool_,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-    CALL_VK(vkAllocateCommandBuffers(device.device_, &cmdBufferCreateInfo,
-                                     &render.cmdBuffer_[bufferIndex]));
-
-    VkCommandBufferBeginInfo cmdBufferBeginInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .pInheritanceInfo = nullptr,
-    };
-    CALL_VK(vkBeginCommandBuffer(render.cmdBuffer_[bufferIndex],
-                                 &cmdBufferBeginInfo));
-    // transition the display image to color attachment layout
-    setImageLayout(render.cmdBuffer_[bufferIndex],
-                   swapchain.displayImages_[bufferIndex],
-                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    // Now we start a renderpass. Any draw command has to be recorded in a
-    // renderpass
-    VkClearValue clearVals {
-        .color = { .float32 {0.0f, 0.34f, 0.90f,1.0f}}
-    };
-    VkRenderPassBeginInfo renderPassBeginInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .pNext = nullptr,
-        .renderPass = render.renderPass_,
-        .framebuffer = swapchain.framebuffers_[bufferIndex],
-        .renderArea = {  .offset {.x = 0, .y = 0,}, .extent = swapchain.displaySize_ },
-        .clearValueCount = 1,
-        .pClearValues = &clearVals};
-    vkCmdBeginRenderPass(render.cmdBuffer_[bufferIndex], &renderPassBeginInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
-    // Do more drawing !
-
-    vkCmdEndRenderPass(render.cmdBuffer_[bufferIndex]);
-    // transition back to swapchain image to PRESENT_SRC_KHR
-    setImageLayout(render.cmdBuffer_[bufferIndex],
-                   swapchain.displayImages_[bufferIndex],
-                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-    CALL_VK(vkEndCommandBuffer(render.cmdBuffer_[bufferIndex]));
-  }
+  RecordCommandBuffers();
 
-  // We need to create a fence to be able, in the main loop, to wait for our
-  // draw command(s) to finish before swapping the framebuffers
+  // We need fences to be able, in the main loop, to wait for a frame's draw
+  // command(s) to finish before re-using its resources. They start signaled
+  // so the first MAX_FRAMES_IN_FLIGHT frames do not wait.
   VkFenceCreateInfo fenceCreateInfo{
       .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
       .pNext = nullptr,
-      .flags = 0,
+      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
   };
-  CALL_VK(
-      vkCreateFence(device.device_, &fenceCreateInfo, nullptr, &render.fence_));
-
-  // We need to create a semaphore to be able to wait, in the main loop, for our
-  // framebuffer to be available for us before drawing.
+  // We need semaphores to be able to wait on the GPU for our framebuffer to be
+  // available before drawing, and for drawing to finish before presenting.
   VkSemaphoreCreateInfo semaphoreCreateInfo{
       .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
   };
-  CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
-                            &render.semaphore_));
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    CALL_VK(vkCreateFence(device.device_, &fenceCreateInfo, nullptr,
+                          &render.fence_[frame]));
+    CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
+                              &render.acquireSemaphore_[frame]));
+  }
+  CreateRenderSemaphores();
+  render.currentFrame_ = 0;
+  render.imageFence_.assign(swapchain.swapchainLength_, VK_NULL_HANDLE);
+
+  frameStats = FrameStats();
+  frameStats.lastFrame_ = std::chrono::steady_clock::now();
+  frameStats.periodStart_ = frameStats.lastFrame_;
 
   device.initialized_ = true;
   return true;
@@ -486,9 +568,16 @@ bool InitVulkan(android_app* app) {
 bool IsVulkanReady(void) { return device.initialized_; }
 
 void DeleteVulkan(void) {
-  vkFreeCommandBuffers(device.device_, render.cmdPool_, render.cmdBufferLen_,
-                       render.cmdBuffer_);
-  delete[] render.cmdBuffer_;
+  // frames may still be in flight
+  vkDeviceWaitIdle(device.device_);
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    vkDestroyFence(device.device_, render.fence_[frame], nullptr);
+    vkDestroySemaphore(device.device_, render.acquireSemaphore_[frame],
+                       nullptr);
+  }
+  DeleteRenderSemaphores();
+
+  FreeCommandBuffers();
 
   vkDestroyCommandPool(device.device_, render.cmdPool_, nullptr);
   vkDestroyRenderPass(device.device_, render.renderPass_, nullptr);
@@ -500,43 +589,168 @@ void DeleteVulkan(void) {
   device.initialized_ = false;
 }
 
+// Check whether the surface size no longer matches the swapchain
+bool SwapchainExtentChanged(void) {
+  VkSurfaceCapabilitiesKHR surfaceCapabilities;
+  CALL_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+      device.gpuDevice_, device.surface_, &surfaceCapabilities));
+  return surfaceCapabilities.currentExtent.width !=
+             swapchain.displaySize_.width ||
+         surfaceCapabilities.currentExtent.height !=
+             swapchain.displaySize_.height;
+}
+
+// RecreateSwapchain():
+//   Rebuild the swapchain and the objects depending on its images (views,
+//   framebuffers, command buffers) in place, passing the current swapchain as
+//   oldSwapchain. Device, render pass and sync objects are kept.
+//   Returns false if the window currently has no area to render into.
+bool RecreateSwapchain(void) {
+  VkSurfaceCapabilitiesKHR surfaceCapabilities;
+  CALL_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+      device.gpuDevice_, device.surface_, &surfaceCapabilities));
+  if (surfaceCapabilities.currentExtent.width == 0 ||
+      surfaceCapabilities.currentExtent.height == 0) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Nothing may still reference the old framebuffers or command buffers
+  vkDeviceWaitIdle(device.device_);
+  FreeCommandBuffers();
+  DeleteFrameBuffers();
+
+  VkSwapchainKHR oldSwapchain = swapchain.swapchain_;
+  CreateSwapChain(oldSwapchain);
+  vkDestroySwapchainKHR(device.device_, oldSwapchain, nullptr);
+
+  CreateFrameBuffers(render.renderPass_);
+  RecordCommandBuffers();
+  // the new swapchain may have a different number of images
+  DeleteRenderSemaphores();
+  CreateRenderSemaphores();
+  render.imageFence_.assign(swapchain.swapchainLength_, VK_NULL_HANDLE);
+
+  LOGI("Swapchain re-created: %ux%u, %u images in %.2f ms",
+       swapchain.displaySize_.width, swapchain.displaySize_.height,
+       swapchain.swapchainLength_,
+       std::chrono::duration<double, std::milli>(
+           std::chrono::steady_clock::now() - start).count());
+  return true;
+}
+
+// Accumulate frame times, log average/min/max once per kFrameStatsPeriod
+void UpdateFrameStats(void) {
+  auto now = std::chrono::steady_clock::now();
+  double frameMs =
+      std::chrono::duration<double, std::milli>(now - frameStats.lastFrame_)
+          .count();
+  frameStats.lastFrame_ = now;
+
+  if (frameStats.frameCount_ == 0 || frameMs < frameStats.minFrameMs_) {
+    frameStats.minFrameMs_ = frameMs;
+  }
+  if (frameMs > frameStats.maxFrameMs_) {
+    frameStats.maxFrameMs_ = frameMs;
+  }
+  frameStats.frameCount_++;
+
+  auto period = now - frameStats.periodStart_;
+  if (period < kFrameStatsPeriod) return;
+
+  double periodMs =
+      std::chrono::duration<double, std::milli>(period).count();
+  double avgMs = periodMs / frameStats.frameCount_;
+  LOGI("%d frame(s) in flight: %u frames, avg %.2f ms (%.1f fps), "
+       "min %.2f ms, max %.2f ms",
+       MAX_FRAMES_IN_FLIGHT, frameStats.frameCount_, avgMs, 1000.0 / avgMs,
+       frameStats.minFrameMs_, frameStats.maxFrameMs_);
+  frameStats.periodStart_ = now;
+  frameStats.frameCount_ = 0;
+  frameStats.maxFrameMs_ = 0.0;
+}
+
 // Draw one frame
 bool VulkanDrawFrame(void) {
+  uint32_t frame = render.currentFrame_;
+
+  // Wait for the frame that used this slot MAX_FRAMES_IN_FLIGHT frames ago;
+  // the GPU keeps working on the frames submitted after it.
+  CALL_VK(vkWaitForFences(device.device_, 1, &render.fence_[frame], VK_TRUE,
+                          UINT64_MAX));
+
   uint32_t nextIndex;
   // Get the framebuffer index we should draw in
-  CALL_VK(vkAcquireNextImageKHR(device.device_, swapchain.swapchain_,
-                                UINT64_MAX, render.semaphore_, VK_NULL_HANDLE,
-                                &nextIndex));
-  CALL_VK(vkResetFences(device.device_, 1, &render.fence_));
+  VkResult result = vkAcquireNextImageKHR(
+      device.device_, swapchain.swapchain_, UINT64_MAX,
+      render.acquireSemaphore_[frame], VK_NULL_HANDLE, &nextIndex);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    // Nothing was acquired and the frame fence is still signaled, so the
+    // frame can be skipped altogether
+    RecreateSwapchain();
+    return true;
+  }
+  // VK_SUBOPTIMAL_KHR still acquired an image: draw it, re-create after present.
+  // Anything else (surface or device lost) leaves nothing to draw into.
+  if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    LOGE("vkAcquireNextImageKHR failed: %d", result);
+    return false;
+  }
+
+  // The pre-recorded command buffer of this image may still be executing
+  // for an older frame
+  if (render.imageFence_[nextIndex] != VK_NULL_HANDLE &&
+      render.imageFence_[nextIndex] != render.fence_[frame]) {
+    CALL_VK(vkWaitForFences(device.device_, 1, &render.imageFence_[nextIndex],
+                            VK_TRUE, UINT64_MAX));
+  }
+  render.imageFence_[nextIndex] = render.fence_[frame];
+
+  CALL_VK(vkResetFences(device.device_, 1, &render.fence_[frame]));
   VkPipelineStageFlags waitStageMask =
     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                              .pNext = nullptr,
-                              .waitSemaphoreCount = 1,
-                              .pWaitSemaphores = &render.semaphore_,
-                              .pWaitDstStageMask = &waitStageMask,
-                              .commandBufferCount = 1,
-                              .pCommandBuffers = &render.cmdBuffer_[nextIndex],
-                              .signalSemaphoreCount = 0,
-                              .pSignalSemaphores = nullptr};
-  CALL_VK(vkQueueSubmit(device.queue_, 1, &submit_info, render.fence_));
-  CALL_VK(
-      vkWaitForFences(device.device_, 1, &render.fence_, VK_TRUE, 100000000));
-
-  LOGI("Drawing frames......");
-
-  VkResult result;
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = nullptr,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &render.acquireSemaphore_[frame],
+      .pWaitDstStageMask = &waitStageMask,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &render.cmdBuffer_[nextIndex],
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &render.renderSemaphore_[nextIndex]};
+  CALL_VK(vkQueueSubmit(device.queue_, 1, &submit_info, render.fence_[frame]));
+
+  // Presentation waits on the GPU for the rendering, not on the CPU
   VkPresentInfoKHR presentInfo{
       .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
       .pNext = nullptr,
-      .waitSemaphoreCount = 0,
-      .pWaitSemaphores = nullptr,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &render.renderSemaphore_[nextIndex],
       .swapchainCount = 1,
       .pSwapchains = &swapchain.swapchain_,
       .pImageIndices = &nextIndex,
-      .pResults = &result,
+      .pResults = nullptr,
   };
-  vkQueuePresentKHR(device.queue_, &presentInfo);
+  VkResult presentResult = vkQueuePresentKHR(device.queue_, &presentInfo);
+
+  render.currentFrame_ = (frame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+  if (presentResult != VK_SUCCESS && presentResult != VK_SUBOPTIMAL_KHR &&
+      presentResult != VK_ERROR_OUT_OF_DATE_KHR) {
+    LOGE("vkQueuePresentKHR failed: %d", presentResult);
+    return false;
+  }
+  // Android reports VK_SUBOPTIMAL_KHR for as long as the display is rotated
+  // against our identity pre-transform, so only a size change is acted upon.
+  if (presentResult == VK_ERROR_OUT_OF_DATE_KHR ||
+      result == VK_SUBOPTIMAL_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || SwapchainExtentChanged()) {
+      RecreateSwapchain();
+    }
+  }
+  UpdateFrameStats();
   return true;
 }
 
@@ -14,14 +14,20 @@
 
 #include "VulkanMain.hpp"
 #include <vulkan_wrapper.h>
+#include <TutorialLayoutTracker.hpp>
+#include <TutorialMemory.hpp>
+#include <TutorialPipelineCache.hpp>
+#include <TutorialPipelineState.hpp>
+#include "shaders/tri.frag.h"
+#include "shaders/tri.vert.h"
 
 #include <android/log.h>
 #include <android/sync.h>
 
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <vector>
-#include <array>
 #include <unistd.h>
 #include <future>
 
@@ -76,16 +82,31 @@ VulkanSwapchainInfo swapchain;
 
 struct VulkanBufferInfo {
   VkBuffer vertexBuf_;
+  TutorialAllocation vertexMem_;
 };
 VulkanBufferInfo buffers;
 
+// Device memory for all buffers
+TutorialMemoryAllocator memoryAllocator;
+
+// Layout of the swapchain images, and the barriers between the regions
+// drawing into them
+TutorialLayoutTracker layouts;
+
 struct VulkanGfxPipelineInfo {
   VkPipelineLayout layout_;
   VkPipelineCache cache_;
-  VkPipeline pipeline_;
+  // Part of the key of the pipeline in pipelineStates, so kept until it is
+  // destroyed
+  VkShaderModule vertexShader_;
+  VkShaderModule fragmentShader_;
+  VkPipeline pipeline_;  // owned by pipelineStates
 };
 VulkanGfxPipelineInfo gfxPipeline;
 
+// One pipeline per distinct pipeline state
+TutorialPipelineStateCache pipelineStates;
+
 struct PerFrame
 {
     VkCommandBuffer cmdBuffers_[SCREEN_SPLITS];
@@ -140,15 +161,6 @@ int sync_wait(int fd, int timeout)
   return ret;
 }
 
-/*
- * setImageLayout():
- *    Helper function to transition color buffer layout
- */
-void setImageLayout(VkCommandBuffer cmdBuffer, VkImage image,
-                    VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-                    VkPipelineStageFlags srcStages,
-                    VkPipelineStageFlags destStages);
-
 // Create vulkan device
 void CreateVulkanDevice(ANativeWindow* platformWindow,
                         VkApplicationInfo* appInfo) {
@@ -243,6 +255,8 @@ void CreateVulkanDevice(ANativeWindow* platformWindow,
   CALL_VK(vkCreateDevice(device.gpuDevice_, &deviceCreateInfo, nullptr,
                          &device.device_));
   vkGetDeviceQueue(device.device_, device.queueFamilyIndex_, 0, &device.queue_);
+
+  memoryAllocator.Init(device.gpuDevice_, device.device_);
 }
 
 void CreateSwapChain(void) {
@@ -316,7 +330,8 @@ void DeleteSwapChain(void) {
   for (int i = 0; i < swapchain.swapchainLength_; i++) {
     vkDestroyFramebuffer(device.device_, swapchain.framebuffers_[i], nullptr);
     vkDestroyImageView(device.device_, swapchain.displayViews_[i], nullptr);
-    vkDestroyImage(device.device_, swapchain.displayImages_[i], nullptr);
+    // the images belong to the swapchain and go with it
+    layouts.Forget(swapchain.displayImages_[i]);
   }
   vkDestroySwapchainKHR(device.device_, swapchain.swapchain_, nullptr);
 }
@@ -384,26 +399,6 @@ void CreateFrameBuffers(VkRenderPass& renderPass,
   }
 }
 
-// A helper function
-bool MapMemoryTypeToIndex(uint32_t typeBits, VkFlags requirements_mask,
-                          uint32_t* typeIndex) {
-  VkPhysicalDeviceMemoryProperties memoryProperties;
-  vkGetPhysicalDeviceMemoryProperties(device.gpuDevice_, &memoryProperties);
-  // Search memtypes to find first index with those properties
-  for (uint32_t i = 0; i < 32; i++) {
-    if ((typeBits & 1) == 1) {
-      // Type is available, does it match user properties?
-      if ((memoryProperties.memoryTypes[i].propertyFlags & requirements_mask) ==
-          requirements_mask) {
-        *typeIndex = i;
-        return true;
-      }
-    }
-    typeBits >>= 1;
-  }
-  return false;
-}
-
 // Create our vertex buffer
 bool CreateBuffers(void) {
   // -----------------------------------------------
@@ -429,68 +424,36 @@ bool CreateBuffers(void) {
   CALL_VK(vkCreateBuffer(device.device_, &createBufferInfo, nullptr,
                          &buffers.vertexBuf_));
 
-  VkMemoryRequirements memReq;
-  vkGetBufferMemoryRequirements(device.device_, buffers.vertexBuf_, &memReq);
-
-  VkMemoryAllocateInfo allocInfo{
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .allocationSize = memReq.size,
-      .memoryTypeIndex = 0,  // Memory type assigned in the next step
-  };
-
-  // Assign the proper memory type for that buffer
-  MapMemoryTypeToIndex(memReq.memoryTypeBits,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &allocInfo.memoryTypeIndex);
+  // Sub-allocate host visible memory for the buffer and bind it
+  // Device local too when the GPU has unified memory: no staging copy needed
+  CALL_VK(memoryAllocator.AllocateBuffer(buffers.vertexBuf_,
+                                         kTutorialMemoryCpuToGpu,
+                                         "vertex buffer", &buffers.vertexMem_));
 
-  // Allocate memory for the buffer
-  VkDeviceMemory deviceMemory;
-  CALL_VK(vkAllocateMemory(device.device_, &allocInfo, nullptr, &deviceMemory));
-
-  void* data;
-  CALL_VK(vkMapMemory(device.device_, deviceMemory, 0, allocInfo.allocationSize,
-                      0, &data));
-  memcpy(data, vertexData, sizeof(vertexData));
-  vkUnmapMemory(device.device_, deviceMemory);
-
-  CALL_VK(
-      vkBindBufferMemory(device.device_, buffers.vertexBuf_, deviceMemory, 0));
+  memcpy(buffers.vertexMem_.mapped_, vertexData, sizeof(vertexData));
+  memoryAllocator.Flush(buffers.vertexMem_);
   return true;
 }
 
 void DeleteBuffers(void) {
   vkDestroyBuffer(device.device_, buffers.vertexBuf_, nullptr);
+  memoryAllocator.Free(&buffers.vertexMem_);
 }
 
-enum ShaderType { VERTEX_SHADER, FRAGMENT_SHADER };
-VkResult loadShaderFromFile(const char* filePath, VkShaderModule* shaderOut,
-                            ShaderType type) {
-  // Read the file
-  assert(androidAppCtx);
-  AAsset* file = AAssetManager_open(androidAppCtx->activity->assetManager,
-                                    filePath, AASSET_MODE_BUFFER);
-  size_t fileLength = AAsset_getLength(file);
-
-  char* fileContent = new char[fileLength];
-
-  AAsset_read(file, fileContent, fileLength);
-  AAsset_close(file);
-
+// Create a shader module from size bytes of SPIR-V
+VkResult CreateShaderModule(const uint32_t* code, size_t size,
+                            VkShaderModule* shaderOut) {
   VkShaderModuleCreateInfo shaderModuleCreateInfo{
       .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .codeSize = fileLength,
-      .pCode = (const uint32_t*)fileContent,
+      .codeSize = size,
+      .pCode = code,
   };
   VkResult result = vkCreateShaderModule(
       device.device_, &shaderModuleCreateInfo, nullptr, shaderOut);
   assert(result == VK_SUCCESS);
 
-  delete[] fileContent;
-
   return result;
 }
 
@@ -509,105 +472,12 @@ VkResult CreateGraphicsPipeline(void) {
   CALL_VK(vkCreatePipelineLayout(device.device_, &pipelineLayoutCreateInfo,
                                  nullptr, &gfxPipeline.layout_));
 
-  VkShaderModule vertexShader, fragmentShader;
-  loadShaderFromFile("shaders/tri.vert.spv", &vertexShader, VERTEX_SHADER);
-  loadShaderFromFile("shaders/tri.frag.spv", &fragmentShader, FRAGMENT_SHADER);
-
-  // Specify vertex and fragment shader stages
-  VkPipelineShaderStageCreateInfo shaderStages[2]{
-      {
-          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-          .pNext = nullptr,
-          .flags = 0,
-          .stage = VK_SHADER_STAGE_VERTEX_BIT,
-          .module = vertexShader,
-          .pName = "main",
-          .pSpecializationInfo = nullptr,
-      },
-      {
-          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-          .pNext = nullptr,
-          .flags = 0,
-          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-          .module = fragmentShader,
-          .pName = "main",
-          .pSpecializationInfo = nullptr,
-      }};
-
-  VkViewport viewports{
-      .x = 0,
-      .y = 0,
-      .width = (float)swapchain.displaySize_.width,
-      .height = (float)swapchain.displaySize_.height,
-      .minDepth = 0.0f,
-      .maxDepth = 1.0f,
-  };
-
-  VkRect2D scissor = {
-      .offset { .x = 0, .y = 0,},
-      .extent = swapchain.displaySize_,
-  };
-  // Specify viewport info
-  VkPipelineViewportStateCreateInfo viewportInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .viewportCount = 1,
-      .pViewports = &viewports,
-      .scissorCount = 1,
-      .pScissors = &scissor,
-  };
-
-  // Specify multisample info
-  VkSampleMask sampleMask = ~0u;
-  VkPipelineMultisampleStateCreateInfo multisampleInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-      .sampleShadingEnable = VK_FALSE,
-      .minSampleShading = 0,
-      .pSampleMask = &sampleMask,
-      .alphaToCoverageEnable = VK_FALSE,
-      .alphaToOneEnable = VK_FALSE,
-  };
-
-  // Specify color blend state
-  VkPipelineColorBlendAttachmentState attachmentStates{
-      .blendEnable = VK_FALSE,
-      .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-  };
-  VkPipelineColorBlendStateCreateInfo colorBlendInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-      .logicOpEnable = VK_FALSE,
-      .logicOp = VK_LOGIC_OP_COPY,
-      .attachmentCount = 1,
-      .pAttachments = &attachmentStates,
-  };
-
-  // Specify rasterizer info
-  VkPipelineRasterizationStateCreateInfo rasterInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .depthClampEnable = VK_FALSE,
-      .rasterizerDiscardEnable = VK_FALSE,
-      .polygonMode = VK_POLYGON_MODE_FILL,
-      .cullMode = VK_CULL_MODE_NONE,
-      .frontFace = VK_FRONT_FACE_CLOCKWISE,
-      .depthBiasEnable = VK_FALSE,
-      .lineWidth = 1,
-  };
+  // SPIR-V compiled from shaders/ at build time
+  CreateShaderModule(kTriVert, sizeof(kTriVert), &gfxPipeline.vertexShader_);
+  CreateShaderModule(kTriFrag, sizeof(kTriFrag), &gfxPipeline.fragmentShader_);
 
-  // Specify input assembler state
-  VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-      .primitiveRestartEnable = VK_FALSE,
-  };
-
-  // Specify vertex input state
+  // Everything else is the desc's defaults: a filled triangle list without
+  // culling or blending, with viewport and scissor set at draw time
   VkVertexInputBindingDescription vertex_input_bindings{
       .binding = 0,
       .stride = 3 * sizeof(float),
@@ -627,63 +497,47 @@ VkResult CreateGraphicsPipeline(void) {
       .vertexAttributeDescriptionCount = 1,
       .pVertexAttributeDescriptions = vertex_input_attributes,
   };
-
-  // Create the pipeline cache
-  VkPipelineCacheCreateInfo pipelineCacheInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,  // reserved, must be 0
-      .initialDataSize = 0,
-      .pInitialData = nullptr,
-  };
-
-  CALL_VK(vkCreatePipelineCache(device.device_, &pipelineCacheInfo, nullptr,
-                                &gfxPipeline.cache_));
-
-  std::array<VkDynamicState, 1> dynamics{VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamic{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
-  dynamic.pDynamicStates    = dynamics.data();
-  dynamic.dynamicStateCount = dynamics.size();
+  TutorialPipelineStateDesc state;
+  state.AddStage(VK_SHADER_STAGE_VERTEX_BIT, gfxPipeline.vertexShader_)
+      .AddStage(VK_SHADER_STAGE_FRAGMENT_BIT, gfxPipeline.fragmentShader_)
+      .SetVertexInput(vertexInputInfo);
+  state.layout_ = gfxPipeline.layout_;
+  state.renderPass_ = render.renderPass_;
+  state.subpass_ = 0;
+
+  // Create the pipeline cache, seeded with what the previous run saved
+  bool warmCache = false;
+  CALL_VK(tutorialCreatePipelineCache(
+      device.gpuDevice_, device.device_,
+      tutorialPipelineCachePath(androidAppCtx->activity->internalDataPath),
+      &gfxPipeline.cache_, &warmCache));
+  pipelineStates.Init(device.device_, gfxPipeline.cache_);
 
   // Create the pipeline
-  VkGraphicsPipelineCreateInfo pipelineCreateInfo{
-      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-      .stageCount = 2,
-      .pStages = shaderStages,
-      .pVertexInputState = &vertexInputInfo,
-      .pInputAssemblyState = &inputAssemblyInfo,
-      .pTessellationState = nullptr,
-      .pViewportState = &viewportInfo,
-      .pRasterizationState = &rasterInfo,
-      .pMultisampleState = &multisampleInfo,
-      .pDepthStencilState = nullptr,
-      .pColorBlendState = &colorBlendInfo,
-      .pDynamicState = &dynamic,
-      .layout = gfxPipeline.layout_,
-      .renderPass = render.renderPass_,
-      .subpass = 0,
-      .basePipelineHandle = VK_NULL_HANDLE,
-      .basePipelineIndex = 0,
-  };
-
-  VkResult pipelineResult = vkCreateGraphicsPipelines(
-      device.device_, gfxPipeline.cache_, 1, &pipelineCreateInfo, nullptr,
-      &gfxPipeline.pipeline_);
-
-  // We don't need the shaders anymore, we can release their memory
-  vkDestroyShaderModule(device.device_, vertexShader, nullptr);
-  vkDestroyShaderModule(device.device_, fragmentShader, nullptr);
-
-  return pipelineResult;
+  gfxPipeline.pipeline_ = pipelineStates.Get(state);
+  LOGI("Pipeline created in %.2f ms (%s pipeline cache)",
+       pipelineStates.GetStats().createMs_, warmCache ? "warm" : "cold");
+  return gfxPipeline.pipeline_ != VK_NULL_HANDLE
+             ? VK_SUCCESS
+             : VK_ERROR_INITIALIZATION_FAILED;
 }
 
 void DeleteGraphicsPipeline(void) {
-  if (gfxPipeline.pipeline_ == VK_NULL_HANDLE) return;
-  vkDestroyPipeline(device.device_, gfxPipeline.pipeline_, nullptr);
-  vkDestroyPipelineCache(device.device_, gfxPipeline.cache_, nullptr);
+  // CreateGraphicsPipeline() makes everything but the pipeline even when
+  // that fails: destroy what is there (destroying VK_NULL_HANDLE is a no-op)
+  pipelineStates.LogStats();
+  pipelineStates.Destroy();
+  vkDestroyShaderModule(device.device_, gfxPipeline.vertexShader_, nullptr);
+  vkDestroyShaderModule(device.device_, gfxPipeline.fragmentShader_, nullptr);
+  if (gfxPipeline.cache_ != VK_NULL_HANDLE) {
+    // Keep the compiled pipelines for the next launch
+    tutorialSavePipelineCache(
+        device.device_, gfxPipeline.cache_,
+        tutorialPipelineCachePath(androidAppCtx->activity->internalDataPath));
+    vkDestroyPipelineCache(device.device_, gfxPipeline.cache_, nullptr);
+  }
   vkDestroyPipelineLayout(device.device_, gfxPipeline.layout_, nullptr);
+  memset(&gfxPipeline, 0, sizeof(gfxPipeline));
 }
 // InitVulkan:
 //   Initialize Vulkan Context when android application window is created
@@ -757,8 +611,10 @@ bool InitVulkan(android_app* app) {
       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
       .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      // Each region loads what the regions before it drew. layouts moves
+      // the image in and out of the passes; they leave it alone.
+      .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
   };
 
   VkAttachmentReference colourReference = {
@@ -792,6 +648,10 @@ bool InitVulkan(android_app* app) {
   // -----------------------------------------------------------------
   // Create 2 frame buffers.
   CreateFrameBuffers(render.renderPass_);
+#ifndef NDEBUG
+  // report every transition that was asked for but not needed
+  layouts.SetDebug(true);
+#endif
 
   CreateBuffers();  // create vertex buffers
 
@@ -837,13 +697,16 @@ bool InitVulkan(android_app* app) {
       VkCommandBuffer cmdBuf = render.perframe_[frameIndex].cmdBuffers_[regionIndex];
       CALL_VK(vkBeginCommandBuffer(cmdBuf,
                                    &cmdBufferBeginInfo));
-      // transition the display image to color attachment layout
-      setImageLayout(cmdBuf,
-                     swapchain.displayImages_[frameIndex],
-                     VK_IMAGE_LAYOUT_UNDEFINED,
-                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+      // The regions are submitted in the order they are recorded in: the
+      // first one gets the image from the presentation engine and moves it
+      // to color attachment layout, the next ones only wait for the writes
+      // of the one before, and the last one hands it back for presenting
+      VkImage displayImage = swapchain.displayImages_[frameIndex];
+      if (regionIndex == 0) {
+        layouts.Track(displayImage, 1, 1, kTutorialUseAcquired);
+      }
+      layouts.Use(displayImage, kTutorialUseColorAttachment);
+      layouts.Flush(cmdBuf);
 
       // Now we start a renderpass. Any draw command has to be recorded in a
       // renderpass
@@ -855,10 +718,23 @@ bool InitVulkan(android_app* app) {
               .framebuffer = swapchain.framebuffers_[frameIndex],
               .renderArea = {.offset {.x = 0, .y = 0,},
                       .extent = swapchain.displaySize_},
-              .clearValueCount = 1,
-              .pClearValues = &clearVals};
+              .clearValueCount = 0,
+              .pClearValues = nullptr};
       vkCmdBeginRenderPass(cmdBuf, &renderPassBeginInfo,
                            VK_SUBPASS_CONTENTS_INLINE);
+      if (regionIndex == 0) {
+        // nothing to load yet: clear the whole image once
+        VkClearAttachment clearAttachment{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .colorAttachment = 0,
+                .clearValue = clearVals};
+        VkClearRect clearRect{
+                .rect = {.offset {.x = 0, .y = 0,},
+                        .extent = swapchain.displaySize_},
+                .baseArrayLayer = 0,
+                .layerCount = 1};
+        vkCmdClearAttachments(cmdBuf, 1, &clearAttachment, 1, &clearRect);
+      }
       // Bind what is necessary to the command buffer
       vkCmdBindPipeline(cmdBuf,
                         VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeline.pipeline_);
@@ -866,6 +742,15 @@ bool InitVulkan(android_app* app) {
       vkCmdBindVertexBuffers(cmdBuf, 0, 1,
                              &buffers.vertexBuf_, &offset);
 
+      VkViewport viewport{
+          .x = 0,
+          .y = 0,
+          .width = (float)swapchain.displaySize_.width,
+          .height = (float)swapchain.displaySize_.height,
+          .minDepth = 0.0f,
+          .maxDepth = 1.0f,
+      };
+      vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
       VkRect2D scissor{};
       scissor.extent.width = swapchain.displaySize_.width;
       scissor.offset.y = static_cast<float>(swapchain.displaySize_.height / SCREEN_SPLITS * regionIndex);
@@ -877,6 +762,10 @@ bool InitVulkan(android_app* app) {
       vkCmdDraw(cmdBuf, 3, 1, 0, 0);
 
       vkCmdEndRenderPass(cmdBuf);
+      if (regionIndex == SCREEN_SPLITS - 1) {
+        layouts.Use(displayImage, kTutorialUsePresent);
+        layouts.Flush(cmdBuf);
+      }
 
       CALL_VK(vkEndCommandBuffer(cmdBuf));
     }
@@ -909,9 +798,9 @@ bool InitVulkan(android_app* app) {
 bool IsVulkanReady(void) { return device.initialized_; }
 
 void DeleteVulkan(void) {
-  for (uint32_t frame = 0; swapchain.swapchainLength_; frame++) {
+  for (uint32_t frame = 0; frame < swapchain.swapchainLength_; frame++) {
     vkFreeCommandBuffers(device.device_, render.cmdPool_, SCREEN_SPLITS,
-                         render.perframe_->cmdBuffers_);
+                         render.perframe_[frame].cmdBuffers_);
   }
 
   vkDestroyCommandPool(device.device_, render.cmdPool_, nullptr);
@@ -920,6 +809,10 @@ void DeleteVulkan(void) {
   DeleteGraphicsPipeline();
   DeleteBuffers();
 
+  // Anything still allocated at this point is reported as a leak
+  memoryAllocator.LogStats();
+  memoryAllocator.Destroy();
+
   vkDestroyDevice(device.device_, nullptr);
   vkDestroyInstance(device.instance_, nullptr);
 
@@ -1055,81 +948,3 @@ bool VulkanDrawFrame(void) {
   vkDestroySemaphore(device.device_, render.perframe_[nextIndex].acquireSemaphore_, nullptr);
   return true;
 }
-
-/*
- * setImageLayout():
- *    Helper function to transition color buffer layout
- */
-void setImageLayout(VkCommandBuffer cmdBuffer, VkImage image,
-                    VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-                    VkPipelineStageFlags srcStages,
-                    VkPipelineStageFlags destStages) {
-  VkImageMemoryBarrier imageMemoryBarrier = {
-      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      .pNext = NULL,
-      .srcAccessMask = 0,
-      .dstAccessMask = 0,
-      .oldLayout = oldImageLayout,
-      .newLayout = newImageLayout,
-      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .image = image,
-      .subresourceRange =
-          {
-              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-              .baseMipLevel = 0,
-              .levelCount = 1,
-              .baseArrayLayer = 0,
-              .layerCount = 1,
-          },
-  };
-
-  switch (oldImageLayout) {
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_PREINITIALIZED:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-      break;
-
-    default:
-      break;
-  }
-
-  switch (newImageLayout) {
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask =
-          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-      break;
-
-    default:
-      break;
-  }
-
-  vkCmdPipelineBarrier(cmdBuffer, srcStages, destStages, 0, 0, NULL, 0, NULL, 1,
-                       &imageMemoryBarrier);
-}
@@ -24,7 +24,7 @@ void handle_cmd(android_app* app, int32_t cmd) {
       break;
     case APP_CMD_TERM_WINDOW:
       // The window is being hidden or closed, clean it up.
-      DeleteVulkan();
+      if (IsVulkanReady()) DeleteVulkan();
       break;
     default:
       __android_log_print(ANDROID_LOG_INFO, "Vulkan Tutorials",
@@ -48,9 +48,9 @@ void android_main(struct android_app* app) {
       if (source != NULL) source->process(app, source);
     }
 
-    // render if vulkan is ready
-    if (IsVulkanReady()) {
-      VulkanDrawFrame();
+    // render if vulkan is ready, tear it down once the surface or device is lost
+    if (IsVulkanReady() && !VulkanDrawFrame()) {
+      DeleteVulkan();
     }
   } while (app->destroyRequested == 0);
 }
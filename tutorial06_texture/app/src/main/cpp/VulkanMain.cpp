@@ -13,14 +13,26 @@
 // limitations under the License.
 
 #include <android/log.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <vector>
 #include "vulkan_wrapper.h"
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_ONLY_PNG
-#include <stb/stb_image.h>
-#include "CreateShaderModule.h"
+#include "TutorialAssetArchive.hpp"
+#include "TutorialLayoutTracker.hpp"
+#include "TutorialMemory.hpp"
+#include "TutorialPipelineCache.hpp"
+#include "TutorialPipelineCompiler.hpp"
+#include "TutorialPipelineState.hpp"
+#include "TutorialPipelineVariants.hpp"
+#include "TutorialPngDecoder.hpp"
+#include "TutorialShaderReflect.hpp"
+#include "TutorialTextureCache.hpp"
+#include "TutorialTextureStreamer.hpp"
+#include "TutorialThreadPool.hpp"
 #include "VulkanMain.hpp"
+#include "shaders/tri.frag.h"
+#include "shaders/tri.vert.h"
 
 // Android log function wrappers
 static const char* kTAG = "Vulkan-Tutorial06";
@@ -44,13 +56,16 @@ static const char* kTAG = "Vulkan-Tutorial06";
 // Used also for non-vulkan functions but return VK_SUCCESS
 #define VK_CHECK(x) CALL_VK(x)
 
+// Number of frames the CPU may record and submit ahead of the GPU.
+// Setting it to 1 serializes CPU and GPU work, one frame at a time.
+#define MAX_FRAMES_IN_FLIGHT 2
+
 // Global Variables ...
 struct VulkanDeviceInfo {
   bool initialized_;
 
   VkInstance instance_;
   VkPhysicalDevice gpuDevice_;
-  VkPhysicalDeviceMemoryProperties gpuMemoryProperties_;
   VkDevice device_;
   uint32_t queueFamilyIndex_;
 
@@ -77,49 +92,114 @@ typedef struct texture_object {
   VkSampler sampler;
   VkImage image;
   VkImageLayout imageLayout;
-  VkDeviceMemory mem;
+  TutorialAllocation mem;
   VkImageView view;
   int32_t tex_width;
   int32_t tex_height;
+  // image, view and mem belong to textureCache, under file
+  const char* file;
+  // no streamed image will come, the placeholder stays
+  bool failed;
 } texture_object;
 static const VkFormat kTexFmt = VK_FORMAT_R8G8B8A8_UNORM;
 #define TUTORIAL_TEXTURE_COUNT 1
-const char* texFiles[TUTORIAL_TEXTURE_COUNT] = {
-    "sample_tex.png",
+// Variants of each texture, preferred first: a block compressed KTX2 file
+// is used when the GPU samples its format, the PNG otherwise
+const std::vector<const char*> texFiles[TUTORIAL_TEXTURE_COUNT] = {
+    {"sample_tex.ktx2", "sample_tex.png"},
 };
 struct texture_object textures[TUTORIAL_TEXTURE_COUNT];
 
 struct VulkanBufferInfo {
   VkBuffer vertexBuf_;
+  TutorialAllocation vertexMem_;
 };
 VulkanBufferInfo buffers;
 
+// Device memory for all buffers and textures
+TutorialMemoryAllocator memoryAllocator;
+
+// Layout of the swapchain images and textures, and the barriers between
+// their uses
+TutorialLayoutTracker layouts;
+
 struct VulkanGfxPipelineInfo {
   VkDescriptorSetLayout dscLayout_;
   VkDescriptorPool descPool_;
-  VkDescriptorSet descSet_;
+  // one per swapchain image, bound by that image's command buffer only, so
+  // that a set can be rewritten as soon as its command buffer is idle
+  std::vector<VkDescriptorSet> descSets_;
   VkPipelineLayout layout_;
   VkPipelineCache cache_;
-  VkPipeline pipeline_;
+  // Kept until pipelineCompiler is done with them
+  VkShaderModule vertexShader_;
+  VkShaderModule fragmentShader_;
+  // Variants of the pipeline in pipelineVariants: textured_ samples
+  // textures[], untextured_ shows the texture coordinates while textures[]
+  // only holds placeholders
+  uint32_t textured_;
+  uint32_t untextured_;
 };
 VulkanGfxPipelineInfo gfxPipeline;
+TutorialPipelineVariants pipelineVariants;
+// Builds the variants on threadPool, so that the first frames do not wait
+// for them
+TutorialPipelineCompiler pipelineCompiler;
+
+// Layouts and vertex input of the pipeline, reflected from the shaders
+TutorialShaderReflector shaderReflector;
+TutorialShaderInterface shaderInterface;
+
+// Specialization constants of tri.frag
+enum FragmentConstant : uint32_t {
+  kFragTextureCount = 0,
+  kFragTextured = 1,
+};
 
 struct VulkanRenderInfo {
   VkRenderPass renderPass_;
   VkCommandPool cmdPool_;
   VkCommandBuffer* cmdBuffer_;
   uint32_t cmdBufferLen_;
-  VkSemaphore semaphore_;
-  VkFence fence_;
+
+  // sync objects for each frame in flight
+  VkSemaphore acquireSemaphore_[MAX_FRAMES_IN_FLIGHT];
+  VkFence fence_[MAX_FRAMES_IN_FLIGHT];
+  uint32_t currentFrame_;
+
+  // rendering done, one per swapchain image: the present of an image waits
+  // on it, and only acquiring that image again proves the present is done
+  // with it. The frame fence does not, it only covers the submit.
+  std::vector<VkSemaphore> renderSemaphore_;
+
+  // fence of the frame that last submitted each swapchain image's
+  // command buffer, VK_NULL_HANDLE if none is pending
+  std::vector<VkFence> imageFence_;
+
+  // Bumped whenever the textures or pipelines change; each swapchain image's
+  // command buffer and descriptor set are refreshed, once idle, when they
+  // were recorded for an older generation
+  uint64_t generation_;
+  std::vector<uint64_t> recordedGeneration_;
 };
 VulkanRenderInfo render;
 
+// Frame time counter, logged every kFrameStatsPeriod
+struct FrameStats {
+  std::chrono::steady_clock::time_point lastFrame_;
+  std::chrono::steady_clock::time_point periodStart_;
+  uint32_t frameCount_;
+  double minFrameMs_;
+  double maxFrameMs_;
+};
+FrameStats frameStats;
+static const std::chrono::seconds kFrameStatsPeriod(2);
+
 // Android Native App pointer...
 android_app* androidAppCtx = nullptr;
-void setImageLayout(VkCommandBuffer cmdBuffer, VkImage image,
-                    VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-                    VkPipelineStageFlags srcStages,
-                    VkPipelineStageFlags destStages);
+void RecordCommandBuffers(void);
+void RecordCommandBuffer(uint32_t bufferIndex);
+void FreeCommandBuffers(void);
 
 // Create vulkan device
 void CreateVulkanDevice(ANativeWindow* platformWindow,
@@ -163,9 +243,6 @@ void CreateVulkanDevice(ANativeWindow* platformWindow,
   CALL_VK(vkEnumeratePhysicalDevices(device.instance_, &gpuCount, tmpGpus));
   device.gpuDevice_ = tmpGpus[0];  // Pick up the first GPU Device
 
-  vkGetPhysicalDeviceMemoryProperties(device.gpuDevice_,
-                                      &device.gpuMemoryProperties_);
-
   // Find a GFX queue family
   uint32_t queueFamilyCount;
   vkGetPhysicalDeviceQueueFamilyProperties(device.gpuDevice_, &queueFamilyCount,
@@ -213,11 +290,14 @@ void CreateVulkanDevice(ANativeWindow* platformWindow,
   CALL_VK(vkCreateDevice(device.gpuDevice_, &deviceCreateInfo, nullptr,
                          &device.device_));
   vkGetDeviceQueue(device.device_, 0, 0, &device.queue_);
+
+  memoryAllocator.Init(device.gpuDevice_, device.device_);
 }
 
-void CreateSwapChain(void) {
+// Create the swapchain; when oldSwapchain is given, its resources are handed
+// over to the new one (the caller still has to destroy oldSwapchain)
+void CreateSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
   LOGI("->createSwapChain");
-  memset(&swapchain, 0, sizeof(swapchain));
 
   // **********************************************************
   // Get the surface capabilities because:
@@ -241,6 +321,9 @@ void CreateSwapChain(void) {
     if (formats[chosenFormat].format == VK_FORMAT_R8G8B8A8_UNORM) break;
   }
   assert(chosenFormat < formatCount);
+  // the render pass and pipeline are not re-created with the swapchain
+  assert(oldSwapchain == VK_NULL_HANDLE ||
+         swapchain.displayFormat_ == formats[chosenFormat].format);
 
   swapchain.displaySize_ = surfaceCapabilities.currentExtent;
   swapchain.displayFormat_ = formats[chosenFormat].format;
@@ -264,7 +347,7 @@ void CreateSwapChain(void) {
       .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
       .presentMode = VK_PRESENT_MODE_FIFO_KHR,
       .clipped = VK_FALSE,
-      .oldSwapchain = VK_NULL_HANDLE,
+      .oldSwapchain = oldSwapchain,
   };
   CALL_VK(vkCreateSwapchainKHR(device.device_, &swapchainCreateInfo, nullptr,
                                &swapchain.swapchain_));
@@ -276,15 +359,24 @@ void CreateSwapChain(void) {
   LOGI("<-createSwapChain");
 }
 
-void DeleteSwapChain(void) {
+// Destroy the views and framebuffers of the swapchain images. The images
+// themselves are owned by the swapchain.
+void DeleteFrameBuffers(void) {
   for (int i = 0; i < swapchain.swapchainLength_; i++) {
+    layouts.Forget(swapchain.displayImages_[i]);
     vkDestroyFramebuffer(device.device_, swapchain.framebuffers_[i], nullptr);
     vkDestroyImageView(device.device_, swapchain.displayViews_[i], nullptr);
   }
   delete[] swapchain.framebuffers_;
   delete[] swapchain.displayViews_;
   delete[] swapchain.displayImages_;
+  swapchain.framebuffers_ = nullptr;
+  swapchain.displayViews_ = nullptr;
+  swapchain.displayImages_ = nullptr;
+}
 
+void DeleteSwapChain(void) {
+  DeleteFrameBuffers();
   vkDestroySwapchainKHR(device.device_, swapchain.swapchain_, nullptr);
 }
 
@@ -352,272 +444,174 @@ void CreateFrameBuffers(VkRenderPass& renderPass,
   }
 }
 
-// A help function to map required memory property into a VK memory type
-// memory type is an index into the array of 32 entries; or the bit index
-// for the memory type ( each BIT of an 32 bit integer is a type ).
-VkResult AllocateMemoryTypeFromProperties(uint32_t typeBits,
-                                          VkFlags requirements_mask,
-                                          uint32_t* typeIndex) {
-  // Search memtypes to find first index with those properties
-  for (uint32_t i = 0; i < 32; i++) {
-    if ((typeBits & 1) == 1) {
-      // Type is available, does it match user properties?
-      if ((device.gpuMemoryProperties_.memoryTypes[i].propertyFlags &
-           requirements_mask) == requirements_mask) {
-        *typeIndex = i;
-        return VK_SUCCESS;
-      }
-    }
-    typeBits >>= 1;
+// Where textures are read from: assets.pak when the APK has one (see
+// tools/asset_pack), mapped once and searched by name, the APK's own files
+// otherwise
+TutorialApkAssets apkAssets;
+TutorialAssetArchive assetArchive;
+TutorialAssetSource* assets;
+
+void OpenAssets(AAssetManager* manager) {
+  apkAssets.Init(manager);
+  assets = &apkAssets;
+  TutorialAssetView pak;
+  if (!apkAssets.Open("assets.pak", &pak)) return;
+  std::string error;
+  if (!assetArchive.Init(std::move(pak), &error)) {
+    LOGE("assets.pak: %s, reading the APK instead", error.c_str());
+    return;
   }
-  // No memory types matched, return failure
-  return VK_ERROR_MEMORY_MAP_FAILED;
+  LOGI("assets.pak: %zu assets", assetArchive.Count());
+  assets = &assetArchive;
 }
 
-VkResult LoadTextureFromFile(const char* filePath,
-                             struct texture_object* tex_obj,
-                             VkImageUsageFlags usage, VkFlags required_props) {
-  if (!(usage | required_props)) {
-    __android_log_print(ANDROID_LOG_ERROR, "tutorial texture",
-                        "No usage and required_pros");
-    return VK_ERROR_FORMAT_NOT_SUPPORTED;
-  }
+// Threads for everything loaded in the background, one per core
+TutorialThreadPool threadPool;
 
-  // Check for linear supportability
-  VkFormatProperties props;
-  bool needBlit = true;
-  vkGetPhysicalDeviceFormatProperties(device.gpuDevice_, kTexFmt, &props);
-  assert((props.linearTilingFeatures | props.optimalTilingFeatures) &
-         VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+// Texture streamer feeding textures[], and the cache sharing what it loads
+TutorialTextureStreamer textureStreamer;
+TutorialTextureCache textureCache;
 
-  if (props.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) {
-    // linear format supporting the required texture
-    needBlit = false;
+// Write every texture into the descriptor set
+void WriteTextureDescriptors(VkDescriptorSet descSet) {
+  VkDescriptorImageInfo texDsts[TUTORIAL_TEXTURE_COUNT];
+  memset(texDsts, 0, sizeof(texDsts));
+  for (int32_t idx = 0; idx < TUTORIAL_TEXTURE_COUNT; idx++) {
+    texDsts[idx].sampler = textures[idx].sampler;
+    texDsts[idx].imageView = textures[idx].view;
+    texDsts[idx].imageLayout = textures[idx].imageLayout;
   }
 
-  // Read the file:
-  AAsset* file = AAssetManager_open(androidAppCtx->activity->assetManager,
-                                    filePath, AASSET_MODE_BUFFER);
-  size_t fileLength = AAsset_getLength(file);
-  stbi_uc* fileContent = new unsigned char[fileLength];
-  AAsset_read(file, fileContent, fileLength);
-  AAsset_close(file);
-
-  uint32_t imgWidth, imgHeight, n;
-  unsigned char* imageData = stbi_load_from_memory(
-      fileContent, fileLength, reinterpret_cast<int*>(&imgWidth),
-      reinterpret_cast<int*>(&imgHeight), reinterpret_cast<int*>(&n), 4);
-  assert(n == 4);
-
-  tex_obj->tex_width = imgWidth;
-  tex_obj->tex_height = imgHeight;
-
-  // Allocate the linear texture so texture could be copied over
-  VkImageCreateInfo image_create_info = {
-      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-      .imageType = VK_IMAGE_TYPE_2D,
-      .format = kTexFmt,
-      .extent = {static_cast<uint32_t>(imgWidth),
-                 static_cast<uint32_t>(imgHeight), 1},
-      .mipLevels = 1,
-      .arrayLayers = 1,
-      .samples = VK_SAMPLE_COUNT_1_BIT,
-      .tiling = VK_IMAGE_TILING_LINEAR,
-      .usage = (needBlit ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-                         : VK_IMAGE_USAGE_SAMPLED_BIT),
-      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-      .queueFamilyIndexCount = 1,
-      .pQueueFamilyIndices = &device.queueFamilyIndex_,
-      .initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-  };
-  VkMemoryAllocateInfo mem_alloc = {
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+  VkWriteDescriptorSet writeDst{
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
       .pNext = nullptr,
-      .allocationSize = 0,
-      .memoryTypeIndex = 0,
-  };
+      .dstSet = descSet,
+      .dstBinding = 0,
+      .dstArrayElement = 0,
+      .descriptorCount = TUTORIAL_TEXTURE_COUNT,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo = texDsts,
+      .pBufferInfo = nullptr,
+      .pTexelBufferView = nullptr};
+  vkUpdateDescriptorSets(device.device_, 1, &writeDst, 0, nullptr);
+}
 
-  VkMemoryRequirements mem_reqs;
-  CALL_VK(vkCreateImage(device.device_, &image_create_info, nullptr,
-                        &tex_obj->image));
-  vkGetImageMemoryRequirements(device.device_, tex_obj->image, &mem_reqs);
-  mem_alloc.allocationSize = mem_reqs.size;
-  VK_CHECK(AllocateMemoryTypeFromProperties(mem_reqs.memoryTypeBits,
-                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                                            &mem_alloc.memoryTypeIndex));
-  CALL_VK(vkAllocateMemory(device.device_, &mem_alloc, nullptr, &tex_obj->mem));
-  CALL_VK(vkBindImageMemory(device.device_, tex_obj->image, tex_obj->mem, 0));
-
-  if (required_props & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-    const VkImageSubresource subres = {
-        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .arrayLayer = 0,
-    };
-    VkSubresourceLayout layout;
-    void* data;
-
-    vkGetImageSubresourceLayout(device.device_, tex_obj->image, &subres,
-                                &layout);
-    CALL_VK(vkMapMemory(device.device_, tex_obj->mem, 0,
-                        mem_alloc.allocationSize, 0, &data));
-
-    for (int32_t y = 0; y < imgHeight; y++) {
-      unsigned char* row = (unsigned char*)((char*)data + layout.rowPitch * y);
-      for (int32_t x = 0; x < imgWidth; x++) {
-        row[x * 4] = imageData[(x + y * imgWidth) * 4];
-        row[x * 4 + 1] = imageData[(x + y * imgWidth) * 4 + 1];
-        row[x * 4 + 2] = imageData[(x + y * imgWidth) * 4 + 2];
-        row[x * 4 + 3] = imageData[(x + y * imgWidth) * 4 + 3];
-      }
+// Images replaced while command buffers may still sample them, destroyed
+// once every swapchain image has been recorded for a later generation
+struct RetiredTexture {
+  VkImage image_;
+  VkImageView view_;
+  TutorialAllocation mem_;
+  uint64_t generation_;  // render.generation_ that no longer uses it
+};
+std::vector<RetiredTexture> retiredTextures;
+
+// Destroy the retired textures no command buffer can reference any more;
+// all of them when the device is idle
+void DestroyRetiredTextures(bool deviceIdle) {
+  uint64_t oldest = render.generation_;
+  for (auto generation : render.recordedGeneration_) {
+    oldest = std::min(oldest, generation);
+  }
+  auto it = retiredTextures.begin();
+  while (it != retiredTextures.end()) {
+    if (!deviceIdle && it->generation_ > oldest) {
+      ++it;
+      continue;
     }
-
-    vkUnmapMemory(device.device_, tex_obj->mem);
-    stbi_image_free(imageData);
+    vkDestroyImageView(device.device_, it->view_, nullptr);
+    vkDestroyImage(device.device_, it->image_, nullptr);
+    memoryAllocator.Free(&it->mem_);
+    it = retiredTextures.erase(it);
   }
-  delete[] fileContent;
-
-  tex_obj->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-  VkCommandPoolCreateInfo cmdPoolCreateInfo{
-      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-      .queueFamilyIndex = device.queueFamilyIndex_,
-  };
-
-  VkCommandPool cmdPool;
-  CALL_VK(vkCreateCommandPool(device.device_, &cmdPoolCreateInfo, nullptr,
-                              &cmdPool));
-
-  VkCommandBuffer gfxCmd;
-  const VkCommandBufferAllocateInfo cmd = {
-      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .commandPool = cmdPool,
-      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-      .commandBufferCount = 1,
-  };
+}
 
-  CALL_VK(vkAllocateCommandBuffers(device.device_, &cmd, &gfxCmd));
-  VkCommandBufferBeginInfo cmd_buf_info = {
-      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-      .pInheritanceInfo = nullptr};
-  CALL_VK(vkBeginCommandBuffer(gfxCmd, &cmd_buf_info));
-
-  // If linear is supported, we are done
-  VkImage stageImage = VK_NULL_HANDLE;
-  VkDeviceMemory stageMem = VK_NULL_HANDLE;
-  if (!needBlit) {
-    setImageLayout(gfxCmd, tex_obj->image, VK_IMAGE_LAYOUT_PREINITIALIZED,
-                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                   VK_PIPELINE_STAGE_HOST_BIT,
-                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-  } else {
-    // save current image and mem as staging image and memory
-    stageImage = tex_obj->image;
-    stageMem = tex_obj->mem;
-    tex_obj->image = VK_NULL_HANDLE;
-    tex_obj->mem = VK_NULL_HANDLE;
-
-    // Create a tile texture to blit into
-    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
-    image_create_info.usage =
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    CALL_VK(vkCreateImage(device.device_, &image_create_info, nullptr,
-                          &tex_obj->image));
-    vkGetImageMemoryRequirements(device.device_, tex_obj->image, &mem_reqs);
-
-    mem_alloc.allocationSize = mem_reqs.size;
-    VK_CHECK(AllocateMemoryTypeFromProperties(
-        mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &mem_alloc.memoryTypeIndex));
-    CALL_VK(
-        vkAllocateMemory(device.device_, &mem_alloc, nullptr, &tex_obj->mem));
-    CALL_VK(vkBindImageMemory(device.device_, tex_obj->image, tex_obj->mem, 0));
-
-    // transitions image out of UNDEFINED type
-    setImageLayout(gfxCmd, stageImage, VK_IMAGE_LAYOUT_PREINITIALIZED,
-                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                   VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-    setImageLayout(gfxCmd, tex_obj->image, VK_IMAGE_LAYOUT_UNDEFINED,
-                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                   VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-    VkImageCopy bltInfo{
-        .srcSubresource {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-         },
-        .srcOffset { .x = 0, .y = 0, .z = 0 },
-        .dstSubresource {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-         },
-        .dstOffset { .x = 0, .y = 0, .z = 0},
-        .extent { .width = imgWidth, .height = imgHeight, .depth = 1,},
-    };
-    vkCmdCopyImage(gfxCmd, stageImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                   tex_obj->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-                   &bltInfo);
-
-    setImageLayout(gfxCmd, tex_obj->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                   VK_PIPELINE_STAGE_TRANSFER_BIT,
-                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+// Called on the render thread when a texture is ready: replace whatever
+// textures[idx] holds (the placeholder) with it. file is set for textures
+// owned by textureCache.
+void OnTextureReady(uint32_t idx, const TutorialStreamedTexture& tex,
+                    const char* file) {
+  if (tex.failed_) {
+    LOGE("%s failed to load, keeping the placeholder", tex.name_.c_str());
+    textures[idx].failed = true;
+    // TexturesStreamed() may have changed the pipeline to draw with
+    if (device.initialized_) render.generation_++;
+    return;
+  }
+  bool live = device.initialized_;
+  // VulkanDrawFrame() updates each image's descriptor set and command buffer
+  // as the image comes up again
+  if (live) render.generation_++;
+  if (textures[idx].image != VK_NULL_HANDLE && !textures[idx].file) {
+    layouts.Forget(textures[idx].image);
+    if (live) {
+      // the frames in flight may still sample it: dropped once no command
+      // buffer is left that does
+      retiredTextures.push_back(RetiredTexture{
+          .image_ = textures[idx].image,
+          .view_ = textures[idx].view,
+          .mem_ = textures[idx].mem,
+          .generation_ = render.generation_,
+      });
+    } else {
+      vkDestroyImageView(device.device_, textures[idx].view, nullptr);
+      vkDestroyImage(device.device_, textures[idx].image, nullptr);
+      memoryAllocator.Free(&textures[idx].mem);
+    }
   }
+  textures[idx].image = tex.image_;
+  textures[idx].view = tex.view_;
+  textures[idx].mem = tex.mem_;
+  // the upload batch left every level ready to sample
+  layouts.Track(tex.image_, tex.mipLevels_, tex.layers_, kTutorialUseSampled);
+  textures[idx].imageLayout = layouts.State(tex.image_).layout_;
+  textures[idx].tex_width = tex.width_;
+  textures[idx].tex_height = tex.height_;
+  textures[idx].file = file;
+}
 
-  CALL_VK(vkEndCommandBuffer(gfxCmd));
-  VkFenceCreateInfo fenceInfo = {
-      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-  };
-  VkFence fence;
-  CALL_VK(vkCreateFence(device.device_, &fenceInfo, nullptr, &fence));
+// True once every texture holds its streamed image or has given up on it,
+// false while any one is still waiting for its image
+bool TexturesStreamed(void) {
+  for (uint32_t i = 0; i < TUTORIAL_TEXTURE_COUNT; i++) {
+    if (!textures[i].file && !textures[i].failed) return false;
+  }
+  return true;
+}
 
-  VkSubmitInfo submitInfo = {
-      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      .pNext = nullptr,
-      .waitSemaphoreCount = 0,
-      .pWaitSemaphores = nullptr,
-      .pWaitDstStageMask = nullptr,
-      .commandBufferCount = 1,
-      .pCommandBuffers = &gfxCmd,
-      .signalSemaphoreCount = 0,
-      .pSignalSemaphores = nullptr,
-  };
-  CALL_VK(vkQueueSubmit(device.queue_, 1, &submitInfo, fence) != VK_SUCCESS);
-  CALL_VK(vkWaitForFences(device.device_, 1, &fence, VK_TRUE, 100000000) !=
-          VK_SUCCESS);
-  vkDestroyFence(device.device_, fence, nullptr);
-
-  vkFreeCommandBuffers(device.device_, cmdPool, 1, &gfxCmd);
-  vkDestroyCommandPool(device.device_, cmdPool, nullptr);
-  if (stageImage != VK_NULL_HANDLE) {
-    vkDestroyImage(device.device_, stageImage, nullptr);
-    vkFreeMemory(device.device_, stageMem, nullptr);
+// A small grey checkerboard bound until the real texture is streamed in.
+// The untextured pipeline draws meanwhile, but the descriptor set still
+// needs a valid view.
+TutorialImage PlaceholderImage(void) {
+  const uint32_t kSize = 8;
+  TutorialImage image;
+  image.width_ = kSize;
+  image.height_ = kSize;
+  image.mipLevels_ = 1;
+  image.pixels_.resize(kSize * kSize * 4);
+  for (uint32_t y = 0; y < kSize; y++) {
+    for (uint32_t x = 0; x < kSize; x++) {
+      uint8_t* pixel = &image.pixels_[(y * kSize + x) * 4];
+      pixel[0] = pixel[1] = pixel[2] = ((x ^ y) & 1) ? 0x60 : 0xA0;
+      pixel[3] = 0xFF;
+    }
   }
-  return VK_SUCCESS;
+  return image;
 }
 
+// CreateTexture():
+//   Give every texture a placeholder right away and queue the real image on
+//   textureStreamer, through textureCache, so the first frame does not wait
+//   for PNG decoding. The textures decode in parallel on threadPool and are
+//   uploaded together, in the batch of the first Update() after them.
 void CreateTexture(void) {
   for (uint32_t i = 0; i < TUTORIAL_TEXTURE_COUNT; i++) {
-    LoadTextureFromFile(texFiles[i], &textures[i], VK_IMAGE_USAGE_SAMPLED_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-
     const VkSamplerCreateInfo sampler = {
         .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
         .pNext = nullptr,
-        .magFilter = VK_FILTER_NEAREST,
-        .minFilter = VK_FILTER_NEAREST,
-        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
         .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
         .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
         .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
@@ -625,51 +619,55 @@ void CreateTexture(void) {
         .maxAnisotropy = 1,
         .compareOp = VK_COMPARE_OP_NEVER,
         .minLod = 0.0f,
-        .maxLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,  // every level the image view has
         .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
         .unnormalizedCoordinates = VK_FALSE,
     };
-    VkImageViewCreateInfo view = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .image = VK_NULL_HANDLE,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
-        .format = kTexFmt,
-        .components =
-            {
-                VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
-                VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A,
-            },
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
-    };
-
     CALL_VK(vkCreateSampler(device.device_, &sampler, nullptr,
                             &textures[i].sampler));
-    view.image = textures[i].image;
-    CALL_VK(
-        vkCreateImageView(device.device_, &view, nullptr, &textures[i].view));
+    textures[i].image = VK_NULL_HANDLE;
+    textures[i].view = VK_NULL_HANDLE;
+    textures[i].file = nullptr;
+    textures[i].failed = false;
+
+    textureStreamer.Upload("placeholder", PlaceholderImage(),
+                           [i](const TutorialStreamedTexture& tex) {
+                             OnTextureReady(i, tex, nullptr);
+                           });
+    const char* file = textureStreamer.SelectVariant(texFiles[i]);
+    if (file) {
+      textureCache.Acquire(file, true,
+                           [i, file](const TutorialStreamedTexture& tex) {
+                             OnTextureReady(i, tex, file);
+                           });
+    } else {
+      LOGE("no usable file for texture %u", i);
+      textures[i].failed = true;
+    }
+  }
+  // Only the placeholders are waited for; the descriptor set needs a view
+  while (true) {
+    bool placeholders = true;
+    for (uint32_t i = 0; i < TUTORIAL_TEXTURE_COUNT; i++) {
+      placeholders &= (textures[i].view != VK_NULL_HANDLE);
+    }
+    if (placeholders) break;
+    textureStreamer.Update(true);
   }
 }
 
-// A helper function
-bool MapMemoryTypeToIndex(uint32_t typeBits, VkFlags requirements_mask,
-                          uint32_t* typeIndex) {
-  VkPhysicalDeviceMemoryProperties memoryProperties;
-  vkGetPhysicalDeviceMemoryProperties(device.gpuDevice_, &memoryProperties);
-  // Search memtypes to find first index with those properties
-  for (uint32_t i = 0; i < 32; i++) {
-    if ((typeBits & 1) == 1) {
-      // Type is available, does it match user properties?
-      if ((memoryProperties.memoryTypes[i].propertyFlags & requirements_mask) ==
-          requirements_mask) {
-        *typeIndex = i;
-        return true;
-      }
+void DeleteTextures(void) {
+  for (uint32_t i = 0; i < TUTORIAL_TEXTURE_COUNT; i++) {
+    vkDestroySampler(device.device_, textures[i].sampler, nullptr);
+    layouts.Forget(textures[i].image);
+    if (textures[i].file) {
+      textureCache.Release(textures[i].file, true);
+      continue;
     }
-    typeBits >>= 1;
+    vkDestroyImageView(device.device_, textures[i].view, nullptr);
+    vkDestroyImage(device.device_, textures[i].image, nullptr);
+    memoryAllocator.Free(&textures[i].mem);
   }
-  return false;
 }
 
 // Create our vertex buffer
@@ -695,311 +693,315 @@ bool CreateBuffers(void) {
   CALL_VK(vkCreateBuffer(device.device_, &createBufferInfo, nullptr,
                          &buffers.vertexBuf_));
 
-  VkMemoryRequirements memReq;
-  vkGetBufferMemoryRequirements(device.device_, buffers.vertexBuf_, &memReq);
-
-  VkMemoryAllocateInfo allocInfo{
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .allocationSize = memReq.size,
-      .memoryTypeIndex = 0,  // Memory type assigned in the next step
-  };
-
-  // Assign the proper memory type for that buffer
-  MapMemoryTypeToIndex(memReq.memoryTypeBits,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &allocInfo.memoryTypeIndex);
-
-  // Allocate memory for the buffer
-  VkDeviceMemory deviceMemory;
-  CALL_VK(vkAllocateMemory(device.device_, &allocInfo, nullptr, &deviceMemory));
-
-  void* data;
-  CALL_VK(vkMapMemory(device.device_, deviceMemory, 0, allocInfo.allocationSize,
-                      0, &data));
-  memcpy(data, vertexData, sizeof(vertexData));
-  vkUnmapMemory(device.device_, deviceMemory);
+  // Sub-allocate host visible memory for the buffer and bind it
+  // Device local too when the GPU has unified memory: no staging copy needed
+  CALL_VK(memoryAllocator.AllocateBuffer(buffers.vertexBuf_,
+                                         kTutorialMemoryCpuToGpu,
+                                         "vertex buffer", &buffers.vertexMem_));
 
-  CALL_VK(
-      vkBindBufferMemory(device.device_, buffers.vertexBuf_, deviceMemory, 0));
+  memcpy(buffers.vertexMem_.mapped_, vertexData, sizeof(vertexData));
+  memoryAllocator.Flush(buffers.vertexMem_);
   return true;
 }
 
 void DeleteBuffers(void) {
   vkDestroyBuffer(device.device_, buffers.vertexBuf_, nullptr);
+  memoryAllocator.Free(&buffers.vertexMem_);
+}
+
+// Create a shader module from size bytes of SPIR-V
+VkResult CreateShaderModule(const uint32_t* code, size_t size,
+                            VkShaderModule* shaderOut) {
+  VkShaderModuleCreateInfo shaderModuleCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .codeSize = size,
+      .pCode = code,
+  };
+  return vkCreateShaderModule(device.device_, &shaderModuleCreateInfo,
+                              nullptr, shaderOut);
 }
 
 // Create Graphics Pipeline
 VkResult CreateGraphicsPipeline(void) {
   memset(&gfxPipeline, 0, sizeof(gfxPipeline));
 
-  const VkDescriptorSetLayoutBinding descriptorSetLayoutBinding{
-      .binding = 0,
-      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-      .descriptorCount = TUTORIAL_TEXTURE_COUNT,
-      .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-      .pImmutableSamplers = nullptr,
-  };
-  const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-      .pNext = nullptr,
-      .bindingCount = 1,
-      .pBindings = &descriptorSetLayoutBinding,
-  };
-  CALL_VK(vkCreateDescriptorSetLayout(device.device_,
-                                      &descriptorSetLayoutCreateInfo, nullptr,
-                                      &gfxPipeline.dscLayout_));
-  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-      .pNext = nullptr,
-      .setLayoutCount = 1,
-      .pSetLayouts = &gfxPipeline.dscLayout_,
-      .pushConstantRangeCount = 0,
-      .pPushConstantRanges = nullptr,
-  };
-  CALL_VK(vkCreatePipelineLayout(device.device_, &pipelineLayoutCreateInfo,
-                                 nullptr, &gfxPipeline.layout_));
-
-  // No dynamic state in that tutorial
-  VkPipelineDynamicStateCreateInfo dynamicStateInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .dynamicStateCount = 0,
-      .pDynamicStates = nullptr};
-
-  VkShaderModule vertexShader, fragmentShader;
-  buildShaderFromFile(androidAppCtx, "shaders/tri.vert",
-                      VK_SHADER_STAGE_VERTEX_BIT, device.device_,
-                      &vertexShader);
-  buildShaderFromFile(androidAppCtx, "shaders/tri.frag",
-                      VK_SHADER_STAGE_FRAGMENT_BIT, device.device_,
-                      &fragmentShader);
-  // Specify vertex and fragment shader stages
-  VkPipelineShaderStageCreateInfo shaderStages[2]{
-      {
-          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-          .pNext = nullptr,
-          .flags = 0,
-          .stage = VK_SHADER_STAGE_VERTEX_BIT,
-          .module = vertexShader,
-          .pName = "main",
-          .pSpecializationInfo = nullptr,
-      },
-      {
-          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-          .pNext = nullptr,
-          .flags = 0,
-          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-          .module = fragmentShader,
-          .pName = "main",
-          .pSpecializationInfo = nullptr,
-      }};
-
-  VkViewport viewports {
-      .x = 0,
-      .y = 0,
-      .width = (float)swapchain.displaySize_.width,
-      .height = (float)swapchain.displaySize_.height,
-      .minDepth = 0.0f,
-      .maxDepth = 1.0f,
-  };
+  // The layouts come from the shaders themselves. tri.frag's sampler array
+  // is sized by a specialization constant, so it is reflected with the
+  // value the pipelines use.
+  TutorialSpecialization fragmentConstants;
+  fragmentConstants.Set(kFragTextureCount, TUTORIAL_TEXTURE_COUNT);
+  const TutorialShaderReflection* vertexReflection =
+      shaderReflector.Reflect(kTriVert, sizeof(kTriVert));
+  const TutorialShaderReflection* fragmentReflection =
+      shaderReflector.Reflect(kTriFrag, sizeof(kTriFrag), &fragmentConstants);
+  if (!vertexReflection || !fragmentReflection) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  shaderInterface = TutorialShaderInterface();
+  shaderInterface.Add(*vertexReflection);
+  shaderInterface.Add(*fragmentReflection);
+  assert(shaderInterface.VertexStride() == 5 * sizeof(float));
+
+  // tri.frag uses set 0 only
+  std::vector<VkDescriptorSetLayout> setLayouts;
+  CALL_VK(shaderInterface.CreateSetLayouts(device.device_, &setLayouts));
+  assert(setLayouts.size() == 1);
+  gfxPipeline.dscLayout_ = setLayouts[0];
+  CALL_VK(shaderInterface.CreatePipelineLayout(device.device_, setLayouts,
+                                               &gfxPipeline.layout_));
+
+  // SPIR-V compiled from shaders/ at build time (see tutorial_embed_shaders()
+  // in common/cmake/TutorialShaders.cmake)
+  CALL_VK(CreateShaderModule(kTriVert, sizeof(kTriVert),
+                             &gfxPipeline.vertexShader_));
+  CALL_VK(CreateShaderModule(kTriFrag, sizeof(kTriFrag),
+                             &gfxPipeline.fragmentShader_));
+
+  // The rest is the desc's defaults: a filled triangle list without culling
+  // or blending, with viewport and scissor dynamic so the pipeline survives
+  // swapchain re-creation with a different size
+  TutorialPipelineStateDesc state;
+  state.AddStage(VK_SHADER_STAGE_VERTEX_BIT, gfxPipeline.vertexShader_)
+      .AddStage(VK_SHADER_STAGE_FRAGMENT_BIT, gfxPipeline.fragmentShader_)
+      .SetVertexInput(*shaderInterface.VertexInput());
+  state.layout_ = gfxPipeline.layout_;
+  state.renderPass_ = render.renderPass_;
+  state.subpass_ = 0;
+
+  // Create the pipeline cache, seeded with what the previous run saved
+  bool warmCache = false;
+  CALL_VK(tutorialCreatePipelineCache(
+      device.gpuDevice_, device.device_,
+      tutorialPipelineCachePath(androidAppCtx->activity->internalDataPath),
+      &gfxPipeline.cache_, &warmCache));
+
+  // Both variants of the fragment shader. The shader's sampler array is
+  // sized by the constant, so it always matches the descriptor set layout.
+  // The desc's hash keys the variants.
+  TutorialPipelineCreateInfo pipelineCreateInfo(state);
+  pipelineVariants.Init(device.device_, pipelineCreateInfo.Info(),
+                        state.Hash());
+  gfxPipeline.textured_ = pipelineVariants.Add("textured");
+  pipelineVariants.Specialize(gfxPipeline.textured_,
+                              VK_SHADER_STAGE_FRAGMENT_BIT)
+      .Set(kFragTextureCount, TUTORIAL_TEXTURE_COUNT)
+      .Set(kFragTextured, true);
+  gfxPipeline.untextured_ = pipelineVariants.Add("untextured");
+  pipelineVariants.Specialize(gfxPipeline.untextured_,
+                              VK_SHADER_STAGE_FRAGMENT_BIT)
+      .Set(kFragTextureCount, TUTORIAL_TEXTURE_COUNT)
+      .Set(kFragTextured, false);
+
+  // Compiled in the background, while the first frames are only cleared;
+  // VulkanDrawFrame() picks them up as they finish
+  pipelineCompiler.Init(device.device_, gfxPipeline.cache_, &threadPool);
+  pipelineVariants.Compile(&pipelineCompiler);
+  LOGI("Pipelines queued (%s pipeline cache)", warmCache ? "warm" : "cold");
+  return VK_SUCCESS;
+}
 
-  VkRect2D scissor = {
-          .offset = {.x = 0, .y = 0,},
-          .extent = swapchain.displaySize_,
-   };
-  // Specify viewport info
-  VkPipelineViewportStateCreateInfo viewportInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .viewportCount = 1,
-      .pViewports = &viewports,
-      .scissorCount = 1,
-      .pScissors = &scissor,
-  };
+// The pipeline to draw with: textured once the textures and its pipeline
+// are both ready, untextured until then. VK_NULL_HANDLE while neither has
+// compiled; the frame is only cleared.
+VkPipeline DrawPipeline(void) {
+  VkPipeline textured = pipelineVariants.Pipeline(gfxPipeline.textured_);
+  if (TexturesStreamed() && textured != VK_NULL_HANDLE) return textured;
+  return pipelineVariants.Pipeline(gfxPipeline.untextured_);
+}
 
-  // Specify multisample info
-  VkSampleMask sampleMask = ~0u;
-  VkPipelineMultisampleStateCreateInfo multisampleInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-      .sampleShadingEnable = VK_FALSE,
-      .minSampleShading = 0,
-      .pSampleMask = &sampleMask,
-      .alphaToCoverageEnable = VK_FALSE,
-      .alphaToOneEnable = VK_FALSE,
-  };
+void DeleteGraphicsPipeline(void) {
+  if (gfxPipeline.layout_ == VK_NULL_HANDLE) return;
+  // Waits for the pipelines still compiling
+  pipelineCompiler.Destroy();
+  pipelineVariants.Destroy();
+  vkDestroyShaderModule(device.device_, gfxPipeline.vertexShader_, nullptr);
+  vkDestroyShaderModule(device.device_, gfxPipeline.fragmentShader_, nullptr);
+  // Keep the compiled pipelines for the next launch
+  tutorialSavePipelineCache(
+      device.device_, gfxPipeline.cache_,
+      tutorialPipelineCachePath(androidAppCtx->activity->internalDataPath));
+  vkDestroyPipelineCache(device.device_, gfxPipeline.cache_, nullptr);
+  vkDestroyPipelineLayout(device.device_, gfxPipeline.layout_, nullptr);
+  vkDestroyDescriptorSetLayout(device.device_, gfxPipeline.dscLayout_,
+                               nullptr);
+}
 
-  // Specify color blend state
-  VkPipelineColorBlendAttachmentState attachmentStates{
-     .blendEnable = VK_FALSE,
-     .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                       VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-  };
-  VkPipelineColorBlendStateCreateInfo colorBlendInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+// initialize the descriptor sets, one per swapchain image
+VkResult CreateDescriptorSets(void) {
+  const uint32_t setCount = swapchain.swapchainLength_;
+  std::vector<VkDescriptorPoolSize> type_counts =
+      shaderInterface.PoolSizes(0);
+  for (auto& size : type_counts) size.descriptorCount *= setCount;
+  const VkDescriptorPoolCreateInfo descriptor_pool = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .logicOpEnable = VK_FALSE,
-      .logicOp = VK_LOGIC_OP_COPY,
-      .attachmentCount = 1,
-      .pAttachments = &attachmentStates,
+      .maxSets = setCount,
+      .poolSizeCount = static_cast<uint32_t>(type_counts.size()),
+      .pPoolSizes = type_counts.data(),
   };
 
-  // Specify rasterizer info
-  VkPipelineRasterizationStateCreateInfo rasterInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .depthClampEnable = VK_FALSE,
-      .rasterizerDiscardEnable = VK_FALSE,
-      .polygonMode = VK_POLYGON_MODE_FILL,
-      .cullMode = VK_CULL_MODE_NONE,
-      .frontFace = VK_FRONT_FACE_CLOCKWISE,
-      .depthBiasEnable = VK_FALSE,
-      .lineWidth = 1,
-  };
+  CALL_VK(vkCreateDescriptorPool(device.device_, &descriptor_pool, nullptr,
+                                 &gfxPipeline.descPool_));
 
-  // Specify input assembler state
-  VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+  std::vector<VkDescriptorSetLayout> setLayouts(setCount,
+                                                gfxPipeline.dscLayout_);
+  VkDescriptorSetAllocateInfo alloc_info{
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
       .pNext = nullptr,
-      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-      .primitiveRestartEnable = VK_FALSE,
-  };
+      .descriptorPool = gfxPipeline.descPool_,
+      .descriptorSetCount = setCount,
+      .pSetLayouts = setLayouts.data()};
+  gfxPipeline.descSets_.resize(setCount);
+  CALL_VK(vkAllocateDescriptorSets(device.device_, &alloc_info,
+                                   gfxPipeline.descSets_.data()));
 
-  // Specify vertex input state
-  VkVertexInputBindingDescription vertex_input_bindings{
-      .binding = 0,
-      .stride = 5 * sizeof(float),
-      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-  };
-  VkVertexInputAttributeDescription vertex_input_attributes[2]{
-      {
-          .location = 0,
-          .binding = 0,
-          .format = VK_FORMAT_R32G32B32_SFLOAT,
-          .offset = 0,
-      },
-      {
-          .location = 1,
-          .binding = 0,
-          .format = VK_FORMAT_R32G32_SFLOAT,
-          .offset = sizeof(float) * 3,
-      }};
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-      .pNext = nullptr,
-      .vertexBindingDescriptionCount = 1,
-      .pVertexBindingDescriptions = &vertex_input_bindings,
-      .vertexAttributeDescriptionCount = 2,
-      .pVertexAttributeDescriptions = vertex_input_attributes,
-  };
+  for (auto descSet : gfxPipeline.descSets_) WriteTextureDescriptors(descSet);
+  return VK_SUCCESS;
+}
+
+// The sets go with their pool
+void DeleteDescriptorSets(void) {
+  vkDestroyDescriptorPool(device.device_, gfxPipeline.descPool_, nullptr);
+  gfxPipeline.descSets_.clear();
+}
 
-  // Create the pipeline cache
-  VkPipelineCacheCreateInfo pipelineCacheInfo{
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+// Record the draw commands for every swapchain image
+// 1 command buffer draw in 1 framebuffer
+void RecordCommandBuffers(void) {
+  render.recordedGeneration_.assign(swapchain.swapchainLength_,
+                                    render.generation_);
+  render.cmdBufferLen_ = swapchain.swapchainLength_;
+  render.cmdBuffer_ = new VkCommandBuffer[swapchain.swapchainLength_];
+  VkCommandBufferAllocateInfo cmdBufferCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
       .pNext = nullptr,
-      .flags = 0,  // reserved, must be 0
-      .initialDataSize = 0,
-      .pInitialData = nullptr,
+      .commandPool = render.cmdPool_,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = render.cmdBufferLen_,
   };
+  CALL_VK(vkAllocateCommandBuffers(device.device_, &cmdBufferCreateInfo,
+                                   render.cmdBuffer_));
 
-  CALL_VK(vkCreatePipelineCache(device.device_, &pipelineCacheInfo, nullptr,
-                                &gfxPipeline.cache_));
+  for (uint32_t bufferIndex = 0; bufferIndex < swapchain.swapchainLength_;
+       bufferIndex++) {
+    RecordCommandBuffer(bufferIndex);
+  }
+}
 
-  // Create the pipeline
-  VkGraphicsPipelineCreateInfo pipelineCreateInfo{
-      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+// Record the command buffer of one swapchain image, with the current
+// pipeline and textures. The pool resets it when it begins; it must not be
+// pending.
+void RecordCommandBuffer(uint32_t bufferIndex) {
+  // We start by creating and declare the "beginning" our command buffer
+  VkCommandBufferBeginInfo cmdBufferBeginInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .stageCount = 2,
-      .pStages = shaderStages,
-      .pVertexInputState = &vertexInputInfo,
-      .pInputAssemblyState = &inputAssemblyInfo,
-      .pTessellationState = nullptr,
-      .pViewportState = &viewportInfo,
-      .pRasterizationState = &rasterInfo,
-      .pMultisampleState = &multisampleInfo,
-      .pDepthStencilState = nullptr,
-      .pColorBlendState = &colorBlendInfo,
-      .pDynamicState = &dynamicStateInfo,
-      .layout = gfxPipeline.layout_,
-      .renderPass = render.renderPass_,
-      .subpass = 0,
-      .basePipelineHandle = VK_NULL_HANDLE,
-      .basePipelineIndex = 0,
+      .pInheritanceInfo = nullptr,
+  };
+  CALL_VK(vkBeginCommandBuffer(render.cmdBuffer_[bufferIndex],
+                               &cmdBufferBeginInfo));
+
+  // transition the buffer into color attachment. The render pass clears
+  // it, so whatever the last frame left is not needed: every recording
+  // starts from an acquired image.
+  VkImage displayImage = swapchain.displayImages_[bufferIndex];
+  layouts.Track(displayImage, 1, 1, kTutorialUseAcquired);
+  layouts.Use(displayImage, kTutorialUseColorAttachment);
+  layouts.Flush(render.cmdBuffer_[bufferIndex]);
+
+  // Now we start a renderpass. Any draw command has to be recorded in a
+  // renderpass
+  VkClearValue clearVals{
+      .color { .float32 { 0.0f, 0.34f, 0.90f, 1.0f,}},
   };
 
-  VkResult pipelineResult = vkCreateGraphicsPipelines(
-      device.device_, gfxPipeline.cache_, 1, &pipelineCreateInfo, nullptr,
-      &gfxPipeline.pipeline_);
+  VkRenderPassBeginInfo renderPassBeginInfo{
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .pNext = nullptr,
+      .renderPass = render.renderPass_,
+      .framebuffer = swapchain.framebuffers_[bufferIndex],
+      .renderArea = {.offset =
+                         {
+                             .x = 0, .y = 0,
+                         },
+                     .extent = swapchain.displaySize_},
+      .clearValueCount = 1,
+      .pClearValues = &clearVals};
+  vkCmdBeginRenderPass(render.cmdBuffer_[bufferIndex], &renderPassBeginInfo,
+                       VK_SUBPASS_CONTENTS_INLINE);
+  // Bind what is necessary to the command buffer. Without a pipeline yet
+  // the frame is recorded again once pipelineCompiler has one.
+  VkPipeline pipeline = DrawPipeline();
+  if (pipeline != VK_NULL_HANDLE) {
+    vkCmdBindPipeline(render.cmdBuffer_[bufferIndex],
+                      VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  }
+  vkCmdBindDescriptorSets(
+      render.cmdBuffer_[bufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
+      gfxPipeline.layout_, 0, 1, &gfxPipeline.descSets_[bufferIndex], 0,
+      nullptr);
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(render.cmdBuffer_[bufferIndex], 0, 1,
+                         &buffers.vertexBuf_, &offset);
+
+  VkViewport viewport{
+      .x = 0,
+      .y = 0,
+      .width = (float)swapchain.displaySize_.width,
+      .height = (float)swapchain.displaySize_.height,
+      .minDepth = 0.0f,
+      .maxDepth = 1.0f,
+  };
+  VkRect2D scissor = {
+      .offset = {.x = 0, .y = 0,},
+      .extent = swapchain.displaySize_,
+  };
+  vkCmdSetViewport(render.cmdBuffer_[bufferIndex], 0, 1, &viewport);
+  vkCmdSetScissor(render.cmdBuffer_[bufferIndex], 0, 1, &scissor);
 
-  // We don't need the shaders anymore, we can release their memory
-  vkDestroyShaderModule(device.device_, vertexShader, nullptr);
-  vkDestroyShaderModule(device.device_, fragmentShader, nullptr);
+  // Draw Triangle
+  if (pipeline != VK_NULL_HANDLE) {
+    vkCmdDraw(render.cmdBuffer_[bufferIndex], 3, 1, 0, 0);
+  }
 
-  return pipelineResult;
+  vkCmdEndRenderPass(render.cmdBuffer_[bufferIndex]);
+  layouts.Use(displayImage, kTutorialUsePresent);
+  layouts.Flush(render.cmdBuffer_[bufferIndex]);
+  CALL_VK(vkEndCommandBuffer(render.cmdBuffer_[bufferIndex]));
+  render.recordedGeneration_[bufferIndex] = render.generation_;
 }
 
-void DeleteGraphicsPipeline(void) {
-  if (gfxPipeline.pipeline_ == VK_NULL_HANDLE) return;
-  vkDestroyPipeline(device.device_, gfxPipeline.pipeline_, nullptr);
-  vkDestroyPipelineCache(device.device_, gfxPipeline.cache_, nullptr);
-  vkFreeDescriptorSets(device.device_, gfxPipeline.descPool_, 1,
-                       &gfxPipeline.descSet_);
-  vkDestroyDescriptorPool(device.device_, gfxPipeline.descPool_, nullptr);
-  vkDestroyPipelineLayout(device.device_, gfxPipeline.layout_, nullptr);
+void FreeCommandBuffers(void) {
+  vkFreeCommandBuffers(device.device_, render.cmdPool_, render.cmdBufferLen_,
+                       render.cmdBuffer_);
+  delete[] render.cmdBuffer_;
+  render.cmdBuffer_ = nullptr;
+  render.cmdBufferLen_ = 0;
 }
 
-// initialize descriptor set
-VkResult CreateDescriptorSet(void) {
-  const VkDescriptorPoolSize type_count = {
-      .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-      .descriptorCount = TUTORIAL_TEXTURE_COUNT,
-  };
-  const VkDescriptorPoolCreateInfo descriptor_pool = {
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+// One render-complete semaphore per swapchain image
+void CreateRenderSemaphores(void) {
+  VkSemaphoreCreateInfo semaphoreCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
       .pNext = nullptr,
-      .maxSets = 1,
-      .poolSizeCount = 1,
-      .pPoolSizes = &type_count,
+      .flags = 0,
   };
-
-  CALL_VK(vkCreateDescriptorPool(device.device_, &descriptor_pool, nullptr,
-                                 &gfxPipeline.descPool_));
-
-  VkDescriptorSetAllocateInfo alloc_info{
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .descriptorPool = gfxPipeline.descPool_,
-      .descriptorSetCount = 1,
-      .pSetLayouts = &gfxPipeline.dscLayout_};
-  CALL_VK(vkAllocateDescriptorSets(device.device_, &alloc_info,
-                                   &gfxPipeline.descSet_));
-
-  VkDescriptorImageInfo texDsts[TUTORIAL_TEXTURE_COUNT];
-  memset(texDsts, 0, sizeof(texDsts));
-  for (int32_t idx = 0; idx < TUTORIAL_TEXTURE_COUNT; idx++) {
-    texDsts[idx].sampler = textures[idx].sampler;
-    texDsts[idx].imageView = textures[idx].view;
-    texDsts[idx].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  render.renderSemaphore_.resize(swapchain.swapchainLength_);
+  for (auto& semaphore : render.renderSemaphore_) {
+    CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
+                              &semaphore));
   }
+}
 
-  VkWriteDescriptorSet writeDst{
-      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-      .pNext = nullptr,
-      .dstSet = gfxPipeline.descSet_,
-      .dstBinding = 0,
-      .dstArrayElement = 0,
-      .descriptorCount = TUTORIAL_TEXTURE_COUNT,
-      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-      .pImageInfo = texDsts,
-      .pBufferInfo = nullptr,
-      .pTexelBufferView = nullptr};
-  vkUpdateDescriptorSets(device.device_, 1, &writeDst, 0, nullptr);
-  return VK_SUCCESS;
+void DeleteRenderSemaphores(void) {
+  for (auto semaphore : render.renderSemaphore_) {
+    vkDestroySemaphore(device.device_, semaphore, nullptr);
+  }
+  render.renderSemaphore_.clear();
 }
 
 // InitVulkan:
@@ -1037,8 +1039,10 @@ bool InitVulkan(android_app* app) {
       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
       .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      // layouts moves the image in and out of the pass; the pass itself
+      // leaves it alone, so what layouts knows stays true
+      .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
   };
 
   VkAttachmentReference colourReference = {
@@ -1070,13 +1074,29 @@ bool InitVulkan(android_app* app) {
                              &render.renderPass_));
 
   CreateFrameBuffers(render.renderPass_);
+#ifndef NDEBUG
+  // report every transition that was asked for but not needed
+  layouts.SetDebug(true);
+#endif
+  OpenAssets(app->activity->assetManager);
+  threadPool.Init();
+#ifdef TUTORIAL_PNG_DECODER
+  // opt in: zlib's inflate (NEON optimized in the system library) and vector
+  // unfiltering; stb_image still takes whatever PNG it declines, small ones
+  // like sample_tex.png included
+  tutorialSetImageDecoder(tutorialPngDecoder());
+#endif
+  textureStreamer.Init(device.gpuDevice_, device.device_, device.queue_,
+                       device.queueFamilyIndex_, &memoryAllocator, assets,
+                       &threadPool);
+  textureCache.Init(device.device_, &textureStreamer, &memoryAllocator);
   CreateTexture();
   CreateBuffers();
 
   // Create graphics pipeline
   CreateGraphicsPipeline();
 
-  CreateDescriptorSet();
+  CreateDescriptorSets();
 
   // -----------------------------------------------
   // Create a pool of command buffers to allocate command buffer from
@@ -1089,103 +1109,36 @@ bool InitVulkan(android_app* app) {
   CALL_VK(vkCreateCommandPool(device.device_, &cmdPoolCreateInfo, nullptr,
                               &render.cmdPool_));
 
-  // Record a command buffer that just clear the screen
-  // 1 command buffer draw in 1 framebuffer
-  // In our case we need 2 command as we have 2 framebuffer
-  render.cmdBufferLen_ = swapchain.swapchainLength_;
-  render.cmdBuffer_ = new VkCommandBuffer[swapchain.swapchainLength_];
-  VkCommandBufferAllocateInfo cmdBufferCreateInfo{
-      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .commandPool = render.cmdPool_,
-      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-      .commandBufferCount = render.cmdBufferLen_,
-  };
-  CALL_VK(vkAllocateCommandBuffers(device.device_, &cmdBufferCreateInfo,
-                                   render.cmdBuffer_));
+  RecordCommandBuffers();
 
-  for (int bufferIndex = 0; bufferIndex < swapchain.swapchainLength_;
-       bufferIndex++) {
-    // We start by creating and declare the "beginning" our command buffer
-    VkCommandBufferBeginInfo cmdBufferBeginInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .pInheritanceInfo = nullptr,
-    };
-    CALL_VK(vkBeginCommandBuffer(render.cmdBuffer_[bufferIndex],
-                                 &cmdBufferBeginInfo));
-
-    // transition the buffer into color attachment
-    setImageLayout(render.cmdBuffer_[bufferIndex],
-                   swapchain.displayImages_[bufferIndex],
-                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-    // Now we start a renderpass. Any draw command has to be recorded in a
-    // renderpass
-    VkClearValue clearVals{
-        .color { .float32 { 0.0f, 0.34f, 0.90f, 1.0f,}},
-    };
-
-    VkRenderPassBeginInfo renderPassBeginInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .pNext = nullptr,
-        .renderPass = render.renderPass_,
-        .framebuffer = swapchain.framebuffers_[bufferIndex],
-        .renderArea = {.offset =
-                           {
-                               .x = 0, .y = 0,
-                           },
-                       .extent = swapchain.displaySize_},
-        .clearValueCount = 1,
-        .pClearValues = &clearVals};
-    vkCmdBeginRenderPass(render.cmdBuffer_[bufferIndex], &renderPassBeginInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
-    // Bind what is necessary to the command buffer
-    vkCmdBindPipeline(render.cmdBuffer_[bufferIndex],
-                      VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeline.pipeline_);
-    vkCmdBindDescriptorSets(
-        render.cmdBuffer_[bufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-        gfxPipeline.layout_, 0, 1, &gfxPipeline.descSet_, 0, nullptr);
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(render.cmdBuffer_[bufferIndex], 0, 1,
-                           &buffers.vertexBuf_, &offset);
-
-    // Draw Triangle
-    vkCmdDraw(render.cmdBuffer_[bufferIndex], 3, 1, 0, 0);
-
-    vkCmdEndRenderPass(render.cmdBuffer_[bufferIndex]);
-    setImageLayout(render.cmdBuffer_[bufferIndex],
-                   swapchain.displayImages_[bufferIndex],
-                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-    CALL_VK(vkEndCommandBuffer(render.cmdBuffer_[bufferIndex]));
-  }
-
-  // We need to create a fence to be able, in the main loop, to wait for our
-  // draw command(s) to finish before swapping the framebuffers
+  // We need fences to be able, in the main loop, to wait for a frame's draw
+  // command(s) to finish before re-using its resources. They start signaled
+  // so the first MAX_FRAMES_IN_FLIGHT frames do not wait.
   VkFenceCreateInfo fenceCreateInfo{
       .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
       .pNext = nullptr,
-      .flags = 0,
+      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
   };
-  CALL_VK(
-      vkCreateFence(device.device_, &fenceCreateInfo, nullptr, &render.fence_));
-
-  // We need to create a semaphore to be able to wait, in the main loop, for our
-  // framebuffer to be available for us before drawing.
+  // We need semaphores to be able to wait on the GPU for our framebuffer to be
+  // available before drawing, and for drawing to finish before presenting.
   VkSemaphoreCreateInfo semaphoreCreateInfo{
       .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
   };
-  CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
-                            &render.semaphore_));
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    CALL_VK(vkCreateFence(device.device_, &fenceCreateInfo, nullptr,
+                          &render.fence_[frame]));
+    CALL_VK(vkCreateSemaphore(device.device_, &semaphoreCreateInfo, nullptr,
+                              &render.acquireSemaphore_[frame]));
+  }
+  CreateRenderSemaphores();
+  render.currentFrame_ = 0;
+  render.imageFence_.assign(swapchain.swapchainLength_, VK_NULL_HANDLE);
+
+  frameStats = FrameStats();
+  frameStats.lastFrame_ = std::chrono::steady_clock::now();
+  frameStats.periodStart_ = frameStats.lastFrame_;
 
   device.initialized_ = true;
   return true;
@@ -1196,15 +1149,36 @@ bool InitVulkan(android_app* app) {
 bool IsVulkanReady(void) { return device.initialized_; }
 
 void DeleteVulkan() {
-  vkFreeCommandBuffers(device.device_, render.cmdPool_, render.cmdBufferLen_,
-                       render.cmdBuffer_);
-  delete[] render.cmdBuffer_;
+  // frames may still be in flight
+  vkDeviceWaitIdle(device.device_);
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    vkDestroyFence(device.device_, render.fence_[frame], nullptr);
+    vkDestroySemaphore(device.device_, render.acquireSemaphore_[frame],
+                       nullptr);
+  }
+  DeleteRenderSemaphores();
+
+  FreeCommandBuffers();
 
   vkDestroyCommandPool(device.device_, render.cmdPool_, nullptr);
   vkDestroyRenderPass(device.device_, render.renderPass_, nullptr);
   DeleteSwapChain();
+  DeleteDescriptorSets();
   DeleteGraphicsPipeline();
   DeleteBuffers();
+  textureStreamer.Destroy();
+  threadPool.Destroy();
+  DeleteTextures();
+  DestroyRetiredTextures(true);
+  textureCache.LogStats();
+  LOGI("layouts: %u barriers, %u redundant transitions",
+       layouts.BarrierCount(), layouts.RedundantCount());
+  textureCache.Destroy();
+  assetArchive.Destroy();
+
+  // Anything still allocated at this point is reported as a leak
+  memoryAllocator.LogStats();
+  memoryAllocator.Destroy();
 
   vkDestroyDevice(device.device_, nullptr);
   vkDestroyInstance(device.instance_, nullptr);
@@ -1212,114 +1186,186 @@ void DeleteVulkan() {
   device.initialized_ = false;
 }
 
+// Check whether the surface size no longer matches the swapchain
+bool SwapchainExtentChanged(void) {
+  VkSurfaceCapabilitiesKHR surfaceCapabilities;
+  CALL_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+      device.gpuDevice_, device.surface_, &surfaceCapabilities));
+  return surfaceCapabilities.currentExtent.width !=
+             swapchain.displaySize_.width ||
+         surfaceCapabilities.currentExtent.height !=
+             swapchain.displaySize_.height;
+}
+
+// RecreateSwapchain():
+//   Rebuild the swapchain and the objects depending on its images (views,
+//   framebuffers, command buffers) in place, passing the current swapchain as
+//   oldSwapchain. Device, render pass, pipeline, pipeline cache, textures and
+//   sync objects are kept.
+//   Returns false if the window currently has no area to render into.
+bool RecreateSwapchain(void) {
+  VkSurfaceCapabilitiesKHR surfaceCapabilities;
+  CALL_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+      device.gpuDevice_, device.surface_, &surfaceCapabilities));
+  if (surfaceCapabilities.currentExtent.width == 0 ||
+      surfaceCapabilities.currentExtent.height == 0) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Nothing may still reference the old framebuffers or command buffers
+  vkDeviceWaitIdle(device.device_);
+  FreeCommandBuffers();
+  DestroyRetiredTextures(true);
+  DeleteDescriptorSets();
+  DeleteFrameBuffers();
+
+  VkSwapchainKHR oldSwapchain = swapchain.swapchain_;
+  CreateSwapChain(oldSwapchain);
+  vkDestroySwapchainKHR(device.device_, oldSwapchain, nullptr);
+
+  CreateFrameBuffers(render.renderPass_);
+  CreateDescriptorSets();
+  RecordCommandBuffers();
+  // the new swapchain may have a different number of images
+  DeleteRenderSemaphores();
+  CreateRenderSemaphores();
+  render.imageFence_.assign(swapchain.swapchainLength_, VK_NULL_HANDLE);
+
+  LOGI("Swapchain re-created: %ux%u, %u images in %.2f ms",
+       swapchain.displaySize_.width, swapchain.displaySize_.height,
+       swapchain.swapchainLength_,
+       std::chrono::duration<double, std::milli>(
+           std::chrono::steady_clock::now() - start).count());
+  return true;
+}
+
+// Accumulate frame times, log average/min/max once per kFrameStatsPeriod
+void UpdateFrameStats(void) {
+  auto now = std::chrono::steady_clock::now();
+  double frameMs =
+      std::chrono::duration<double, std::milli>(now - frameStats.lastFrame_)
+          .count();
+  frameStats.lastFrame_ = now;
+
+  if (frameStats.frameCount_ == 0 || frameMs < frameStats.minFrameMs_) {
+    frameStats.minFrameMs_ = frameMs;
+  }
+  if (frameMs > frameStats.maxFrameMs_) {
+    frameStats.maxFrameMs_ = frameMs;
+  }
+  frameStats.frameCount_++;
+
+  auto period = now - frameStats.periodStart_;
+  if (period < kFrameStatsPeriod) return;
+
+  double periodMs =
+      std::chrono::duration<double, std::milli>(period).count();
+  double avgMs = periodMs / frameStats.frameCount_;
+  LOGI("%d frame(s) in flight: %u frames, avg %.2f ms (%.1f fps), "
+       "min %.2f ms, max %.2f ms",
+       MAX_FRAMES_IN_FLIGHT, frameStats.frameCount_, avgMs, 1000.0 / avgMs,
+       frameStats.minFrameMs_, frameStats.maxFrameMs_);
+  frameStats.periodStart_ = now;
+  frameStats.frameCount_ = 0;
+  frameStats.maxFrameMs_ = 0.0;
+}
+
 // Draw one frame
 bool VulkanDrawFrame(void) {
+  // Swap in the textures finished since the last frame
+  textureStreamer.Update();
+  // and the pipelines; the command buffers are recorded again to use them
+  if (pipelineCompiler.Update()) render.generation_++;
+
+  uint32_t frame = render.currentFrame_;
+
+  // Wait for the frame that used this slot MAX_FRAMES_IN_FLIGHT frames ago;
+  // the GPU keeps working on the frames submitted after it.
+  CALL_VK(vkWaitForFences(device.device_, 1, &render.fence_[frame], VK_TRUE,
+                          UINT64_MAX));
+
   uint32_t nextIndex;
   // Get the framebuffer index we should draw in
-  CALL_VK(vkAcquireNextImageKHR(device.device_, swapchain.swapchain_,
-                                UINT64_MAX, render.semaphore_, VK_NULL_HANDLE,
-                                &nextIndex));
-  CALL_VK(vkResetFences(device.device_, 1, &render.fence_));
+  VkResult result = vkAcquireNextImageKHR(
+      device.device_, swapchain.swapchain_, UINT64_MAX,
+      render.acquireSemaphore_[frame], VK_NULL_HANDLE, &nextIndex);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    // Nothing was acquired and the frame fence is still signaled, so the
+    // frame can be skipped altogether
+    RecreateSwapchain();
+    return true;
+  }
+  // VK_SUBOPTIMAL_KHR still acquired an image: draw it, re-create after present.
+  // Anything else (surface or device lost) leaves nothing to draw into.
+  if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    LOGE("vkAcquireNextImageKHR failed: %d", result);
+    return false;
+  }
+
+  // The pre-recorded command buffer of this image may still be executing
+  // for an older frame
+  if (render.imageFence_[nextIndex] != VK_NULL_HANDLE &&
+      render.imageFence_[nextIndex] != render.fence_[frame]) {
+    CALL_VK(vkWaitForFences(device.device_, 1, &render.imageFence_[nextIndex],
+                            VK_TRUE, UINT64_MAX));
+  }
+  render.imageFence_[nextIndex] = render.fence_[frame];
+
+  // Textures or pipelines changed since this image's command buffer was
+  // recorded. Neither it nor its descriptor set is pending any more, so
+  // they are brought up to date without waiting on the other frames.
+  if (render.recordedGeneration_[nextIndex] != render.generation_) {
+    WriteTextureDescriptors(gfxPipeline.descSets_[nextIndex]);
+    RecordCommandBuffer(nextIndex);
+    DestroyRetiredTextures(false);
+  }
+
+  CALL_VK(vkResetFences(device.device_, 1, &render.fence_[frame]));
 
   VkPipelineStageFlags waitStageMask =
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                              .pNext = nullptr,
-                              .waitSemaphoreCount = 1,
-                              .pWaitSemaphores = &render.semaphore_,
-                              .pWaitDstStageMask = &waitStageMask,
-                              .commandBufferCount = 1,
-                              .pCommandBuffers = &render.cmdBuffer_[nextIndex],
-                              .signalSemaphoreCount = 0,
-                              .pSignalSemaphores = nullptr};
-  CALL_VK(vkQueueSubmit(device.queue_, 1, &submit_info, render.fence_));
-  CALL_VK(
-      vkWaitForFences(device.device_, 1, &render.fence_, VK_TRUE, 100000000));
-
-  LOGI("Drawing frames......");
-
-  VkResult result;
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = nullptr,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &render.acquireSemaphore_[frame],
+      .pWaitDstStageMask = &waitStageMask,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &render.cmdBuffer_[nextIndex],
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &render.renderSemaphore_[nextIndex]};
+  CALL_VK(vkQueueSubmit(device.queue_, 1, &submit_info, render.fence_[frame]));
+
+  // Presentation waits on the GPU for the rendering, not on the CPU
   VkPresentInfoKHR presentInfo{
       .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
       .pNext = nullptr,
-      .waitSemaphoreCount = 0,
-      .pWaitSemaphores = nullptr,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &render.renderSemaphore_[nextIndex],
       .swapchainCount = 1,
       .pSwapchains = &swapchain.swapchain_,
       .pImageIndices = &nextIndex,
-      .pResults = &result,
-  };
-  vkQueuePresentKHR(device.queue_, &presentInfo);
-  return true;
-}
-
-void setImageLayout(VkCommandBuffer cmdBuffer, VkImage image,
-                    VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-                    VkPipelineStageFlags srcStages,
-                    VkPipelineStageFlags destStages) {
-  VkImageMemoryBarrier imageMemoryBarrier = {
-      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      .pNext = NULL,
-      .srcAccessMask = 0,
-      .dstAccessMask = 0,
-      .oldLayout = oldImageLayout,
-      .newLayout = newImageLayout,
-      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .image = image,
-      .subresourceRange =
-          {
-              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-              .baseMipLevel = 0,
-              .levelCount = 1,
-              .baseArrayLayer = 0,
-              .layerCount = 1,
-          },
+      .pResults = nullptr,
   };
+  VkResult presentResult = vkQueuePresentKHR(device.queue_, &presentInfo);
 
-  switch (oldImageLayout) {
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
+  render.currentFrame_ = (frame + 1) % MAX_FRAMES_IN_FLIGHT;
 
-    case VK_IMAGE_LAYOUT_PREINITIALIZED:
-      imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-      break;
-
-    default:
-      break;
+  if (presentResult != VK_SUCCESS && presentResult != VK_SUBOPTIMAL_KHR &&
+      presentResult != VK_ERROR_OUT_OF_DATE_KHR) {
+    LOGE("vkQueuePresentKHR failed: %d", presentResult);
+    return false;
   }
-
-  switch (newImageLayout) {
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-      break;
-
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-      imageMemoryBarrier.dstAccessMask =
-          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-      break;
-
-    default:
-      break;
+  // Android reports VK_SUBOPTIMAL_KHR for as long as the display is rotated
+  // against our identity pre-transform, so only a size change is acted upon.
+  if (presentResult == VK_ERROR_OUT_OF_DATE_KHR ||
+      result == VK_SUBOPTIMAL_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || SwapchainExtentChanged()) {
+      RecreateSwapchain();
+    }
   }
-
-  vkCmdPipelineBarrier(cmdBuffer, srcStages, destStages, 0, 0, NULL, 0, NULL, 1,
-                       &imageMemoryBarrier);
+  UpdateFrameStats();
+  return true;
 }
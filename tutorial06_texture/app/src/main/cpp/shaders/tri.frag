@@ -17,9 +17,17 @@
 #version 400
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
-layout (binding = 0) uniform sampler2D tex;
+// Specialization constants, set per pipeline variant by
+// CreateGraphicsPipeline()
+layout (constant_id = 0) const int TEXTURE_COUNT = 1;
+layout (constant_id = 1) const bool TEXTURED = true;
+layout (binding = 0) uniform sampler2D tex[TEXTURE_COUNT];
 layout (location = 0) in vec2 texcoord;
 layout (location = 0) out vec4 uFragColor;
 void main() {
-   uFragColor = texture(tex, texcoord);
+   if (TEXTURED) {
+      uFragColor = texture(tex[0], texcoord);
+   } else {
+      uFragColor = vec4(texcoord, 0.0, 1.0);
+   }
 }